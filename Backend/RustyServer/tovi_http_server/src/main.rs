@@ -29,7 +29,8 @@
   Bandwidth        : 0.19 MB/s
 
 */
-use actix_web::{post, web, App, HttpServer, HttpResponse, Responder};
+use actix_web::{dev::Extensions, post, web, App, HttpServer, HttpResponse, Responder};
+use std::any::Any;
 use std::sync::atomic::{AtomicUsize, Ordering};
 use std::time::Instant;
 use std::sync::Mutex;
@@ -39,6 +40,8 @@ const EXPECTED_ITERATIONS: usize = 10;
 
 static COUNTER: AtomicUsize = AtomicUsize::new(0);
 static TOTAL_BYTES: AtomicUsize = AtomicUsize::new(0);
+// TCP connections accepted: 1 for the whole run with a kept-alive uploader, one per upload otherwise
+static CONNECTIONS: AtomicUsize = AtomicUsize::new(0);
 static START_TIME: Lazy<Mutex<Option<Instant>>> = Lazy::new(|| Mutex::new(None));
 
 #[post("/upload")]
@@ -65,6 +68,7 @@ async fn upload(body: web::Bytes) -> impl Responder {
         println!("  Total transferred: {:.2} MB", mb);
         println!("  Elapsed time     : {:.2} s", elapsed);
         println!("  Bandwidth        : {:.2} MB/s", mbps);
+        println!("  Connections      : {}", CONNECTIONS.load(Ordering::SeqCst));
     }
 
     HttpResponse::Ok().body("OK")
@@ -75,6 +79,9 @@ async fn main() -> std::io::Result<()> {
     println!("🚀 Listening on http://0.0.0.0:8080");
 
     HttpServer::new(|| App::new().service(upload))
+        .on_connect(|_: &dyn Any, _: &mut Extensions| {
+            CONNECTIONS.fetch_add(1, Ordering::SeqCst);
+        })
         .bind(("0.0.0.0", 8080))?
         .run()
         .await
@@ -18,9 +18,11 @@
 [10] Received and echoed 160000 bytes
 */
 
-use tokio::net::TcpListener;
+mod video;
+
+use tokio::net::{TcpListener, TcpStream};
 use tokio::io::{AsyncReadExt, AsyncWriteExt};
-use std::time::Instant;
+use std::time::{Duration, Instant};
 
 const SAMPLE_RATE: usize = 16_000;
 const DURATION_SECS: usize = 5;
@@ -36,47 +38,70 @@ async fn main() -> std::io::Result<()> {
     println!("[Server] Listening on port 8000...");
 
     loop {
-        let (mut socket, addr) = listener.accept().await?;
+        let (socket, addr) = listener.accept().await?;
         println!("[Server] Connection from {}", addr);
 
         tokio::spawn(async move {
-            let mut total_bytes: usize = 0;
-            let mut buf = vec![0u8; BUFFER_SIZE];
-
-            let start = Instant::now();
-
-            for i in 0..ITERATIONS {
-                let mut received = 0;
-                while received < BUFFER_SIZE {
-                    match socket.read(&mut buf[received..]).await {
-                        Ok(0) => {
-                            println!("[Server] Connection closed");
-                            return;
-                        }
-                        Ok(n) => received += n,
-                        Err(e) => {
-                            eprintln!("[Server] Read error: {}", e);
-                            return;
-                        }
-                    }
+            // Video senders start with a frame header, anything else is the echo benchmark
+            if starts_with_magic(&socket).await {
+                if let Err(e) = video::receive(socket, addr).await {
+                    eprintln!("[Video {}] {}", addr, e);
                 }
+            } else {
+                echo_benchmark(socket).await;
+            }
+        });
+    }
+}
+
+async fn starts_with_magic(socket: &TcpStream) -> bool {
+    let mut magic = [0u8; 4];
+    for _ in 0..100 {
+        match socket.peek(&mut magic).await {
+            Ok(n) if n >= magic.len() => return magic == video::MAGIC,
+            Ok(0) | Err(_) => return false,
+            Ok(_) => tokio::time::sleep(Duration::from_millis(10)).await,
+        }
+    }
+    false
+}
 
-                total_bytes += received;
+async fn echo_benchmark(mut socket: TcpStream) {
+    let mut total_bytes: usize = 0;
+    let mut buf = vec![0u8; BUFFER_SIZE];
 
-                if let Err(e) = socket.write_all(&buf).await {
-                    eprintln!("[Server] Write error: {}", e);
+    let start = Instant::now();
+
+    for i in 0..ITERATIONS {
+        let mut received = 0;
+        while received < BUFFER_SIZE {
+            match socket.read(&mut buf[received..]).await {
+                Ok(0) => {
+                    println!("[Server] Connection closed");
+                    return;
+                }
+                Ok(n) => received += n,
+                Err(e) => {
+                    eprintln!("[Server] Read error: {}", e);
                     return;
                 }
-
-                println!("[{}] Received and echoed {} bytes", i + 1, received);
             }
+        }
 
-            let elapsed = start.elapsed().as_secs_f64();
-            let mb = (total_bytes * 2) as f64 / (1024.0 * 1024.0); 
-            println!("\n[Benchmark Result]");
-            println!("  Total transferred: {:.2} MB", mb);
-            println!("  Elapsed time     : {:.2} s", elapsed);
-            println!("  Bandwidth        : {:.2} MB/s", mb / elapsed);
-        });
+        total_bytes += received;
+
+        if let Err(e) = socket.write_all(&buf).await {
+            eprintln!("[Server] Write error: {}", e);
+            return;
+        }
+
+        println!("[{}] Received and echoed {} bytes", i + 1, received);
     }
+
+    let elapsed = start.elapsed().as_secs_f64();
+    let mb = (total_bytes * 2) as f64 / (1024.0 * 1024.0); 
+    println!("\n[Benchmark Result]");
+    println!("  Total transferred: {:.2} MB", mb);
+    println!("  Elapsed time     : {:.2} s", elapsed);
+    println!("  Bandwidth        : {:.2} MB/s", mb / elapsed);
 }
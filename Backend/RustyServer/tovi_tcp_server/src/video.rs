@@ -0,0 +1,196 @@
+// Receiver of the binary framed video of the camera (TCP Frame Sender in camera_test/main/main.c).
+//
+// Each frame is a 24-byte little-endian header followed by the JPEG:
+//   magic "TOVF" | version u8 | flags u8 | header_len u16 | seq u32 | timestamp_us u64 | len u32
+// Frames are recorded to recordings/<time>_<sender>/video.mjpeg (play with `ffplay -f mjpeg`), with
+// one line per frame in frames.csv.
+//
+// The device clock is not synchronized with ours, so latency is measured relative to the fastest
+// frame: the smallest (arrival - capture timestamp) seen on the connection counts as 0 ms.
+
+use std::io;
+use std::net::SocketAddr;
+use std::path::PathBuf;
+use std::time::{Instant, SystemTime, UNIX_EPOCH};
+use tokio::fs::{self, File};
+use tokio::io::{AsyncReadExt, AsyncWriteExt, BufWriter};
+use tokio::net::TcpStream;
+
+pub const MAGIC: [u8; 4] = *b"TOVF";
+const VERSION: u8 = 1;
+const HEADER_LEN: usize = 24;
+const MAX_FRAME_LEN: usize = 4 * 1024 * 1024;
+const FLAG_FIRST: u8 = 0x1;
+const FLAG_UNCHANGED: u8 = 0x2;
+const REPORT_FRAMES: u32 = 50;
+
+struct Header {
+    flags: u8,
+    header_len: usize,
+    seq: u32,
+    timestamp_us: u64,
+    len: usize,
+}
+
+fn parse_header(buf: &[u8; HEADER_LEN]) -> io::Result<Header> {
+    let invalid = |msg: String| io::Error::new(io::ErrorKind::InvalidData, msg);
+
+    if buf[0..4] != MAGIC {
+        return Err(invalid(format!("bad magic {:02x?}", &buf[0..4])));
+    }
+    if buf[4] != VERSION {
+        return Err(invalid(format!("unsupported version {}", buf[4])));
+    }
+    let header = Header {
+        flags: buf[5],
+        header_len: u16::from_le_bytes([buf[6], buf[7]]) as usize,
+        seq: u32::from_le_bytes(buf[8..12].try_into().unwrap()),
+        timestamp_us: u64::from_le_bytes(buf[12..20].try_into().unwrap()),
+        len: u32::from_le_bytes(buf[20..24].try_into().unwrap()) as usize,
+    };
+    if header.header_len < HEADER_LEN {
+        return Err(invalid(format!("header length {}", header.header_len)));
+    }
+    if header.len > MAX_FRAME_LEN {
+        return Err(invalid(format!("frame length {}", header.len)));
+    }
+    Ok(header)
+}
+
+#[derive(Default)]
+struct Stats {
+    frames: u32,
+    lost: u32,
+    unchanged: u32,
+    bytes: u64,
+    last_seq: Option<u32>,
+    min_delay_us: i64,
+    // Since the last report
+    window_frames: u32,
+    window_lost: u32,
+    window_bytes: u64,
+    window_latency_us: i64,
+    window_max_latency_us: i64,
+}
+
+impl Stats {
+    // Returns the latency of the frame in microseconds
+    fn add(&mut self, header: &Header, delay_us: i64) -> i64 {
+        if header.flags & FLAG_FIRST != 0 {
+            self.last_seq = None;
+        }
+        // The peer is not trusted: a seq that does not move forward is taken as a restart of its
+        // numbering, not as 4 billion lost frames
+        if let Some(last) = self.last_seq {
+            if header.seq > last {
+                let lost = header.seq - last - 1;
+                self.lost = self.lost.saturating_add(lost);
+                self.window_lost = self.window_lost.saturating_add(lost);
+            }
+        }
+        self.last_seq = Some(header.seq);
+
+        if self.frames == 0 || delay_us < self.min_delay_us {
+            self.min_delay_us = delay_us;
+        }
+        let latency_us = delay_us - self.min_delay_us;
+
+        self.frames += 1;
+        self.bytes += header.len as u64;
+        if header.flags & FLAG_UNCHANGED != 0 {
+            self.unchanged += 1;
+        }
+        self.window_frames += 1;
+        self.window_bytes += header.len as u64;
+        self.window_latency_us += latency_us;
+        self.window_max_latency_us = self.window_max_latency_us.max(latency_us);
+        latency_us
+    }
+
+    fn report(&mut self, addr: SocketAddr, elapsed: f64) {
+        let frames = self.window_frames.max(1) as i64;
+        println!(
+            "[Video {}] {} frames, {:.1} fps, {:.2} MB/s, lost {} ({} total), latency avg {:.1} ms max {:.1} ms",
+            addr,
+            self.frames,
+            self.window_frames as f64 / elapsed,
+            self.window_bytes as f64 / (1024.0 * 1024.0) / elapsed,
+            self.window_lost,
+            self.lost,
+            (self.window_latency_us / frames) as f64 / 1000.0,
+            self.window_max_latency_us as f64 / 1000.0,
+        );
+        self.window_frames = 0;
+        self.window_lost = 0;
+        self.window_bytes = 0;
+        self.window_latency_us = 0;
+        self.window_max_latency_us = 0;
+    }
+}
+
+pub async fn receive(mut socket: TcpStream, addr: SocketAddr) -> io::Result<()> {
+    let started = SystemTime::now().duration_since(UNIX_EPOCH).unwrap_or_default().as_secs();
+    let dir = PathBuf::from("recordings").join(format!("{}_{}", started, addr.to_string().replace([':', '[', ']'], "_")));
+    fs::create_dir_all(&dir).await?;
+    let mut video = BufWriter::new(File::create(dir.join("video.mjpeg")).await?);
+    let mut index = BufWriter::new(File::create(dir.join("frames.csv")).await?);
+    index.write_all(b"seq,timestamp_us,arrival_us,latency_ms,len,flags\n").await?;
+    println!("[Video {}] Recording to {}", addr, dir.display());
+
+    let start = Instant::now();
+    let mut report_start = start;
+    let mut stats = Stats::default();
+    let mut header_buf = [0u8; HEADER_LEN];
+    let mut jpeg = Vec::new();
+
+    loop {
+        match socket.read_exact(&mut header_buf).await {
+            Ok(_) => {}
+            Err(e) if e.kind() == io::ErrorKind::UnexpectedEof => break,
+            Err(e) => return Err(e),
+        }
+        let header = parse_header(&header_buf)?;
+        if header.header_len > HEADER_LEN {
+            // Fields of a newer sender
+            let mut extra = vec![0u8; header.header_len - HEADER_LEN];
+            socket.read_exact(&mut extra).await?;
+        }
+        jpeg.resize(header.len, 0);
+        socket.read_exact(&mut jpeg).await?;
+
+        let arrival_us = start.elapsed().as_micros() as i64;
+        let latency_us = stats.add(&header, arrival_us - header.timestamp_us as i64);
+
+        video.write_all(&jpeg).await?;
+        index
+            .write_all(
+                format!(
+                    "{},{},{},{:.1},{},{}\n",
+                    header.seq,
+                    header.timestamp_us,
+                    arrival_us,
+                    latency_us as f64 / 1000.0,
+                    header.len,
+                    header.flags
+                )
+                .as_bytes(),
+            )
+            .await?;
+
+        if stats.window_frames >= REPORT_FRAMES {
+            stats.report(addr, report_start.elapsed().as_secs_f64());
+            report_start = Instant::now();
+        }
+    }
+
+    video.flush().await?;
+    index.flush().await?;
+    let elapsed = start.elapsed().as_secs_f64();
+    println!("\n[Video Result] {}", addr);
+    println!("  Frames           : {} ({} unchanged)", stats.frames, stats.unchanged);
+    println!("  Lost             : {}", stats.lost);
+    println!("  Elapsed time     : {:.2} s", elapsed);
+    println!("  Frame rate       : {:.1} fps", stats.frames as f64 / elapsed);
+    println!("  Bandwidth        : {:.2} MB/s", stats.bytes as f64 / (1024.0 * 1024.0) / elapsed);
+    Ok(())
+}
@@ -0,0 +1,431 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Scale of output image
+ *
+ */
+typedef enum {
+    JPEG_IMAGE_SCALE_0 = 0, /*!< No scale */
+    JPEG_IMAGE_SCALE_1_2,   /*!< Scale 1:2 */
+    JPEG_IMAGE_SCALE_1_4,   /*!< Scale 1:4 */
+    JPEG_IMAGE_SCALE_1_8,   /*!< Scale 1:8 */
+} esp_jpeg_image_scale_t;
+
+/**
+ * @brief Format of output image
+ *
+ */
+typedef enum {
+    JPEG_IMAGE_FORMAT_RGB888 = 0,   /*!< Format RGB888 */
+    JPEG_IMAGE_FORMAT_RGB565,       /*!< Format RGB565 */
+    JPEG_IMAGE_FORMAT_RGBA8888,     /*!< Format RGBA8888: bytes R, G, B, A (A = 0xFF). Output buffer must be 4-byte aligned */
+    JPEG_IMAGE_FORMAT_BGR888,       /*!< Format BGR888: bytes B, G, R */
+    JPEG_IMAGE_FORMAT_ARGB8888,     /*!< Format ARGB8888: bytes A, R, G, B (A = 0xFF). Output buffer must be 4-byte aligned */
+} esp_jpeg_image_format_t;
+
+/**
+ * @brief Rotation of output image (clockwise)
+ *
+ */
+typedef enum {
+    JPEG_IMAGE_ROTATE_0 = 0,    /*!< No rotation */
+    JPEG_IMAGE_ROTATE_90,       /*!< Rotate by 90 degrees */
+    JPEG_IMAGE_ROTATE_180,      /*!< Rotate by 180 degrees */
+    JPEG_IMAGE_ROTATE_270,      /*!< Rotate by 270 degrees */
+} esp_jpeg_image_rotation_t;
+
+/**
+ * @brief Decoder used for an image
+ *
+ */
+typedef enum {
+    JPEG_DECODER_AUTO = 0,  /*!< Faster decoder if built and there is enough memory for it, otherwise the default one */
+    JPEG_DECODER_DEFAULT,   /*!< Decoder configured by JD_FASTDECODE */
+    JPEG_DECODER_FAST,      /*!< Additional decoder with table conversion for huffman decoding (CONFIG_JD_FAST_VARIANT) */
+} esp_jpeg_decoder_t;
+
+/**
+ * @brief Part of the input JPEG image held in a separate buffer
+ *
+ */
+typedef struct {
+    const uint8_t *data;    /*!< Buffer with a part of the input image */
+    uint32_t size;          /*!< Size of the buffer in bytes */
+} esp_jpeg_segment_t;
+
+/**
+ * @brief JPEG Configuration Type
+ *
+ */
+typedef struct esp_jpeg_image_cfg_s {
+    uint8_t *indata;        /*!< Input JPEG image */
+    uint32_t indata_size;   /*!< Size of input image  */
+    const esp_jpeg_segment_t *insegments; /*!< Input JPEG image split across several buffers (e.g. a chain of DMA or network buffers),
+                                               read in order without concatenation. If not NULL, indata and indata_size are not used */
+    uint16_t insegments_count;            /*!< Number of buffers in insegments */
+    uint8_t *outbuf;        /*!< Output buffer */
+    uint32_t outbuf_size;   /*!< Output buffer size */
+    esp_jpeg_image_format_t out_format; /*!< Output image format */
+    esp_jpeg_image_scale_t  out_scale; /*!< Output scale */
+    esp_jpeg_image_rotation_t out_rotation; /*!< Output rotation, applied after mirroring */
+    uint32_t out_stride;    /*!< Length of one line of the output buffer in pixels. If 0, width of the output image is used */
+    uint16_t out_x;         /*!< Horizontal position of the output image in the output buffer (pixels) */
+    uint16_t out_y;         /*!< Vertical position of the output image in the output buffer (pixels) */
+
+    struct {
+        uint8_t swap_color_bytes: 1; /*!< Swap first and last color bytes */
+        uint8_t luma_stats: 1;       /*!< Collect luma statistics while decoding (see esp_jpeg_image_output_t::luma) */
+        uint8_t mirror_x: 1;         /*!< Mirror output image horizontally */
+        uint8_t mirror_y: 1;         /*!< Mirror output image vertically */
+    } flags;
+
+    struct {
+        void *working_buffer;       /*!< If set to NULL, a working buffer will be allocated in esp_jpeg_decode().
+                                         Tjpgd does not use dynamic allocation, se we pass this buffer to Tjpgd that uses it as scratchpad */
+        size_t working_buffer_size; /*!< Size of the working buffer. Must be set it working_buffer != NULL.
+                                         Use esp_jpeg_get_work_buffer_size() to get the exact size for an image.
+                                         Allocated buffer has the exact size, or 3.1kB with the decoder from ROM */
+        uint32_t *luma_histogram;     /*!< Optional luma histogram filled if flags.luma_stats is set. Can be NULL */
+        uint16_t luma_histogram_bins; /*!< Number of entries in luma_histogram: 256 or 64 (4 luma levels per bin) */
+        esp_jpeg_decoder_t decoder;   /*!< Decoder to use. With JPEG_DECODER_AUTO, the faster decoder is used if it fits
+                                           in working_buffer_size, or if allocating its working buffer leaves at least
+                                           CONFIG_JD_FAST_VARIANT_MIN_FREE bytes of internal RAM free */
+        void *coef_buffer;            /*!< Coefficient buffer for progressive JPEG (CONFIG_JD_PROGRESSIVE). If set to NULL, it is allocated
+                                           in esp_jpeg_decode(), in PSRAM if available. Use esp_jpeg_get_coef_buffer_size() to get the size */
+        size_t coef_buffer_size;      /*!< Size of the coefficient buffer. Must be set if coef_buffer != NULL */
+        bool (*preview_cb)(struct esp_jpeg_image_cfg_s *cfg, uint16_t scans, void *arg); /*!< Optional callback called after each scan of a
+                                           progressive JPEG but the last one, with the image decoded so far in cfg->outbuf.
+                                           Return false to skip the previews of the remaining scans. Can be NULL */
+        void *preview_arg;            /*!< Argument passed to preview_cb */
+    } advanced;
+
+    struct {
+        uint32_t read;          /*!< Internal count of read bytes */
+        uint16_t seg;           /*!< Internal index of the current buffer of insegments */
+        uint32_t seg_start;     /*!< Internal offset of the current buffer of insegments in the input image */
+        uint64_t luma_sum;      /*!< Internal sum of luma samples */
+        uint32_t luma_samples;  /*!< Internal count of luma samples */
+        uint8_t luma_min;       /*!< Internal minimal luma */
+        uint8_t luma_max;       /*!< Internal maximal luma */
+        int32_t out_origin;     /*!< Internal offset of the first decoded pixel in the output buffer (bytes) */
+        int32_t out_step_x;     /*!< Internal output buffer step of one decoded pixel to the right (bytes) */
+        int32_t out_step_y;     /*!< Internal output buffer step of one decoded pixel down (bytes) */
+        uint16_t out_top;       /*!< Internal first decoded row (see esp_jpeg_decode_rows()) */
+    } priv;
+} esp_jpeg_image_cfg_t;
+
+/**
+ * @brief JPEG output info
+ */
+typedef struct esp_jpeg_image_output_s {
+    uint16_t width;    /*!< Width of the output image (after rotation) */
+    uint16_t height;   /*!< Height of the output image (after rotation) */
+    size_t output_len; /*!< Length of the output image in bytes (without the stride padding) */
+    struct {
+        uint32_t samples; /*!< Number of luma samples (pixels of the full size image) */
+        uint8_t min;      /*!< Minimal luma */
+        uint8_t max;      /*!< Maximal luma */
+        uint8_t mean;     /*!< Mean luma */
+    } luma;            /*!< Luma statistics, filled only if cfg->flags.luma_stats is set */
+    size_t work_buffer_used; /*!< Bytes of the working buffer used by the decoder (0 with the decoder from ROM) */
+    esp_jpeg_decoder_t decoder; /*!< Decoder used for the image (JPEG_DECODER_DEFAULT or JPEG_DECODER_FAST) */
+    uint16_t scans;    /*!< Number of decoded scans (1 for baseline JPEG) */
+    struct {
+        uint32_t entropy_cycles; /*!< Huffman decoding and de-quantization */
+        uint32_t idct_cycles;    /*!< IDCT, or filling of blocks without AC elements */
+        uint32_t color_cycles;   /*!< YCbCr to RGB conversion */
+        uint32_t scale_cycles;   /*!< Descaling (cfg->out_scale) */
+        uint32_t output_cycles;  /*!< Writing to the output buffer and collecting luma statistics */
+        uint32_t mcus;           /*!< Number of decoded MCUs */
+        uint32_t blocks;         /*!< Number of decoded 8x8 blocks */
+        uint32_t dc_blocks;      /*!< Number of decoded blocks without AC elements */
+    } profile;         /*!< Per-stage decoding counters, filled only with CONFIG_JD_PROFILE (zero otherwise).
+                             The *_cycles are CPU cycles on ESP targets, nanoseconds in the Linux build */
+} esp_jpeg_image_output_t;
+
+/**
+ * @brief Luma DC signature of a JPEG image
+ *
+ * Mean luminance of every 8x8 luma block, taken from the DC coefficients only.
+ * Blocks are stored row by row and cover the image padded to whole MCUs.
+ */
+typedef struct esp_jpeg_dc_signature_s {
+    uint8_t *blocks;        /*!< Buffer for mean luminance of each block. Provided by the caller */
+    size_t blocks_size;     /*!< Size of the blocks buffer */
+    uint16_t blocks_w;      /*!< Number of blocks in a row (set by esp_jpeg_get_dc_signature()) */
+    uint16_t blocks_h;      /*!< Number of block rows (set by esp_jpeg_get_dc_signature()) */
+} esp_jpeg_dc_signature_t;
+
+/**
+ * @brief Result of comparing two DC signatures
+ */
+typedef struct esp_jpeg_motion_s {
+    uint32_t changed_blocks; /*!< Number of blocks whose mean luminance changed more than the threshold */
+    uint32_t total_blocks;   /*!< Number of compared blocks */
+    uint32_t score;          /*!< Sum of absolute mean luminance differences of all blocks */
+} esp_jpeg_motion_t;
+
+/**
+ * @brief Decoding state at the top of an MCU row
+ *
+ * Internal state of the decoder. It is valid only for the image it was taken from,
+ * and with the same JD_FASTDECODE configuration (0 or not 0).
+ */
+typedef struct esp_jpeg_row_mark_s {
+    uint32_t offset;        /*!< Offset of the next byte of the input image to read */
+    uint32_t bits;          /*!< Bits read ahead from the input image (current byte with JD_FASTDECODE == 0) */
+    uint8_t bit_state;      /*!< Number of bits available in bits (bit mask with JD_FASTDECODE == 0) */
+    uint8_t marker;         /*!< Marker found in the input image (0: none) */
+    uint16_t row;           /*!< MCU row */
+    uint16_t restart_mcus;  /*!< MCUs since the last restart marker */
+    uint16_t restart_num;   /*!< Number of the next restart marker */
+    int16_t dc[3];          /*!< Previous DC values of Y, Cb and Cr */
+} esp_jpeg_row_mark_t;
+
+/**
+ * @brief MCU row index of a JPEG image
+ *
+ * Decoding states saved every `interval` MCU rows, so that a band of the image can be decoded
+ * without decoding the whole image above it (see esp_jpeg_decode_rows()).
+ */
+typedef struct esp_jpeg_row_index_s {
+    esp_jpeg_row_mark_t *marks; /*!< Buffer for the decoding states. Provided by the caller */
+    size_t marks_size;      /*!< Number of entries in the marks buffer */
+    uint16_t interval;      /*!< MCU rows between two decoding states. Set by the caller */
+    uint16_t mark_count;    /*!< Number of decoding states (set by esp_jpeg_get_row_index()) */
+    uint16_t width;         /*!< Width of the image (set by esp_jpeg_get_row_index()) */
+    uint16_t height;        /*!< Height of the image (set by esp_jpeg_get_row_index()) */
+    uint16_t mcu_height;    /*!< Height of an MCU row in pixels, 8 or 16 (set by esp_jpeg_get_row_index()) */
+    uint16_t mcu_rows;      /*!< Number of MCU rows (set by esp_jpeg_get_row_index()) */
+} esp_jpeg_row_index_t;
+
+/**
+ * @brief Decode JPEG image
+ *
+ * @note This function is blocking.
+ *
+ * @param[in]  cfg: Configuration structure
+ * @param[out] img: Output image info
+ *
+ * @note The output image can be mirrored (cfg->flags.mirror_x, cfg->flags.mirror_y) and rotated (cfg->out_rotation)
+ *       while decoding. Width and height of the output image are swapped for 90 and 270 degrees rotation.
+ *       Output stride and position apply to the rotated image.
+ *
+ * @note The image can be decoded into a sub-rectangle of a larger framebuffer by setting cfg->out_stride
+ *       to the framebuffer width and cfg->out_x, cfg->out_y to the position of the image. Only the pixels
+ *       of the image are written, the rest of the framebuffer is not touched.
+ *       cfg->outbuf_size must cover the framebuffer up to the last pixel of the image.
+ *
+ * @note With CONFIG_JD_PROFILE, CPU cycles spent in each decoding stage and the number of decoded MCUs
+ *       and blocks are returned in img->profile.
+ *
+ * @note If cfg->flags.luma_stats is set, statistics of the luma (Y) samples are collected while decoding
+ *       and returned in img->luma, together with an optional histogram in cfg->advanced.luma_histogram.
+ *       Statistics are always taken from the full size image, regardless of cfg->out_scale
+ *       (with JPEG_IMAGE_SCALE_1_8 only the mean luma of each 8x8 block is available).
+ *
+ * @note With CONFIG_JD_PROGRESSIVE, progressive JPEG images are decoded too. All scans are decoded into a coefficient
+ *       buffer first, then the image is output. If cfg->advanced.preview_cb is set, the image decoded so far is output
+ *       after each scan but the last one (the first preview has only the mean color of each 8x8 block).
+ *
+ * @return
+ *      - ESP_OK                on success
+ *      - ESP_ERR_NO_MEM        if there is no memory for allocating main structure or the coefficient buffer
+ *      - ESP_ERR_INVALID_SIZE  if cfg->advanced.coef_buffer_size is too small for the progressive image
+ *      - ESP_ERR_INVALID_ARG   if luma histogram has unsupported number of bins or the image does not fit in cfg->out_stride
+ *      - ESP_ERR_NOT_SUPPORTED if luma statistics are requested and the decoder from ROM is used,
+ *                              or if cfg->advanced.decoder is JPEG_DECODER_FAST and the faster decoder is not built
+ *      - ESP_FAIL              if there is an error in decoding JPEG
+ */
+esp_err_t esp_jpeg_decode(esp_jpeg_image_cfg_t *cfg, esp_jpeg_image_output_t *img);
+
+/**
+ * @brief Get information about the JPEG image
+ *
+ * Use this function to get the size of the JPEG image without decoding it.
+ * Allocate a buffer of size img->output_len to store the decoded image.
+ *
+ * @note cfg->outbuf and cfg->outbuf_size are not used in this function.
+ * @param[in]  cfg: Configuration structure
+ * @param[out] img: Output image info
+ *
+ * @return
+ *      - ESP_OK              on success
+ *      - ESP_ERR_INVALID_ARG if cfg or img is NULL
+ *      - ESP_FAIL            if there is an error in decoding JPEG
+ */
+esp_err_t esp_jpeg_get_image_info(esp_jpeg_image_cfg_t *cfg, esp_jpeg_image_output_t *img);
+
+/**
+ * @brief Get size of the working buffer needed to decode the JPEG image
+ *
+ * Only the headers of the image (DHT, DQT, SOF and SOS segments) are parsed, nothing is allocated.
+ * For a progressive JPEG, the whole image is read to find the tables defined between the scans.
+ * The size depends on the image (Huffman and quantization tables, chroma subsampling) and on the
+ * decoder configuration (JD_SZBUF, JD_FASTDECODE).
+ * With cfg->advanced.decoder set to JPEG_DECODER_FAST, the size for the faster decoder is returned,
+ * otherwise the size for the default decoder.
+ *
+ * @note Only the input image (cfg->indata and cfg->indata_size, or cfg->insegments) and cfg->advanced.decoder are used in this function.
+ * @param[in]  cfg:  Configuration structure
+ * @param[out] size: Size of the working buffer in bytes
+ *
+ * @return
+ *      - ESP_OK                on success
+ *      - ESP_ERR_INVALID_ARG   if cfg or size is NULL
+ *      - ESP_ERR_NOT_SUPPORTED if the decoder from ROM is used, or the faster decoder is requested and not built
+ *      - ESP_FAIL              if there is an error in parsing JPEG
+ */
+esp_err_t esp_jpeg_get_work_buffer_size(esp_jpeg_image_cfg_t *cfg, size_t *size);
+
+/**
+ * @brief Get size of the coefficient buffer needed to decode the progressive JPEG image
+ *
+ * Only the headers of the image are parsed, nothing is allocated. The size is 0 for a baseline JPEG image.
+ *
+ * @note Only the input image (cfg->indata and cfg->indata_size, or cfg->insegments) is used in this function.
+ * @param[in]  cfg:  Configuration structure
+ * @param[out] size: Size of the coefficient buffer in bytes
+ *
+ * @return
+ *      - ESP_OK                on success
+ *      - ESP_ERR_INVALID_ARG   if cfg or size is NULL
+ *      - ESP_ERR_NOT_SUPPORTED if CONFIG_JD_PROGRESSIVE is not enabled
+ *      - ESP_FAIL              if there is an error in parsing JPEG
+ */
+esp_err_t esp_jpeg_get_coef_buffer_size(esp_jpeg_image_cfg_t *cfg, size_t *size);
+
+/**
+ * @brief Get luma DC signature of the JPEG image
+ *
+ * Only the entropy coded data is decoded, IDCT, color conversion and output are skipped.
+ * This is much cheaper than esp_jpeg_decode() and is intended for change detection between frames.
+ * If sig->blocks is NULL, only sig->blocks_w and sig->blocks_h are filled in.
+ * Allocate a buffer of sig->blocks_w * sig->blocks_h bytes to get the signature.
+ *
+ * @note cfg->outbuf, cfg->outbuf_size, cfg->out_format and cfg->out_scale are not used in this function.
+ * @param[in]     cfg: Configuration structure
+ * @param[in,out] sig: DC signature
+ *
+ * @return
+ *      - ESP_OK                on success
+ *      - ESP_ERR_INVALID_ARG   if cfg or sig is NULL
+ *      - ESP_ERR_INVALID_SIZE  if sig->blocks_size is too small
+ *      - ESP_ERR_NO_MEM        if there is no memory for allocating working buffer
+ *      - ESP_ERR_NOT_SUPPORTED if the decoder from ROM is used, or the faster decoder is requested and not built
+ *      - ESP_FAIL              if there is an error in decoding JPEG
+ */
+esp_err_t esp_jpeg_get_dc_signature(esp_jpeg_image_cfg_t *cfg, esp_jpeg_dc_signature_t *sig);
+
+/**
+ * @brief Compare two DC signatures
+ *
+ * @param[in]  prev:        Reference signature
+ * @param[in]  cur:         Current signature
+ * @param[in]  threshold:   Minimal mean luminance difference of a block to count it as changed
+ * @param[out] changed_map: Optional map of changed blocks (1 byte per block, 1 = changed). Can be NULL
+ * @param[out] motion:      Comparison result
+ *
+ * @return
+ *      - ESP_OK               on success
+ *      - ESP_ERR_INVALID_ARG  if any of prev, cur or motion is NULL
+ *      - ESP_ERR_INVALID_SIZE if the signatures have different dimensions
+ */
+esp_err_t esp_jpeg_compare_dc_signature(const esp_jpeg_dc_signature_t *prev, const esp_jpeg_dc_signature_t *cur,
+                                        uint8_t threshold, uint8_t *changed_map, esp_jpeg_motion_t *motion);
+
+/**
+ * @brief Build MCU row index of the JPEG image
+ *
+ * Only the entropy coded data is decoded. The decoding state is saved at the top of every
+ * index->interval MCU rows. If index->marks is NULL, only the size of the index is filled in.
+ * Allocate index->mark_count entries for index->marks to get the index.
+ *
+ * @note cfg->outbuf, cfg->outbuf_size, cfg->out_format and cfg->out_scale are not used in this function.
+ * @param[in]     cfg:   Configuration structure
+ * @param[in,out] index: Row index
+ *
+ * @return
+ *      - ESP_OK                on success
+ *      - ESP_ERR_INVALID_ARG   if cfg or index is NULL, or index->interval is 0
+ *      - ESP_ERR_INVALID_SIZE  if index->marks_size is too small
+ *      - ESP_ERR_NO_MEM        if there is no memory for allocating working buffer
+ *      - ESP_ERR_NOT_SUPPORTED if the decoder from ROM is used
+ *      - ESP_FAIL              if there is an error in decoding JPEG
+ */
+esp_err_t esp_jpeg_get_row_index(esp_jpeg_image_cfg_t *cfg, esp_jpeg_row_index_t *index);
+
+/**
+ * @brief Decode a band of MCU rows of the JPEG image
+ *
+ * Decoding starts from the nearest saved state above the band, rows between the state and the band
+ * are only entropy decoded. The band is output as an image of its own: img->height is the height of
+ * the band, and all options of esp_jpeg_decode() (scale, rotation, stride, ...) apply to it.
+ *
+ * @param[in]  cfg:       Configuration structure
+ * @param[in]  index:     Row index of the image (see esp_jpeg_get_row_index())
+ * @param[in]  first_row: First MCU row of the band
+ * @param[in]  row_count: Number of MCU rows of the band (0: to the bottom of the image)
+ * @param[out] img:       Output image info
+ *
+ * @return
+ *      - ESP_OK                on success
+ *      - ESP_ERR_INVALID_ARG   if the index does not match the image or first_row is out of the image
+ *      - ESP_ERR_NOT_SUPPORTED if the decoder from ROM is used
+ *      - Other errors as esp_jpeg_decode()
+ */
+esp_err_t esp_jpeg_decode_rows(esp_jpeg_image_cfg_t *cfg, const esp_jpeg_row_index_t *index, uint16_t first_row, uint16_t row_count,
+                               esp_jpeg_image_output_t *img);
+
+/**
+ * @brief Serialize MCU row index
+ *
+ * The index is stored in a portable little-endian format, e.g. to keep it next to the image file.
+ * If buf is NULL, only the size is returned in len.
+ *
+ * @param[in]  index:    Row index
+ * @param[out] buf:      Output buffer. Can be NULL
+ * @param[in]  buf_size: Size of the output buffer
+ * @param[out] len:      Size of the serialized index
+ *
+ * @return
+ *      - ESP_OK               on success
+ *      - ESP_ERR_INVALID_ARG  if index or len is NULL
+ *      - ESP_ERR_INVALID_SIZE if buf_size is too small
+ */
+esp_err_t esp_jpeg_row_index_serialize(const esp_jpeg_row_index_t *index, uint8_t *buf, size_t buf_size, size_t *len);
+
+/**
+ * @brief Deserialize MCU row index
+ *
+ * If index->marks is NULL, only the header is parsed. Allocate index->mark_count entries
+ * for index->marks to get the whole index.
+ *
+ * @param[in]     buf:   Serialized index (see esp_jpeg_row_index_serialize())
+ * @param[in]     len:   Size of the serialized index
+ * @param[in,out] index: Row index
+ *
+ * @return
+ *      - ESP_OK                    on success
+ *      - ESP_ERR_INVALID_ARG       if buf or index is NULL
+ *      - ESP_ERR_INVALID_SIZE      if len or index->marks_size is too small
+ *      - ESP_ERR_INVALID_VERSION   if the index was built with a different format or decoder configuration
+ */
+esp_err_t esp_jpeg_row_index_deserialize(const uint8_t *buf, size_t len, esp_jpeg_row_index_t *index);
+
+#ifdef __cplusplus
+}
+#endif
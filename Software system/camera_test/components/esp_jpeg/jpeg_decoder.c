@@ -0,0 +1,1022 @@
+/*
+ * SPDX-FileCopyrightText: 2015-2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+#include "esp_rom_caps.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_check.h"
+#include "esp_assert.h"
+#include "jpeg_decoder.h"
+
+#if CONFIG_JD_USE_ROM
+/* When supported in ROM, use ROM functions */
+#if defined(ESP_ROM_HAS_JPEG_DECODE)
+#include "rom/tjpgd.h"
+#else
+#error Using JPEG decoder from ROM is not supported for selected target. Please select external code in menuconfig.
+#endif
+
+/* The ROM code of TJPGD is older and has different return type in decode callback */
+typedef unsigned int jpeg_decode_out_t;
+
+/* and different size type in input callback */
+typedef unsigned int jpeg_decode_in_size_t;
+
+/* Row index is not supported with the decoder from ROM */
+#define JPEG_ROW_MARK_FORMAT    0
+#else
+/* When Tiny JPG Decoder is not in ROM or selected external code */
+#include "tjpgd.h"
+
+/* The TJPGD outside the ROM code is newer and has different return type in decode callback */
+typedef int jpeg_decode_out_t;
+
+/* and different size type in input callback (same as unsigned int on the device, not on 64-bit Linux) */
+typedef size_t jpeg_decode_in_size_t;
+
+/* Entry points of one build of the decoder */
+typedef struct {
+    JRESULT (*prepare)(JDEC *jd, size_t (*infunc)(JDEC *, uint8_t *, size_t), void *pool, size_t sz_pool, void *dev);
+    JRESULT (*decomp_rows)(JDEC *jd, int (*outfunc)(JDEC *, void *, JRECT *), uint8_t scale, const JMARK *mark, unsigned int top, unsigned int nrow);
+    JRESULT (*dcscan)(JDEC *jd, uint8_t *dcmap);
+    JRESULT (*index)(JDEC *jd, JMARK *mark, unsigned int nmark, unsigned int nrow);
+    JRESULT (*poolsize)(JDEC *jd, size_t (*infunc)(JDEC *, uint8_t *, size_t), void *dev, size_t *sz_pool);
+#if CONFIG_JD_PROGRESSIVE
+    JRESULT (*scan)(JDEC *jd, int16_t *coef);
+    size_t (*coefsize)(JDEC *jd);
+#endif
+} jpeg_decoder_ops_t;
+
+/* Entry points for progressive JPEG are built only with CONFIG_JD_PROGRESSIVE */
+#if CONFIG_JD_PROGRESSIVE
+#define JPEG_PROGRESSIVE_OPS(scan, coefsize)    , scan, coefsize
+#else
+#define JPEG_PROGRESSIVE_OPS(scan, coefsize)
+#endif
+
+static const jpeg_decoder_ops_t jpeg_decoder_ops[] = {
+    [JPEG_DECODER_DEFAULT] = { jd_prepare, jd_decomp_rows, jd_dcscan, jd_index, jd_poolsize JPEG_PROGRESSIVE_OPS(jd_scan, jd_coefsize) },
+#if CONFIG_JD_FAST_VARIANT
+    [JPEG_DECODER_FAST] = { jd_fast_prepare, jd_fast_decomp_rows, jd_fast_dcscan, jd_fast_index, jd_fast_poolsize JPEG_PROGRESSIVE_OPS(jd_fast_scan, jd_fast_coefsize) },
+#endif
+};
+
+/* Row marks are passed to the decoder as they are */
+ESP_STATIC_ASSERT(sizeof(esp_jpeg_row_mark_t) == sizeof(JMARK), "esp_jpeg_row_mark_t must match JMARK");
+ESP_STATIC_ASSERT(offsetof(esp_jpeg_row_mark_t, dc) == offsetof(JMARK, dcv), "esp_jpeg_row_mark_t must match JMARK");
+
+/* Decoder state in row marks: bit mask and current byte (JD_FASTDECODE == 0) or shift register */
+#define JPEG_ROW_MARK_FORMAT    (JD_FASTDECODE ? 1 : 0)
+#endif
+
+/* Serialized row index: header followed by the marks, little-endian */
+#define JPEG_ROW_INDEX_MAGIC        0x5849524A  /* "JRIX" */
+#define JPEG_ROW_INDEX_VERSION      1
+#define JPEG_ROW_INDEX_HEADER_SIZE  18
+#define JPEG_ROW_INDEX_MARK_SIZE    22
+
+static const char *TAG = "JPEG";
+
+#define LOBYTE(u16)     ((uint8_t)(((uint16_t)(u16)) & 0xff))
+#define HIBYTE(u16)     ((uint8_t)((((uint16_t)(u16))>>8) & 0xff))
+
+/* Working buffer size for the decoder from ROM. With external code, the exact size is computed for each image (esp_jpeg_get_work_buffer_size()) */
+#define JPEG_WORK_BUF_SIZE  3100    /* Recommended buffer size; Independent on the size of the image */
+
+/* If not set JD_FORMAT, it is set in ROM to RGB888, otherwise, it can be set in config */
+#ifndef JD_FORMAT
+#define JD_FORMAT 0
+#endif
+
+/* Output color bytes from tjpgd (depends on JD_FORMAT) */
+#if (JD_FORMAT==0)
+#define ESP_JPEG_COLOR_BYTES    3
+#elif  (JD_FORMAT==1)
+#define ESP_JPEG_COLOR_BYTES    2
+#elif  (JD_FORMAT==2)
+#error Grayscale image output format is not supported
+#define ESP_JPEG_COLOR_BYTES    1
+#endif
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+static void jpeg_set_output_steps(esp_jpeg_image_cfg_t *cfg, uint32_t out_w, uint32_t out_h, uint32_t line, uint8_t out_color_bytes);
+static uint8_t jpeg_get_div_by_scale(esp_jpeg_image_scale_t scale);
+static uint8_t jpeg_get_color_bytes(esp_jpeg_image_format_t format);
+#if !CONFIG_JD_USE_ROM
+static esp_err_t jpeg_select_decoder(esp_jpeg_image_cfg_t *cfg, bool allocate_buffer, size_t *workbuf_size, esp_jpeg_decoder_t *decoder);
+static JRESULT jpeg_prepare(esp_jpeg_image_cfg_t *cfg, JDEC *jd, uint8_t *workbuf, size_t workbuf_size, esp_jpeg_decoder_t *decoder);
+#endif
+
+static jpeg_decode_in_size_t jpeg_decode_in_cb(JDEC *jd, uint8_t *buff, jpeg_decode_in_size_t nbyte);
+static void jpeg_input_seek(esp_jpeg_image_cfg_t *cfg, uint32_t ofs);
+static uint32_t jpeg_input_read(esp_jpeg_image_cfg_t *cfg, uint8_t *buff, uint32_t nbyte);
+static jpeg_decode_out_t jpeg_decode_out_cb(JDEC *jd, void *bitmap, JRECT *rect);
+static void jpeg_write_rgb32(esp_jpeg_image_cfg_t *cfg, const uint8_t *in, const JRECT *rect, uint32_t in_skip);
+#if !CONFIG_JD_USE_ROM
+static void jpeg_luma_stats_cb(JDEC *dec, const jd_yuv_t *mcubuf, const JRECT *rect);
+#endif
+static esp_err_t jpeg_decode(esp_jpeg_image_cfg_t *cfg, const esp_jpeg_row_index_t *index, uint16_t first_row, uint16_t row_count,
+                             esp_jpeg_image_output_t *img);
+static esp_err_t jpeg_read_sof(esp_jpeg_image_cfg_t *cfg, uint8_t *sof, uint8_t *type);
+static inline uint16_t ldb_word(const void *ptr);
+static inline uint16_t ldl_word(const uint8_t *p);
+static inline uint32_t ldl_dword(const uint8_t *p);
+static inline void stl_word(uint8_t *p, uint16_t v);
+static inline void stl_dword(uint8_t *p, uint32_t v);
+/*******************************************************************************
+* Public API functions
+*******************************************************************************/
+
+esp_err_t esp_jpeg_decode(esp_jpeg_image_cfg_t *cfg, esp_jpeg_image_output_t *img)
+{
+    return jpeg_decode(cfg, NULL, 0, 0, img);
+}
+
+esp_err_t esp_jpeg_get_image_info(esp_jpeg_image_cfg_t *cfg, esp_jpeg_image_output_t *img)
+{
+    if (cfg == NULL || img == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint8_t seg[8];     /* Start of SOF segment */
+    uint8_t type;
+
+    esp_err_t ret = jpeg_read_sof(cfg, seg, &type);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    /* Size of output image */
+    img->height = ldb_word(seg + 1);
+    img->width = ldb_word(seg + 3);
+    const uint8_t scale_div       = jpeg_get_div_by_scale(cfg->out_scale);
+    const uint8_t out_color_bytes = jpeg_get_color_bytes(cfg->out_format);
+    img->output_len = (img->height / scale_div) * (img->width / scale_div) * out_color_bytes;
+    if (cfg->out_rotation == JPEG_IMAGE_ROTATE_90 || cfg->out_rotation == JPEG_IMAGE_ROTATE_270) {
+        const uint16_t tmp = img->height;
+        img->height = img->width;
+        img->width = tmp;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_jpeg_get_work_buffer_size(esp_jpeg_image_cfg_t *cfg, size_t *size)
+{
+    ESP_RETURN_ON_FALSE(cfg && size, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+#if CONFIG_JD_USE_ROM
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    JDEC JDEC;
+
+#if !CONFIG_JD_FAST_VARIANT
+    ESP_RETURN_ON_FALSE(cfg->advanced.decoder != JPEG_DECODER_FAST, ESP_ERR_NOT_SUPPORTED, TAG, "Fast decoder not built!");
+#endif
+    const esp_jpeg_decoder_t decoder = (cfg->advanced.decoder == JPEG_DECODER_FAST) ? JPEG_DECODER_FAST : JPEG_DECODER_DEFAULT;
+
+    jpeg_input_seek(cfg, 0);
+    JRESULT res = jpeg_decoder_ops[decoder].poolsize(&JDEC, jpeg_decode_in_cb, cfg, size);
+    ESP_RETURN_ON_FALSE((res == JDR_OK), ESP_FAIL, TAG, "Error in parsing JPEG image! %d", res);
+    return ESP_OK;
+#endif
+}
+
+esp_err_t esp_jpeg_get_coef_buffer_size(esp_jpeg_image_cfg_t *cfg, size_t *size)
+{
+    ESP_RETURN_ON_FALSE(cfg && size, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+#if !CONFIG_JD_PROGRESSIVE
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    uint8_t sof[8];
+    uint8_t type;
+
+    ESP_RETURN_ON_ERROR(jpeg_read_sof(cfg, sof, &type), TAG, "Error in parsing JPEG image!");
+    *size = 0;
+    if (type == 0xC2) {
+        /* Same as jd_coefsize(): Y blocks of the MCUs and one Cb and Cr block per MCU, 64 coefficients of 2 bytes per block */
+        const uint32_t msx = sof[7] >> 4;
+        const uint32_t msy = sof[7] & 15;
+        ESP_RETURN_ON_FALSE(msx && msy, ESP_FAIL, TAG, "Error in parsing JPEG image!");
+        const size_t mcus = (size_t)((ldb_word(sof + 3) + msx * 8 - 1) / (msx * 8)) * ((ldb_word(sof + 1) + msy * 8 - 1) / (msy * 8));
+        *size = mcus * (msx * msy + (sof[5] == 3 ? 2 : 0)) * 64 * sizeof(int16_t);
+    }
+    return ESP_OK;
+#endif
+}
+
+esp_err_t esp_jpeg_get_dc_signature(esp_jpeg_image_cfg_t *cfg, esp_jpeg_dc_signature_t *sig)
+{
+    ESP_RETURN_ON_FALSE(cfg && sig, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+#if CONFIG_JD_USE_ROM
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    esp_err_t ret = ESP_OK;
+    uint8_t *workbuf = NULL;
+    JRESULT res;
+    JDEC JDEC;
+    esp_jpeg_decoder_t decoder;
+
+    const bool allocate_buffer = (cfg->advanced.working_buffer == NULL);
+    size_t workbuf_size = cfg->advanced.working_buffer_size;
+    ESP_RETURN_ON_ERROR(jpeg_select_decoder(cfg, allocate_buffer, &workbuf_size, &decoder), TAG, "Error in selecting JPEG decoder!");
+    if (allocate_buffer) {
+        workbuf = heap_caps_malloc(workbuf_size, MALLOC_CAP_DEFAULT);
+        ESP_GOTO_ON_FALSE(workbuf, ESP_ERR_NO_MEM, err, TAG, "no mem for JPEG work buffer");
+    } else {
+        workbuf = cfg->advanced.working_buffer;
+        ESP_RETURN_ON_FALSE(workbuf_size != 0, ESP_ERR_INVALID_ARG, TAG, "Working buffer size not defined!");
+    }
+
+    /* Prepare image */
+    res = jpeg_prepare(cfg, &JDEC, workbuf, workbuf_size, &decoder);
+    ESP_GOTO_ON_FALSE((res == JDR_OK), ESP_FAIL, err, TAG, "Error in preparing JPEG image! %d", res);
+    const jpeg_decoder_ops_t *ops = &jpeg_decoder_ops[decoder];
+#if CONFIG_JD_PROGRESSIVE
+    ESP_GOTO_ON_FALSE(!JDEC.progressive, ESP_ERR_NOT_SUPPORTED, err, TAG, "DC signature not supported for progressive JPEG!");
+#endif
+
+    /* Size of the block map (image padded to whole MCUs) */
+    const unsigned int mx = JDEC.msx * 8;
+    const unsigned int my = JDEC.msy * 8;
+    sig->blocks_w = (JDEC.width + mx - 1) / mx * JDEC.msx;
+    sig->blocks_h = (JDEC.height + my - 1) / my * JDEC.msy;
+    if (sig->blocks == NULL) {
+        goto err;
+    }
+    ESP_GOTO_ON_FALSE((sig->blocks_w * sig->blocks_h <= sig->blocks_size), ESP_ERR_INVALID_SIZE, err, TAG, "Not enough size in signature buffer!");
+
+    /* Entropy decode only */
+    res = ops->dcscan(&JDEC, sig->blocks);
+    ESP_GOTO_ON_FALSE((res == JDR_OK), ESP_FAIL, err, TAG, "Error in scanning JPEG image! %d", res);
+
+err:
+    if (workbuf && allocate_buffer) {
+        free(workbuf);
+    }
+
+    return ret;
+#endif
+}
+
+esp_err_t esp_jpeg_compare_dc_signature(const esp_jpeg_dc_signature_t *prev, const esp_jpeg_dc_signature_t *cur,
+                                        uint8_t threshold, uint8_t *changed_map, esp_jpeg_motion_t *motion)
+{
+    ESP_RETURN_ON_FALSE(prev && cur && motion && prev->blocks && cur->blocks, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(prev->blocks_w == cur->blocks_w && prev->blocks_h == cur->blocks_h, ESP_ERR_INVALID_SIZE, TAG, "Signature size mismatch");
+
+    const uint32_t n = cur->blocks_w * cur->blocks_h;
+    uint32_t changed = 0;
+    uint32_t score = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const int diff = abs((int)cur->blocks[i] - (int)prev->blocks[i]);
+        const bool is_changed = (diff > threshold);
+        score += diff;
+        changed += is_changed;
+        if (changed_map) {
+            changed_map[i] = is_changed;
+        }
+    }
+
+    motion->changed_blocks = changed;
+    motion->total_blocks = n;
+    motion->score = score;
+    return ESP_OK;
+}
+
+esp_err_t esp_jpeg_decode_rows(esp_jpeg_image_cfg_t *cfg, const esp_jpeg_row_index_t *index, uint16_t first_row, uint16_t row_count,
+                               esp_jpeg_image_output_t *img)
+{
+    ESP_RETURN_ON_FALSE(cfg && index && img, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+#if CONFIG_JD_USE_ROM
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    return jpeg_decode(cfg, index, first_row, row_count, img);
+#endif
+}
+
+esp_err_t esp_jpeg_get_row_index(esp_jpeg_image_cfg_t *cfg, esp_jpeg_row_index_t *index)
+{
+    ESP_RETURN_ON_FALSE(cfg && index && index->interval, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+#if CONFIG_JD_USE_ROM
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    esp_err_t ret = ESP_OK;
+    uint8_t *workbuf = NULL;
+    JRESULT res;
+    JDEC JDEC;
+    esp_jpeg_decoder_t decoder;
+
+    const bool allocate_buffer = (cfg->advanced.working_buffer == NULL);
+    size_t workbuf_size = cfg->advanced.working_buffer_size;
+    ESP_RETURN_ON_ERROR(jpeg_select_decoder(cfg, allocate_buffer, &workbuf_size, &decoder), TAG, "Error in selecting JPEG decoder!");
+    if (allocate_buffer) {
+        workbuf = heap_caps_malloc(workbuf_size, MALLOC_CAP_DEFAULT);
+        ESP_GOTO_ON_FALSE(workbuf, ESP_ERR_NO_MEM, err, TAG, "no mem for JPEG work buffer");
+    } else {
+        workbuf = cfg->advanced.working_buffer;
+        ESP_RETURN_ON_FALSE(workbuf_size != 0, ESP_ERR_INVALID_ARG, TAG, "Working buffer size not defined!");
+    }
+
+    /* Prepare image */
+    res = jpeg_prepare(cfg, &JDEC, workbuf, workbuf_size, &decoder);
+    ESP_GOTO_ON_FALSE((res == JDR_OK), ESP_FAIL, err, TAG, "Error in preparing JPEG image! %d", res);
+    const jpeg_decoder_ops_t *ops = &jpeg_decoder_ops[decoder];
+#if CONFIG_JD_PROGRESSIVE
+    ESP_GOTO_ON_FALSE(!JDEC.progressive, ESP_ERR_NOT_SUPPORTED, err, TAG, "Row index not supported for progressive JPEG!");
+#endif
+
+    /* Size of the index */
+    index->width = JDEC.width;
+    index->height = JDEC.height;
+    index->mcu_height = JDEC.msy * 8;
+    index->mcu_rows = (JDEC.height + index->mcu_height - 1) / index->mcu_height;
+    index->mark_count = (index->mcu_rows + index->interval - 1) / index->interval;
+    if (index->marks == NULL) {
+        goto err;
+    }
+    ESP_GOTO_ON_FALSE((index->mark_count <= index->marks_size), ESP_ERR_INVALID_SIZE, err, TAG, "Not enough size in row index buffer!");
+
+    /* Entropy decode only */
+    res = ops->index(&JDEC, (JMARK *)index->marks, index->marks_size, index->interval);
+    ESP_GOTO_ON_FALSE((res == JDR_OK), ESP_FAIL, err, TAG, "Error in indexing JPEG image! %d", res);
+
+err:
+    if (workbuf && allocate_buffer) {
+        free(workbuf);
+    }
+
+    return ret;
+#endif
+}
+
+esp_err_t esp_jpeg_row_index_serialize(const esp_jpeg_row_index_t *index, uint8_t *buf, size_t buf_size, size_t *len)
+{
+    ESP_RETURN_ON_FALSE(index && len, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(index->marks || index->mark_count == 0, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    *len = JPEG_ROW_INDEX_HEADER_SIZE + index->mark_count * JPEG_ROW_INDEX_MARK_SIZE;
+    if (buf == NULL) {
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_FALSE(*len <= buf_size, ESP_ERR_INVALID_SIZE, TAG, "Not enough size in output buffer!");
+
+    stl_dword(buf, JPEG_ROW_INDEX_MAGIC);
+    buf[4] = JPEG_ROW_INDEX_VERSION;
+    buf[5] = JPEG_ROW_MARK_FORMAT;
+    stl_word(buf + 6, index->interval);
+    stl_word(buf + 8, index->width);
+    stl_word(buf + 10, index->height);
+    stl_word(buf + 12, index->mcu_height);
+    stl_word(buf + 14, index->mcu_rows);
+    stl_word(buf + 16, index->mark_count);
+    uint8_t *p = buf + JPEG_ROW_INDEX_HEADER_SIZE;
+    for (uint16_t i = 0; i < index->mark_count; i++, p += JPEG_ROW_INDEX_MARK_SIZE) {
+        const esp_jpeg_row_mark_t *m = &index->marks[i];
+        stl_dword(p, m->offset);
+        stl_dword(p + 4, m->bits);
+        p[8] = m->bit_state;
+        p[9] = m->marker;
+        stl_word(p + 10, m->row);
+        stl_word(p + 12, m->restart_mcus);
+        stl_word(p + 14, m->restart_num);
+        stl_word(p + 16, (uint16_t)m->dc[0]);
+        stl_word(p + 18, (uint16_t)m->dc[1]);
+        stl_word(p + 20, (uint16_t)m->dc[2]);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_jpeg_row_index_deserialize(const uint8_t *buf, size_t len, esp_jpeg_row_index_t *index)
+{
+    ESP_RETURN_ON_FALSE(buf && index, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(len >= JPEG_ROW_INDEX_HEADER_SIZE, ESP_ERR_INVALID_SIZE, TAG, "Row index too short");
+    ESP_RETURN_ON_FALSE(ldl_dword(buf) == JPEG_ROW_INDEX_MAGIC && buf[4] == JPEG_ROW_INDEX_VERSION && buf[5] == JPEG_ROW_MARK_FORMAT,
+                        ESP_ERR_INVALID_VERSION, TAG, "Unsupported row index");
+
+    const uint16_t mark_count = ldl_word(buf + 16);
+    ESP_RETURN_ON_FALSE(len >= JPEG_ROW_INDEX_HEADER_SIZE + (size_t)mark_count * JPEG_ROW_INDEX_MARK_SIZE, ESP_ERR_INVALID_SIZE, TAG, "Row index too short");
+    index->interval = ldl_word(buf + 6);
+    index->width = ldl_word(buf + 8);
+    index->height = ldl_word(buf + 10);
+    index->mcu_height = ldl_word(buf + 12);
+    index->mcu_rows = ldl_word(buf + 14);
+    index->mark_count = mark_count;
+    if (index->marks == NULL) {
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_FALSE(mark_count <= index->marks_size, ESP_ERR_INVALID_SIZE, TAG, "Not enough size in row index buffer!");
+
+    const uint8_t *p = buf + JPEG_ROW_INDEX_HEADER_SIZE;
+    for (uint16_t i = 0; i < mark_count; i++, p += JPEG_ROW_INDEX_MARK_SIZE) {
+        esp_jpeg_row_mark_t *m = &index->marks[i];
+        m->offset = ldl_dword(p);
+        m->bits = ldl_dword(p + 4);
+        m->bit_state = p[8];
+        m->marker = p[9];
+        m->row = ldl_word(p + 10);
+        m->restart_mcus = ldl_word(p + 12);
+        m->restart_num = ldl_word(p + 14);
+        m->dc[0] = (int16_t)ldl_word(p + 16);
+        m->dc[1] = (int16_t)ldl_word(p + 18);
+        m->dc[2] = (int16_t)ldl_word(p + 20);
+    }
+    return ESP_OK;
+}
+
+/*******************************************************************************
+* Private API functions
+*******************************************************************************/
+
+static esp_err_t jpeg_decode(esp_jpeg_image_cfg_t *cfg, const esp_jpeg_row_index_t *index, uint16_t first_row, uint16_t row_count,
+                             esp_jpeg_image_output_t *img)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t *workbuf = NULL;
+#if CONFIG_JD_PROGRESSIVE
+    int16_t *coef = NULL;
+#endif
+    JRESULT res;
+    JDEC JDEC;
+
+    assert(cfg != NULL);
+    assert(img != NULL);
+
+    const bool allocate_buffer = (cfg->advanced.working_buffer == NULL);
+    size_t workbuf_size = allocate_buffer ? JPEG_WORK_BUF_SIZE : cfg->advanced.working_buffer_size;
+#if CONFIG_JD_USE_ROM
+    ESP_RETURN_ON_FALSE(cfg->advanced.decoder != JPEG_DECODER_FAST, ESP_ERR_NOT_SUPPORTED, TAG, "Fast decoder not supported with ROM decoder!");
+    img->decoder = JPEG_DECODER_DEFAULT;
+#else
+    /* Pick the decoder, and the size of the buffer to allocate for it */
+    ESP_RETURN_ON_ERROR(jpeg_select_decoder(cfg, allocate_buffer, &workbuf_size, &img->decoder), TAG, "Error in selecting JPEG decoder!");
+#endif
+    if (allocate_buffer) {
+        workbuf = heap_caps_malloc(workbuf_size, MALLOC_CAP_DEFAULT);
+        ESP_GOTO_ON_FALSE(workbuf, ESP_ERR_NO_MEM, err, TAG, "no mem for JPEG work buffer");
+    } else {
+        workbuf = cfg->advanced.working_buffer;
+        ESP_RETURN_ON_FALSE(workbuf_size != 0, ESP_ERR_INVALID_ARG, TAG, "Working buffer size not defined!");
+    }
+
+    if (cfg->flags.luma_stats) {
+#if CONFIG_JD_USE_ROM
+        ESP_GOTO_ON_FALSE(false, ESP_ERR_NOT_SUPPORTED, err, TAG, "Luma statistics not supported with ROM decoder!");
+#else
+        ESP_GOTO_ON_FALSE(cfg->advanced.luma_histogram == NULL || cfg->advanced.luma_histogram_bins == 256 || cfg->advanced.luma_histogram_bins == 64,
+                          ESP_ERR_INVALID_ARG, err, TAG, "Luma histogram must have 256 or 64 bins!");
+        if (cfg->advanced.luma_histogram) {
+            memset(cfg->advanced.luma_histogram, 0, cfg->advanced.luma_histogram_bins * sizeof(uint32_t));
+        }
+        cfg->priv.luma_sum = 0;
+        cfg->priv.luma_samples = 0;
+        cfg->priv.luma_min = 255;
+        cfg->priv.luma_max = 0;
+#endif
+    }
+
+    /* Prepare image */
+#if CONFIG_JD_USE_ROM
+    jpeg_input_seek(cfg, 0);
+    res = jd_prepare(&JDEC, jpeg_decode_in_cb, workbuf, workbuf_size, cfg);
+#else
+    res = jpeg_prepare(cfg, &JDEC, workbuf, workbuf_size, &img->decoder);
+#endif
+    ESP_GOTO_ON_FALSE((res == JDR_OK), ESP_FAIL, err, TAG, "Error in preparing JPEG image! %d", res);
+#if !CONFIG_JD_USE_ROM
+    const jpeg_decoder_ops_t *ops = &jpeg_decoder_ops[img->decoder];
+    if (cfg->flags.luma_stats) {
+        JDEC.mcufunc = jpeg_luma_stats_cb;
+    }
+#endif
+
+    /* Rows of the full size image to decode */
+    uint32_t band_top = 0;
+    uint32_t band_h = JDEC.height;
+#if !CONFIG_JD_USE_ROM
+    const JMARK *mark = NULL;
+    if (index) {
+#if CONFIG_JD_PROGRESSIVE
+        ESP_GOTO_ON_FALSE(!JDEC.progressive, ESP_ERR_NOT_SUPPORTED, err, TAG, "Row index not supported for progressive JPEG!");
+#endif
+        const uint16_t mcu_h = JDEC.msy * 8;
+        ESP_GOTO_ON_FALSE(index->width == JDEC.width && index->height == JDEC.height && index->mcu_height == mcu_h &&
+                          index->interval && index->marks && index->mark_count <= index->marks_size,
+                          ESP_ERR_INVALID_ARG, err, TAG, "Row index does not match the image!");
+        ESP_GOTO_ON_FALSE(first_row < index->mcu_rows && first_row / index->interval < index->mark_count,
+                          ESP_ERR_INVALID_ARG, err, TAG, "Row is out of the image!");
+        mark = (const JMARK *)&index->marks[first_row / index->interval];
+        band_top = first_row * mcu_h;
+        band_h = JDEC.height - band_top;
+        if (row_count && row_count * mcu_h < band_h) {
+            band_h = row_count * mcu_h;
+        }
+        jpeg_input_seek(cfg, mark->ofs);    /* Input continues from the saved decoding state */
+    }
+#endif
+
+    const uint8_t scale_div       = jpeg_get_div_by_scale(cfg->out_scale);
+    const uint8_t out_color_bytes = jpeg_get_color_bytes(cfg->out_format);
+    if (cfg->out_format != JPEG_IMAGE_FORMAT_RGB888 && cfg->out_format != JPEG_IMAGE_FORMAT_RGB565) {
+        /* BGR888 and 32-bit formats are made from RGB888 output of TJpgDec */
+        ESP_GOTO_ON_FALSE((JD_FORMAT == 0), ESP_ERR_NOT_SUPPORTED, err, TAG, "Output format needs JD_FORMAT RGB888!");
+        ESP_GOTO_ON_FALSE((out_color_bytes != 4 || ((uintptr_t)cfg->outbuf & 3) == 0), ESP_ERR_INVALID_ARG, err, TAG, "Output buffer must be 4-byte aligned!");
+    }
+
+    /* Size of output image */
+    const uint32_t outsize = (band_h / scale_div) * (JDEC.width / scale_div) * out_color_bytes;
+    const bool transpose = (cfg->out_rotation == JPEG_IMAGE_ROTATE_90 || cfg->out_rotation == JPEG_IMAGE_ROTATE_270);
+    const uint32_t out_w = transpose ? band_h / scale_div : JDEC.width / scale_div;
+    const uint32_t out_h = transpose ? JDEC.width / scale_div : band_h / scale_div;
+
+    /* Size of output buffer needed for the image at its position */
+    const uint32_t line = cfg->out_stride ? cfg->out_stride : out_w;
+    ESP_GOTO_ON_FALSE((cfg->out_x + out_w <= line), ESP_ERR_INVALID_ARG, err, TAG, "Output image does not fit in output stride!");
+    const uint32_t outbuf_used = out_h == 0 ? 0 : ((cfg->out_y + out_h - 1) * line + cfg->out_x + out_w) * out_color_bytes;
+    ESP_GOTO_ON_FALSE((outbuf_used <= cfg->outbuf_size), ESP_ERR_NO_MEM, err, TAG, "Not enough size in output buffer!");
+
+    /* Size of output image */
+    img->height = out_h;
+    img->width = out_w;
+    img->output_len = outsize;
+
+    /* Position of the first decoded pixel and steps to its neighbours in the output buffer */
+    jpeg_set_output_steps(cfg, out_w, out_h, line, out_color_bytes);
+    cfg->priv.out_top = band_top / scale_div;
+
+    img->scans = 1;
+#if CONFIG_JD_PROGRESSIVE
+    if (JDEC.progressive) {
+        /* Decode all scans into the coefficient buffer, the image is output from it */
+        const size_t coef_size = ops->coefsize(&JDEC);
+        if (cfg->advanced.coef_buffer) {
+            ESP_GOTO_ON_FALSE((cfg->advanced.coef_buffer_size >= coef_size), ESP_ERR_INVALID_SIZE, err, TAG, "Not enough size in coefficient buffer!");
+            coef = cfg->advanced.coef_buffer;
+        } else {
+            coef = heap_caps_malloc(coef_size, MALLOC_CAP_SPIRAM);
+            if (coef == NULL) {
+                coef = heap_caps_malloc(coef_size, MALLOC_CAP_DEFAULT);
+            }
+            ESP_GOTO_ON_FALSE(coef, ESP_ERR_NO_MEM, err, TAG, "no mem for JPEG coefficient buffer");
+        }
+        memset(coef, 0, coef_size);
+
+        void (*mcufunc)(struct JDEC *, const jd_yuv_t *, const JRECT *) = JDEC.mcufunc;
+        bool preview = (cfg->advanced.preview_cb != NULL);
+        do {
+            res = ops->scan(&JDEC, coef);
+            ESP_GOTO_ON_FALSE((res == JDR_OK), ESP_FAIL, err, TAG, "Error in decoding JPEG scan %d! %d", JDEC.nscan, res);
+            if (preview && JDEC.scomp) {
+                /* Output the image decoded so far, luma statistics are taken from the final image only */
+                JDEC.mcufunc = NULL;
+                res = ops->decomp_rows(&JDEC, jpeg_decode_out_cb, cfg->out_scale, NULL, 0, 0);
+                ESP_GOTO_ON_FALSE((res == JDR_OK), ESP_FAIL, err, TAG, "Error in decoding JPEG image! %d", res);
+                JDEC.mcufunc = mcufunc;
+                preview = cfg->advanced.preview_cb(cfg, JDEC.nscan, cfg->advanced.preview_arg);
+            }
+        } while (JDEC.scomp);
+        img->scans = JDEC.nscan;
+    }
+#endif
+
+    /* Tables redefined between the scans of a progressive JPEG are allocated by the scans */
+#if CONFIG_JD_USE_ROM
+    img->work_buffer_used = 0;
+#else
+    img->work_buffer_used = workbuf_size - JDEC.sz_pool;
+#endif
+
+    /* Decode JPEG */
+#if CONFIG_JD_USE_ROM
+    res = jd_decomp(&JDEC, jpeg_decode_out_cb, cfg->out_scale);
+#else
+    res = ops->decomp_rows(&JDEC, jpeg_decode_out_cb, cfg->out_scale, mark, first_row, row_count);
+#endif
+    ESP_GOTO_ON_FALSE((res == JDR_OK), ESP_FAIL, err, TAG, "Error in decoding JPEG image! %d", res);
+
+#if CONFIG_JD_PROFILE
+    img->profile.entropy_cycles = JDEC.prof.entropy;
+    img->profile.idct_cycles = JDEC.prof.idct;
+    img->profile.color_cycles = JDEC.prof.color;
+    img->profile.scale_cycles = JDEC.prof.scale;
+    img->profile.output_cycles = JDEC.prof.output;
+    img->profile.mcus = JDEC.prof.mcus;
+    img->profile.blocks = JDEC.prof.blocks;
+    img->profile.dc_blocks = JDEC.prof.dc_blocks;
+#else
+    memset(&img->profile, 0, sizeof(img->profile));
+#endif
+
+    if (cfg->flags.luma_stats) {
+        img->luma.samples = cfg->priv.luma_samples;
+        img->luma.min = cfg->priv.luma_min;
+        img->luma.max = cfg->priv.luma_max;
+        img->luma.mean = cfg->priv.luma_samples ? (cfg->priv.luma_sum + cfg->priv.luma_samples / 2) / cfg->priv.luma_samples : 0;
+    }
+
+err:
+#if CONFIG_JD_PROGRESSIVE
+    if (coef && coef != cfg->advanced.coef_buffer) {
+        free(coef);
+    }
+#endif
+    if (workbuf && allocate_buffer) {
+        free(workbuf);
+    }
+
+    return ret;
+}
+
+static esp_err_t jpeg_read_sof(esp_jpeg_image_cfg_t *cfg, uint8_t *sof, uint8_t *type)
+{
+    uint8_t seg[4];     /* Marker and length field */
+
+    if (cfg->insegments == NULL && (cfg->indata == NULL || cfg->indata_size < 5)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    jpeg_input_seek(cfg, 0);
+    if (jpeg_input_read(cfg, seg, 2) != 2 || ldb_word(seg) != 0xFFD8) {
+        return ESP_FAIL;    /* Err: SOI is not detected */
+    }
+
+    while (true) {
+        /* Get a JPEG marker */
+        if (jpeg_input_read(cfg, seg, 4) != 4) {
+            return ESP_FAIL; // No more data
+        }
+        unsigned short marker = ldb_word(seg);  /* Marker */
+        unsigned int len = ldb_word(seg + 2);   /* Length field */
+        if (len <= 2 || (marker >> 8) != 0xFF) {
+            return ESP_FAIL;
+        }
+        len -= 2;   /* Skip length field */
+
+#if CONFIG_JD_PROGRESSIVE
+        const bool progressive = ((marker & 0xFF) == 0xC2);    /* SOF2 (progressive JPEG) */
+#else
+        const bool progressive = false;
+#endif
+        if ((marker & 0xFF) == 0xC0 || progressive) {   /* SOF0 (baseline JPEG) */
+            if (len < 8 || jpeg_input_read(cfg, sof, 8) != 8) {
+                return ESP_FAIL;
+            }
+            *type = marker & 0xFF;
+            return ESP_OK;
+        }
+        if (jpeg_input_read(cfg, NULL, len) != len) {
+            return ESP_FAIL; // No more data
+        }
+    }
+}
+
+static jpeg_decode_in_size_t jpeg_decode_in_cb(JDEC *dec, uint8_t *buff, jpeg_decode_in_size_t nbyte)
+{
+    assert(dec != NULL);
+
+    esp_jpeg_image_cfg_t *cfg = (esp_jpeg_image_cfg_t *)dec->device;
+    assert(cfg != NULL);
+
+    /* Copy data from JPEG image, or skip data if buff is NULL */
+    return jpeg_input_read(cfg, buff, nbyte);
+}
+
+static void jpeg_input_seek(esp_jpeg_image_cfg_t *cfg, uint32_t ofs)
+{
+    cfg->priv.read = ofs;
+    /* Buffers of insegments are walked forward from the first one */
+    cfg->priv.seg = 0;
+    cfg->priv.seg_start = 0;
+}
+
+static uint32_t jpeg_input_read(esp_jpeg_image_cfg_t *cfg, uint8_t *buff, uint32_t nbyte)
+{
+    if (cfg->insegments == NULL) {
+        uint32_t to_read = nbyte;
+        if (cfg->priv.read >= cfg->indata_size) {
+            to_read = 0;
+        } else if (cfg->priv.read + to_read > cfg->indata_size) {
+            to_read = cfg->indata_size - cfg->priv.read;
+        }
+        if (buff) {
+            memcpy(buff, &cfg->indata[cfg->priv.read], to_read);
+        }
+        cfg->priv.read += to_read;
+        return to_read;
+    }
+
+    uint32_t done = 0;
+    while (done < nbyte && cfg->priv.seg < cfg->insegments_count) {
+        const esp_jpeg_segment_t *seg = &cfg->insegments[cfg->priv.seg];
+        const uint32_t pos = cfg->priv.read - cfg->priv.seg_start;  /* Position in the current buffer */
+        if (pos >= seg->size) {
+            /* Continue in the next buffer */
+            cfg->priv.seg_start += seg->size;
+            cfg->priv.seg++;
+            continue;
+        }
+        uint32_t to_read = seg->size - pos;
+        if (to_read > nbyte - done) {
+            to_read = nbyte - done;
+        }
+        if (buff) {
+            memcpy(buff + done, seg->data + pos, to_read);
+        }
+        cfg->priv.read += to_read;
+        done += to_read;
+    }
+    return done;
+}
+
+static jpeg_decode_out_t jpeg_decode_out_cb(JDEC *dec, void *bitmap, JRECT *rect)
+{
+    uint16_t color = 0;
+    assert(dec != NULL);
+
+    esp_jpeg_image_cfg_t *cfg = (esp_jpeg_image_cfg_t *)dec->device;
+    assert(cfg != NULL);
+    assert(bitmap != NULL);
+    assert(rect != NULL);
+
+    uint8_t out_color_bytes = jpeg_get_color_bytes(cfg->out_format);
+
+#if CONFIG_JD_USE_ROM
+    const uint32_t in_skip = 0; /* ROM decoder passes the rectangular without padding */
+#else
+    const uint32_t in_skip = (dec->ostride - (rect->right - rect->left + 1)) * ESP_JPEG_COLOR_BYTES; /* Truncated pixels at right edge */
+#endif
+
+    /* Copy decoded image data to output buffer */
+    uint8_t *in = (uint8_t *)bitmap;
+    if (JD_FORMAT == 0 && out_color_bytes == 4) {
+        jpeg_write_rgb32(cfg, in, rect, in_skip);
+        return 1;
+    }
+    /* BGR888 is RGB888 with reversed bytes */
+    const bool swap_color_bytes = cfg->flags.swap_color_bytes ^ (cfg->out_format == JPEG_IMAGE_FORMAT_BGR888);
+    for (int y = rect->top; y <= rect->bottom; y++) {
+        /* Output position is transformed by mirroring and rotation (see jpeg_set_output_steps()) */
+        uint8_t *dst = (uint8_t *)cfg->outbuf + cfg->priv.out_origin + (y - cfg->priv.out_top) * cfg->priv.out_step_y + rect->left * cfg->priv.out_step_x;
+        for (int x = rect->left; x <= rect->right; x++) {
+            if ( (JD_FORMAT == 0 && (cfg->out_format == JPEG_IMAGE_FORMAT_RGB888 || cfg->out_format == JPEG_IMAGE_FORMAT_BGR888)) ||
+                    (JD_FORMAT == 1 && cfg->out_format == JPEG_IMAGE_FORMAT_RGB565) ) {
+                /* Output image format is same as set in TJPGD */
+                for (int b = 0; b < ESP_JPEG_COLOR_BYTES; b++) {
+                    if (swap_color_bytes) {
+                        dst[b] = in[out_color_bytes - b - 1];
+                    } else {
+                        dst[b] = in[b];
+                    }
+                }
+            } else if (JD_FORMAT == 0 && cfg->out_format == JPEG_IMAGE_FORMAT_RGB565) {
+                /* Output image format is not same as set in TJPGD */
+                /* We need to convert the 3 bytes in `in` to a rgb565 value */
+                color = ((in[0] & 0xF8) << 8);
+                color |= ((in[1] & 0xFC) << 3);
+                color |= (in[2] >> 3);
+
+                if (cfg->flags.swap_color_bytes) {
+                    dst[0] = HIBYTE(color);
+                    dst[1] = LOBYTE(color);
+                } else {
+                    dst[1] = HIBYTE(color);
+                    dst[0] = LOBYTE(color);
+                }
+            } else {
+                ESP_LOGE(TAG, "Selected output format is not supported!");
+                assert(0);
+            }
+            in += ESP_JPEG_COLOR_BYTES;
+            dst += cfg->priv.out_step_x;
+        }
+        in += in_skip;
+    }
+
+    return 1;
+}
+
+static void jpeg_write_rgb32(esp_jpeg_image_cfg_t *cfg, const uint8_t *in, const JRECT *rect, uint32_t in_skip)
+{
+    /* Pixel is stored as one aligned 32-bit little-endian word (outbuf alignment is checked in jpeg_decode()) */
+    const bool argb = (cfg->out_format == JPEG_IMAGE_FORMAT_ARGB8888);
+    const unsigned int shift = argb ? 8 : 0;
+    const uint32_t alpha = argb ? 0x000000FF : 0xFF000000;
+    const int32_t step_x = cfg->priv.out_step_x / 4;
+
+    for (int y = rect->top; y <= rect->bottom; y++) {
+        uint32_t *dst = (uint32_t *)((uint8_t *)cfg->outbuf + cfg->priv.out_origin + (y - cfg->priv.out_top) * cfg->priv.out_step_y + rect->left * cfg->priv.out_step_x);
+        for (int x = rect->left; x <= rect->right; x++) {
+            uint32_t color = (((uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16) << shift) | alpha;
+            if (cfg->flags.swap_color_bytes) {
+                color = __builtin_bswap32(color);
+            }
+            *dst = color;
+            in += ESP_JPEG_COLOR_BYTES;
+            dst += step_x;
+        }
+        in += in_skip;
+    }
+}
+
+#if !CONFIG_JD_USE_ROM
+static void jpeg_luma_stats_cb(JDEC *dec, const jd_yuv_t *mcubuf, const JRECT *rect)
+{
+    assert(dec != NULL);
+
+    esp_jpeg_image_cfg_t *cfg = (esp_jpeg_image_cfg_t *)dec->device;
+    assert(cfg != NULL);
+
+    uint32_t *hist = cfg->advanced.luma_histogram;
+    const unsigned int hist_shift = (cfg->advanced.luma_histogram_bins == 64) ? 2 : 0;
+    uint32_t sum = 0;
+    uint8_t min = cfg->priv.luma_min;
+    uint8_t max = cfg->priv.luma_max;
+
+    /* Y blocks are stored first in the MCU buffer, row by row */
+    for (unsigned int iy = 0; iy <= (unsigned int)(rect->bottom - rect->top); iy++) {
+        const jd_yuv_t *py = mcubuf + (iy / 8) * dec->msx * 64 + (iy % 8) * 8;
+        for (unsigned int ix = 0; ix <= (unsigned int)(rect->right - rect->left); ix++) {
+            int v = py[(ix / 8) * 64 + ix % 8];
+            v = v < 0 ? 0 : (v > 255 ? 255 : v);    /* Y is not clipped yet if JD_FASTDECODE >= 1 */
+            sum += v;
+            if (v < min) {
+                min = v;
+            }
+            if (v > max) {
+                max = v;
+            }
+            if (hist) {
+                hist[v >> hist_shift]++;
+            }
+        }
+    }
+
+    cfg->priv.luma_sum += sum;
+    cfg->priv.luma_samples += (rect->right - rect->left + 1) * (rect->bottom - rect->top + 1);
+    cfg->priv.luma_min = min;
+    cfg->priv.luma_max = max;
+}
+#endif
+
+#if !CONFIG_JD_USE_ROM
+static esp_err_t jpeg_select_decoder(esp_jpeg_image_cfg_t *cfg, bool allocate_buffer, size_t *workbuf_size, esp_jpeg_decoder_t *decoder)
+{
+    esp_jpeg_image_cfg_t size_cfg = *cfg;
+    size_t size = 0;
+
+    *decoder = JPEG_DECODER_DEFAULT;
+#if CONFIG_JD_FAST_VARIANT
+    if (cfg->advanced.decoder == JPEG_DECODER_FAST || (cfg->advanced.decoder == JPEG_DECODER_AUTO && !allocate_buffer)) {
+        /* Working buffer of the caller: jpeg_prepare() falls back to the default decoder if it is too small */
+        *decoder = JPEG_DECODER_FAST;
+    } else if (cfg->advanced.decoder == JPEG_DECODER_AUTO) {
+        size_cfg.advanced.decoder = JPEG_DECODER_FAST;
+        ESP_RETURN_ON_ERROR(esp_jpeg_get_work_buffer_size(&size_cfg, &size), TAG, "Error in parsing JPEG image!");
+        /* Only if its bigger buffer does not starve the rest of the system (e.g. Wi-Fi) */
+        if (heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL) >= size &&
+                heap_caps_get_free_size(MALLOC_CAP_INTERNAL) >= size + CONFIG_JD_FAST_VARIANT_MIN_FREE) {
+            *decoder = JPEG_DECODER_FAST;
+        }
+    }
+#else
+    ESP_RETURN_ON_FALSE(cfg->advanced.decoder != JPEG_DECODER_FAST, ESP_ERR_NOT_SUPPORTED, TAG, "Fast decoder not built!");
+#endif
+
+    /* Allocate only what the selected decoder needs for this image; a working buffer of the caller is used as is */
+    if (allocate_buffer) {
+        if (*decoder != JPEG_DECODER_FAST || size == 0) {
+            size_cfg.advanced.decoder = *decoder;
+            ESP_RETURN_ON_ERROR(esp_jpeg_get_work_buffer_size(&size_cfg, &size), TAG, "Error in parsing JPEG image!");
+        }
+        *workbuf_size = size;
+    }
+    return ESP_OK;
+}
+
+static JRESULT jpeg_prepare(esp_jpeg_image_cfg_t *cfg, JDEC *jd, uint8_t *workbuf, size_t workbuf_size, esp_jpeg_decoder_t *decoder)
+{
+    jpeg_input_seek(cfg, 0);
+    JRESULT res = jpeg_decoder_ops[*decoder].prepare(jd, jpeg_decode_in_cb, workbuf, workbuf_size, cfg);
+#if CONFIG_JD_FAST_VARIANT
+    if (res == JDR_MEM1 && *decoder == JPEG_DECODER_FAST && cfg->advanced.decoder == JPEG_DECODER_AUTO) {
+        /* Working buffer of the caller too small for the faster decoder */
+        *decoder = JPEG_DECODER_DEFAULT;
+        jpeg_input_seek(cfg, 0);
+        res = jpeg_decoder_ops[*decoder].prepare(jd, jpeg_decode_in_cb, workbuf, workbuf_size, cfg);
+    }
+#endif
+    return res;
+}
+#endif
+
+static void jpeg_set_output_steps(esp_jpeg_image_cfg_t *cfg, uint32_t out_w, uint32_t out_h, uint32_t line, uint8_t out_color_bytes)
+{
+    /* Decoded pixel (x, y) is written to output pixel (org_x + x * dx_x + y * dy_x, org_y + x * dx_y + y * dy_y) */
+    int32_t org_x = 0, org_y = 0, dx_x = 1, dx_y = 0, dy_x = 0, dy_y = 1;
+
+    switch (cfg->out_rotation) {
+    case JPEG_IMAGE_ROTATE_90:
+        org_x = out_w - 1; dx_x = 0; dx_y = 1; dy_x = -1; dy_y = 0;
+        break;
+    case JPEG_IMAGE_ROTATE_180:
+        org_x = out_w - 1; org_y = out_h - 1; dx_x = -1; dy_y = -1;
+        break;
+    case JPEG_IMAGE_ROTATE_270:
+        org_y = out_h - 1; dx_x = 0; dx_y = -1; dy_x = 1; dy_y = 0;
+        break;
+    default:
+        break;
+    }
+
+    /* Mirroring is applied before rotation: start at the opposite edge and step back */
+    if (cfg->flags.mirror_x) {
+        const uint32_t last = (dx_x ? out_w : out_h) - 1;
+        org_x += dx_x * last; org_y += dx_y * last;
+        dx_x = -dx_x; dx_y = -dx_y;
+    }
+    if (cfg->flags.mirror_y) {
+        const uint32_t last = (dy_y ? out_h : out_w) - 1;
+        org_x += dy_x * last; org_y += dy_y * last;
+        dy_x = -dy_x; dy_y = -dy_y;
+    }
+
+    cfg->priv.out_origin = ((cfg->out_y + org_y) * line + cfg->out_x + org_x) * out_color_bytes;
+    cfg->priv.out_step_x = (dx_y * (int32_t)line + dx_x) * out_color_bytes;
+    cfg->priv.out_step_y = (dy_y * (int32_t)line + dy_x) * out_color_bytes;
+}
+
+static uint8_t jpeg_get_div_by_scale(esp_jpeg_image_scale_t scale)
+{
+    switch (scale) {
+    /* Not scaled */
+    case JPEG_IMAGE_SCALE_0:
+        return 1;
+    /* Scaled 1:2 */
+    case JPEG_IMAGE_SCALE_1_2:
+        return 2;
+    /* Scaled 1:4 */
+    case JPEG_IMAGE_SCALE_1_4:
+        return 4;
+    /* Scaled 1:8 */
+    case JPEG_IMAGE_SCALE_1_8:
+        return 8;
+    }
+
+    return 1;
+}
+
+static uint8_t jpeg_get_color_bytes(esp_jpeg_image_format_t format)
+{
+    switch (format) {
+    /* RGB888 (24-bit/pix) */
+    case JPEG_IMAGE_FORMAT_RGB888:
+        return 3;
+    /* RGB565 (16-bit/pix) */
+    case JPEG_IMAGE_FORMAT_RGB565:
+        return 2;
+    /* BGR888 (24-bit/pix) */
+    case JPEG_IMAGE_FORMAT_BGR888:
+        return 3;
+    /* RGBA8888, ARGB8888 (32-bit/pix) */
+    case JPEG_IMAGE_FORMAT_RGBA8888:
+    case JPEG_IMAGE_FORMAT_ARGB8888:
+        return 4;
+    }
+
+    return 1;
+}
+
+static inline uint16_t ldb_word(const void *ptr)
+{
+    const uint8_t *p = (const uint8_t *)ptr;
+    return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static inline uint16_t ldl_word(const uint8_t *p)
+{
+    return ((uint16_t)p[1] << 8) | p[0];
+}
+
+static inline uint32_t ldl_dword(const uint8_t *p)
+{
+    return ((uint32_t)ldl_word(p + 2) << 16) | ldl_word(p);
+}
+
+static inline void stl_word(uint8_t *p, uint16_t v)
+{
+    p[0] = LOBYTE(v);
+    p[1] = HIBYTE(v);
+}
+
+static inline void stl_dword(uint8_t *p, uint32_t v)
+{
+    stl_word(p, (uint16_t)v);
+    stl_word(p + 2, (uint16_t)(v >> 16));
+}
@@ -0,0 +1,13 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Subset of ESP-IDF esp_assert.h used by esp_jpeg, for the Linux build
+
+#pragma once
+
+#include <assert.h>
+
+#define ESP_STATIC_ASSERT _Static_assert
@@ -0,0 +1,24 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Subset of ESP-IDF esp_heap_caps.h used by esp_jpeg, for the Linux build.
+// There is a single heap: capabilities are ignored and the heap is never reported as short,
+// so JPEG_DECODER_AUTO picks the faster decoder whenever it is built.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT         (1 << 2)    /*!< Memory must allow for 8/16/...-bit data accesses */
+#define MALLOC_CAP_SPIRAM       (1 << 10)   /*!< Memory must be in SPI RAM */
+#define MALLOC_CAP_INTERNAL     (1 << 11)   /*!< Memory must be internal */
+#define MALLOC_CAP_DEFAULT      (1 << 12)   /*!< Memory can be returned in a non-capability-specific memory allocation */
+
+#define heap_caps_malloc(size, caps)                ((void)(caps), malloc(size))
+#define heap_caps_calloc(n, size, caps)             ((void)(caps), calloc(n, size))
+#define heap_caps_get_free_size(caps)               ((void)(caps), SIZE_MAX / 2)
+#define heap_caps_get_largest_free_block(caps)      ((void)(caps), SIZE_MAX / 2)
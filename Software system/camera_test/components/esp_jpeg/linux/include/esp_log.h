@@ -0,0 +1,23 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Subset of ESP-IDF esp_log.h used by esp_jpeg, for the Linux build.
+// Errors and warnings go to stderr unless ESP_JPEG_LOG_QUIET is defined, other levels are compiled out.
+
+#pragma once
+
+#include <stdio.h>
+
+#if defined(ESP_JPEG_LOG_QUIET)
+#define ESP_LOGE(tag, format, ...) do { (void)(tag); } while (0)
+#define ESP_LOGW(tag, format, ...) do { (void)(tag); } while (0)
+#else
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W %s: " format "\n", tag, ##__VA_ARGS__)
+#endif
+#define ESP_LOGI(tag, format, ...) do { (void)(tag); } while (0)
+#define ESP_LOGD(tag, format, ...) do { (void)(tag); } while (0)
+#define ESP_LOGV(tag, format, ...) do { (void)(tag); } while (0)
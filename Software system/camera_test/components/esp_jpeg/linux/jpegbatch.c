@@ -0,0 +1,363 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Batch JPEG decoder for Linux: decodes files or directories of JPEG images with the decoder of the device
+// across a pool of worker threads, reports the throughput and rejects images that do not decode.
+
+#include <dirent.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_check.h"
+#include "jpeg_decoder.h"
+
+#define JPEGBATCH_MAX_THREADS   256
+
+static const char *TAG = "jpegbatch";
+
+typedef struct {
+    char **paths;                       /*!< Images to decode */
+    size_t count;                       /*!< Number of images */
+    unsigned int repeat;                /*!< Number of decodes of each image */
+    esp_jpeg_image_scale_t scale;       /*!< Output scale */
+    esp_jpeg_image_format_t format;     /*!< Output format */
+    esp_jpeg_decoder_t decoder;         /*!< Decoder to use */
+    const char *out_dir;                /*!< Directory for PPM thumbnails, or NULL */
+    bool quiet;                         /*!< Do not print decoded images */
+    atomic_size_t next;                 /*!< Next job (image index * repeat + pass) */
+    atomic_uint decoded;                /*!< Number of decoded images */
+    atomic_uint rejected;               /*!< Number of rejected images */
+    atomic_ullong pixels;               /*!< Number of decoded pixels (full size image) */
+} batch_t;
+
+/* Buffers of one worker thread, reused and only grown from image to image */
+typedef struct {
+    batch_t *batch;
+    pthread_t thread;
+    uint8_t *in;
+    size_t in_size;
+    uint8_t *out;
+    size_t out_size;
+    void *work;
+    size_t work_size;
+    void *coef;
+    size_t coef_size;
+} worker_t;
+
+static const struct {
+    const char *name;
+    esp_jpeg_image_format_t format;
+} formats[] = {
+    { "rgb888", JPEG_IMAGE_FORMAT_RGB888 },
+    { "rgb565", JPEG_IMAGE_FORMAT_RGB565 },
+    { "rgba8888", JPEG_IMAGE_FORMAT_RGBA8888 },
+    { "bgr888", JPEG_IMAGE_FORMAT_BGR888 },
+    { "argb8888", JPEG_IMAGE_FORMAT_ARGB8888 },
+};
+
+static esp_err_t grow_buffer(void **buf, size_t *buf_size, size_t size)
+{
+    if (size > *buf_size) {
+        void *new_buf = realloc(*buf, size);
+        ESP_RETURN_ON_FALSE(new_buf, ESP_ERR_NO_MEM, TAG, "no mem for %zu bytes buffer", size);
+        *buf = new_buf;
+        *buf_size = size;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t read_file(worker_t *w, const char *path, size_t *len)
+{
+    esp_err_t ret = ESP_OK;
+    struct stat st;
+
+    FILE *f = fopen(path, "rb");
+    ESP_RETURN_ON_FALSE(f, ESP_ERR_NOT_FOUND, TAG, "%s: %s", path, strerror(errno));
+    ESP_GOTO_ON_FALSE(fstat(fileno(f), &st) == 0 && st.st_size > 0 && st.st_size <= UINT32_MAX, ESP_ERR_INVALID_SIZE, err, TAG,
+                      "%s: empty or too big", path);
+    ESP_GOTO_ON_ERROR(grow_buffer((void **)&w->in, &w->in_size, st.st_size), err, TAG, "%s: no mem for input", path);
+    ESP_GOTO_ON_FALSE(fread(w->in, 1, st.st_size, f) == (size_t)st.st_size, ESP_FAIL, err, TAG, "%s: read error", path);
+    *len = st.st_size;
+err:
+    fclose(f);
+    return ret;
+}
+
+static esp_err_t write_ppm(batch_t *batch, const char *path, const uint8_t *pixels, const esp_jpeg_image_output_t *img)
+{
+    char out_path[4096];
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+
+    snprintf(out_path, sizeof(out_path), "%s/%.*s.ppm", batch->out_dir, (int)strcspn(name, "."), name);
+    FILE *f = fopen(out_path, "wb");
+    ESP_RETURN_ON_FALSE(f, ESP_FAIL, TAG, "%s: %s", out_path, strerror(errno));
+    fprintf(f, "P6\n%u %u\n255\n", img->width, img->height);
+    size_t written = fwrite(pixels, 1, img->output_len, f);
+    ESP_RETURN_ON_FALSE(fclose(f) == 0 && written == img->output_len, ESP_FAIL, TAG, "%s: write error", out_path);
+    return ESP_OK;
+}
+
+static esp_err_t decode_image(worker_t *w, const char *path, bool save)
+{
+    batch_t *batch = w->batch;
+    esp_jpeg_image_output_t img;
+    size_t len = 0;
+    size_t size = 0;
+
+    ESP_RETURN_ON_ERROR(read_file(w, path, &len), TAG, "%s: cannot read", path);
+
+    esp_jpeg_image_cfg_t cfg = {
+        .indata = w->in,
+        .indata_size = len,
+        .out_format = batch->format,
+        .out_scale = batch->scale,
+        .advanced.decoder = batch->decoder,
+    };
+    ESP_RETURN_ON_ERROR(esp_jpeg_get_image_info(&cfg, &img), TAG, "%s: bad header", path);
+    ESP_RETURN_ON_ERROR(grow_buffer((void **)&w->out, &w->out_size, img.output_len), TAG, "%s: no mem for output", path);
+
+    /* With JPEG_DECODER_AUTO, the working buffer is sized for the faster decoder if it is built, so that it is used */
+#if CONFIG_JD_FAST_VARIANT
+    if (batch->decoder == JPEG_DECODER_AUTO) {
+        cfg.advanced.decoder = JPEG_DECODER_FAST;
+    }
+#endif
+    ESP_RETURN_ON_ERROR(esp_jpeg_get_work_buffer_size(&cfg, &size), TAG, "%s: bad header", path);
+    cfg.advanced.decoder = batch->decoder;
+    ESP_RETURN_ON_ERROR(grow_buffer(&w->work, &w->work_size, size), TAG, "%s: no mem for working buffer", path);
+
+    /* Coefficient buffer of progressive images */
+    if (esp_jpeg_get_coef_buffer_size(&cfg, &size) == ESP_OK && size != 0) {
+        ESP_RETURN_ON_ERROR(grow_buffer(&w->coef, &w->coef_size, size), TAG, "%s: no mem for coefficient buffer", path);
+        cfg.advanced.coef_buffer = w->coef;
+        cfg.advanced.coef_buffer_size = w->coef_size;
+    }
+
+    cfg.outbuf = w->out;
+    cfg.outbuf_size = w->out_size;
+    cfg.advanced.working_buffer = w->work;
+    cfg.advanced.working_buffer_size = w->work_size;
+    ESP_RETURN_ON_ERROR(esp_jpeg_decode(&cfg, &img), TAG, "%s: decoding failed", path);
+
+    uint32_t scale_div = 1U << batch->scale;
+    atomic_fetch_add(&batch->pixels, (unsigned long long)img.width * img.height * scale_div * scale_div);
+    if (save) {
+        if (!batch->quiet) {
+            printf("%s: %ux%u, %u scan(s), %s decoder\n", path, img.width, img.height, img.scans,
+                   img.decoder == JPEG_DECODER_FAST ? "fast" : "default");
+        }
+        if (batch->out_dir) {
+            ESP_RETURN_ON_ERROR(write_ppm(batch, path, w->out, &img), TAG, "%s: cannot save thumbnail", path);
+        }
+    }
+    return ESP_OK;
+}
+
+static void *worker_task(void *arg)
+{
+    worker_t *w = arg;
+    batch_t *batch = w->batch;
+    const size_t jobs = batch->count * batch->repeat;
+
+    for (size_t job = atomic_fetch_add(&batch->next, 1); job < jobs; job = atomic_fetch_add(&batch->next, 1)) {
+        const size_t pass = job % batch->repeat;
+        const char *path = batch->paths[job / batch->repeat];
+
+        /* A corrupt image fails in every pass, count it once */
+        esp_err_t err = decode_image(w, path, pass == 0);
+        if (err == ESP_OK) {
+            atomic_fetch_add(&batch->decoded, 1);
+        } else if (pass == 0) {
+            atomic_fetch_add(&batch->rejected, 1);
+            printf("%s: rejected (%s)\n", path, esp_err_to_name(err));
+        }
+    }
+    free(w->in);
+    free(w->out);
+    free(w->work);
+    free(w->coef);
+    return NULL;
+}
+
+static bool is_jpeg_name(const char *name)
+{
+    const char *ext = strrchr(name, '.');
+    return ext && (strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0);
+}
+
+static esp_err_t add_path(batch_t *batch, size_t *capacity, const char *path)
+{
+    if (batch->count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        char **paths = realloc(batch->paths, *capacity * sizeof(char *));
+        ESP_RETURN_ON_FALSE(paths, ESP_ERR_NO_MEM, TAG, "no mem for file list");
+        batch->paths = paths;
+    }
+    batch->paths[batch->count] = strdup(path);
+    ESP_RETURN_ON_FALSE(batch->paths[batch->count], ESP_ERR_NO_MEM, TAG, "no mem for file list");
+    batch->count++;
+    return ESP_OK;
+}
+
+/* Files are taken as they are, directories contribute their *.jpg and *.jpeg files (not recursive) */
+static esp_err_t collect_paths(batch_t *batch, size_t *capacity, const char *path)
+{
+    esp_err_t ret = ESP_OK;
+    struct stat st;
+    char file_path[4096];
+
+    ESP_RETURN_ON_FALSE(stat(path, &st) == 0, ESP_ERR_NOT_FOUND, TAG, "%s: %s", path, strerror(errno));
+    if (!S_ISDIR(st.st_mode)) {
+        return add_path(batch, capacity, path);
+    }
+
+    DIR *dir = opendir(path);
+    ESP_RETURN_ON_FALSE(dir, ESP_ERR_NOT_FOUND, TAG, "%s: %s", path, strerror(errno));
+    for (struct dirent *e = readdir(dir); e; e = readdir(dir)) {
+        if (is_jpeg_name(e->d_name)) {
+            snprintf(file_path, sizeof(file_path), "%s%s%s", path, path[strlen(path) - 1] == '/' ? "" : "/", e->d_name);
+            ESP_GOTO_ON_ERROR(add_path(batch, capacity, file_path), err, TAG, "%s: cannot list", path);
+        }
+    }
+err:
+    closedir(dir);
+    return ret;
+}
+
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options] <file or directory>...\n"
+            "  -j <threads>  Number of worker threads (default: number of CPUs)\n"
+            "  -s <scale>    Output scale 0..3: 1/1, 1/2, 1/4, 1/8 (default: 0)\n"
+            "  -f <format>   Output format rgb888, rgb565, rgba8888, bgr888, argb8888 (default: rgb888)\n"
+            "  -d <decoder>  Decoder auto, default, fast (default: auto)\n"
+            "  -r <count>    Decode each image <count> times, for benchmarking (default: 1)\n"
+            "  -o <dir>      Save decoded images as PPM files to <dir> (rgb888 only)\n"
+            "  -q            Print only rejected images and the summary\n"
+            "Exit code is 1 if any image is rejected.\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    batch_t batch = {
+        .repeat = 1,
+        .scale = JPEG_IMAGE_SCALE_0,
+        .format = JPEG_IMAGE_FORMAT_RGB888,
+        .decoder = JPEG_DECODER_AUTO,
+    };
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t capacity = 0;
+    bool format_ok = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:s:f:d:r:o:qh")) != -1) {
+        switch (opt) {
+        case 'j':
+            threads = strtol(optarg, NULL, 10);
+            break;
+        case 's':
+            batch.scale = (esp_jpeg_image_scale_t)strtol(optarg, NULL, 10);
+            break;
+        case 'f':
+            format_ok = false;
+            for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+                if (strcmp(optarg, formats[i].name) == 0) {
+                    batch.format = formats[i].format;
+                    format_ok = true;
+                }
+            }
+            break;
+        case 'd':
+            batch.decoder = strcmp(optarg, "fast") == 0 ? JPEG_DECODER_FAST :
+                            strcmp(optarg, "default") == 0 ? JPEG_DECODER_DEFAULT : JPEG_DECODER_AUTO;
+            break;
+        case 'r':
+            batch.repeat = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            batch.out_dir = optarg;
+            break;
+        case 'q':
+            batch.quiet = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (optind >= argc || !format_ok || threads < 1 || threads > JPEGBATCH_MAX_THREADS || batch.scale > JPEG_IMAGE_SCALE_1_8 ||
+            batch.repeat < 1 || (batch.out_dir && batch.format != JPEG_IMAGE_FORMAT_RGB888)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    for (int i = optind; i < argc; i++) {
+        if (collect_paths(&batch, &capacity, argv[i]) != ESP_OK) {
+            return 2;
+        }
+    }
+    qsort(batch.paths, batch.count, sizeof(char *), compare_paths);
+    if ((size_t)threads > batch.count) {
+        threads = batch.count ? (long)batch.count : 1;
+    }
+
+    worker_t *workers = calloc(threads, sizeof(worker_t));
+    if (!workers) {
+        ESP_LOGE(TAG, "no mem for workers");
+        return 2;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long started = 0;
+    for (; started < threads; started++) {
+        workers[started].batch = &batch;
+        if (pthread_create(&workers[started].thread, NULL, worker_task, &workers[started]) != 0) {
+            ESP_LOGE(TAG, "cannot start worker thread %ld", started);
+            break;
+        }
+    }
+    if (started == 0) {
+        /* Decode in the main thread */
+        workers[0].batch = &batch;
+        worker_task(&workers[0]);
+    }
+    for (long i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    const double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    const unsigned int decoded = atomic_load(&batch.decoded);
+    const unsigned int rejected = atomic_load(&batch.rejected);
+    printf("decoded %u, rejected %u in %.3f s with %ld thread(s): %.1f images/s, %.1f Mpixel/s\n",
+           decoded, rejected, seconds, started ? started : 1L, seconds > 0 ? decoded / seconds : 0.0,
+           seconds > 0 ? atomic_load(&batch.pixels) / seconds / 1e6 : 0.0);
+
+    for (size_t i = 0; i < batch.count; i++) {
+        free(batch.paths[i]);
+    }
+    free(batch.paths);
+    free(workers);
+    return rejected ? 1 : 0;
+}
@@ -0,0 +1,7 @@
+// Progressive JPEG encoded image 46x46, 4568 bytes (logo.jpg converted without loss, 10 scans)
+extern const unsigned char logo_progressive_jpg[] asm("_binary_logo_progressive_jpg_start");
+
+extern char _binary_logo_progressive_jpg_start;
+extern char _binary_logo_progressive_jpg_end;
+// Must be defined as macro because extern variables are not known at compile time (but at link time)
+#define logo_progressive_jpg_len (&_binary_logo_progressive_jpg_end - &_binary_logo_progressive_jpg_start)
@@ -0,0 +1,8 @@
+// JPEG encoded image 46x46, 1981 bytes (logo.jpg with a restart interval of 2 MCUs), with a stuffed 0xFF byte
+// (0xFF 0x00) padding the data before each of the 4 restart markers, as written by some camera encoders
+extern const unsigned char restart_padded_jpg[] asm("_binary_restart_padded_jpg_start");
+
+extern char _binary_restart_padded_jpg_start;
+extern char _binary_restart_padded_jpg_end;
+// Must be defined as macro because extern variables are not known at compile time (but at link time)
+#define restart_padded_jpg_len (&_binary_restart_padded_jpg_end - &_binary_restart_padded_jpg_start)
@@ -0,0 +1,1226 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "sdkconfig.h"
+#include "unity.h"
+
+
+#include "jpeg_decoder.h"
+#include "test_logo_jpg.h"
+#include "test_logo_progressive_jpg.h"
+#include "test_restart_padded_jpg.h"
+#include "test_logo_rgb888.h"
+#include "test_usb_camera_2_jpg.h"
+#include "test_usb_camera_2_rgb888.h"
+
+#define TESTW 46
+#define TESTH 46
+
+void esp_jpeg_print_ascii(unsigned char *rgb888, esp_jpeg_image_output_t *outimg)
+{
+    char aapix[] = " .:;+=xX$$";
+    unsigned char *p = rgb888 + 2;
+
+    for (int y = 0; y < outimg->width; y++) {
+        for (int x = 0; x < outimg->height; x++) {
+            int v = ((*p) * (sizeof(aapix) - 2) * 2) / 256;
+            printf("%c%c", aapix[v / 2], aapix[(v + 1) / 2]);
+            p += 3;
+        }
+        printf("%c%c", ' ', '\n');
+    }
+}
+
+TEST_CASE("Test JPEG decompression library", "[esp_jpeg]")
+{
+    unsigned char *decoded, *p;
+    const unsigned char *o;
+    int decoded_outsize = TESTW * TESTH * 3;
+
+    decoded = malloc(decoded_outsize);
+    for (int x = 0; x < decoded_outsize; x += 2) {
+        decoded[x] = 0;
+        decoded[x + 1] = 0xff;
+    }
+
+    /* JPEG decode */
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)logo_jpg,
+        .indata_size = logo_jpg_len,
+        .outbuf = decoded,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+        .flags = {
+            .swap_color_bytes = 0,
+        }
+    };
+    esp_jpeg_image_output_t outimg;
+    esp_err_t err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(err, ESP_OK);
+
+    /* Decoded image size */
+    TEST_ASSERT_EQUAL(outimg.width, TESTW);
+    TEST_ASSERT_EQUAL(outimg.height, TESTH);
+
+    p = decoded;
+    o = logo_rgb888;
+    for (int x = 0; x < outimg.width * outimg.height; x++) {
+        /* The color can be +- 2 */
+        TEST_ASSERT_UINT8_WITHIN(2, o[0], p[0]);
+        TEST_ASSERT_UINT8_WITHIN(2, o[1], p[1]);
+        TEST_ASSERT_UINT8_WITHIN(2, o[2], p[2]);
+
+        p += 3;
+        o += 3;
+    }
+
+    esp_jpeg_print_ascii(decoded, &outimg);
+
+    free(decoded);
+}
+
+/**
+ * @brief JPEG unknown size test
+ *
+ * This test case verifies the functionality of the JPEG decompression library
+ * when decoding an image with unknown size. The image is decoded from a
+ * JPEG file, and the output size is determined dynamically. The test checks
+ * that the decoded image dimensions match the expected values and that the
+ * pixel data is within an acceptable tolerance range.
+ */
+TEST_CASE("Test JPEG unknown size", "[esp_jpeg]")
+{
+    unsigned char *decoded, *p;
+    const unsigned char *o;
+
+    /* JPEG decode */
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)logo_jpg,
+        .indata_size = logo_jpg_len,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+    };
+
+    // 1. Get required output size
+    esp_jpeg_image_output_t outimg;
+    esp_err_t err = esp_jpeg_get_image_info(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(err, ESP_OK);
+    TEST_ASSERT_EQUAL(TESTW * TESTH * 3, outimg.output_len);
+    TEST_ASSERT_EQUAL(outimg.width, TESTW);
+    TEST_ASSERT_EQUAL(outimg.height, TESTH);
+
+    // 2. Allocate output buffer and assign it to the config
+    decoded = malloc(outimg.output_len);
+    TEST_ASSERT_NOT_NULL(decoded);
+    jpeg_cfg.outbuf = decoded;
+    jpeg_cfg.outbuf_size = outimg.output_len;
+
+    // 3. Decode the image
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(err, ESP_OK);
+
+    /* Decoded image size */
+    TEST_ASSERT_EQUAL(TESTW * TESTH * 3, outimg.output_len);
+    TEST_ASSERT_EQUAL(outimg.width, TESTW);
+    TEST_ASSERT_EQUAL(outimg.height, TESTH);
+
+    p = decoded;
+    o = logo_rgb888;
+    for (int x = 0; x < outimg.width * outimg.height; x++) {
+        /* The color can be +- 2 */
+        TEST_ASSERT_UINT8_WITHIN(2, o[0], p[0]);
+        TEST_ASSERT_UINT8_WITHIN(2, o[1], p[1]);
+        TEST_ASSERT_UINT8_WITHIN(2, o[2], p[2]);
+
+        p += 3;
+        o += 3;
+    }
+    free(decoded);
+}
+
+#define WORKING_BUFFER_SIZE 4096
+TEST_CASE("Test JPEG decompression library: User defined working buffer", "[esp_jpeg]")
+{
+    unsigned char *decoded, *p;
+    const unsigned char *o;
+    int decoded_outsize = TESTW * TESTH * 3;
+
+    decoded = malloc(decoded_outsize);
+    uint8_t *working_buf = malloc(WORKING_BUFFER_SIZE);
+    assert(decoded);
+    assert(working_buf);
+
+    for (int x = 0; x < decoded_outsize; x += 2) {
+        decoded[x] = 0;
+        decoded[x + 1] = 0xff;
+    }
+
+    /* JPEG decode */
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)logo_jpg,
+        .indata_size = logo_jpg_len,
+        .outbuf = decoded,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+        .flags = {
+            .swap_color_bytes = 0,
+        },
+        .advanced = {
+            .working_buffer = working_buf,
+            .working_buffer_size = WORKING_BUFFER_SIZE,
+        },
+    };
+    esp_jpeg_image_output_t outimg;
+    esp_err_t err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(err, ESP_OK);
+
+    /* Decoded image size */
+    TEST_ASSERT_EQUAL(outimg.width, TESTW);
+    TEST_ASSERT_EQUAL(outimg.height, TESTH);
+
+    p = decoded;
+    o = logo_rgb888;
+    for (int x = 0; x < outimg.width * outimg.height; x++) {
+        /* The color can be +- 2 */
+        TEST_ASSERT_UINT8_WITHIN(2, o[0], p[0]);
+        TEST_ASSERT_UINT8_WITHIN(2, o[1], p[1]);
+        TEST_ASSERT_UINT8_WITHIN(2, o[2], p[2]);
+
+        p += 3;
+        o += 3;
+    }
+    free(working_buf);
+    free(decoded);
+}
+
+#if CONFIG_JD_DEFAULT_HUFFMAN
+#include "test_usb_camera_jpg.h"
+#include "test_usb_camera_rgb888.h"
+
+/**
+ * @brief Test for JPEG decompression without Huffman tables
+ *
+ * This test case verifies the functionality of the JPEG decompression library
+ * when decoding an image that lacks Huffman tables, such as a USB frame
+ * from a Logitech C270 USB camera. The image was reconstructed from raw USB data
+ * (using `hex_to_jpg.py`) and then converted into an RGB888 C-style array
+ * (using `jpg_to_rgb888_hex.py`).
+ *
+ * Due to the unique structure of the JPEG data (double block size, 16x8 pixels)
+ * and absence of Huffman tables, this test assesses whether the decompression
+ * library correctly decodes the image and outputs RGB888 pixel data within
+ * an acceptable tolerance range.
+ *
+ * The test performs the following steps:
+ * - Allocates a buffer for the decoded image.
+ * - Configures and runs the JPEG decoder with the RGB888 output format.
+ * - Checks that the decoded image dimensions match expected values.
+ * - Compares the decompressed image data against the reference RGB888 data,
+ *   allowing a tolerance of ±16 in each color component due to potential
+ *   differences in Huffman tables or decompression accuracy.
+ *
+ * @note This test allows a margin of error in pixel values due to potential
+ *       differences in how color data is interpreted across different decoders.
+ *
+ * @param None
+ *
+ * @return None
+ *
+ * @test Requirements:
+ * - JPEG decompression library support for images without Huffman tables.
+ * - JPEG decompression accuracy within acceptable error margins.
+ */
+TEST_CASE("Test JPEG decompression library: No Huffman tables", "[esp_jpeg]")
+{
+    unsigned char *decoded, *p;
+    const unsigned int *o;
+    int decoded_outsize = 160 * 120 * 3;
+
+    decoded = malloc(decoded_outsize);
+
+    /* JPEG decode */
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)jpeg_no_huffman,
+        .indata_size = jpeg_no_huffman_len,
+        .outbuf = decoded,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+        .flags = {
+            .swap_color_bytes = 0,
+        }
+    };
+    esp_jpeg_image_output_t outimg;
+    esp_err_t err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(err, ESP_OK);
+
+    /* Decoded image size */
+    TEST_ASSERT_EQUAL(outimg.width, 160);
+    TEST_ASSERT_EQUAL(outimg.height, 120);
+
+    p = decoded;
+    o = jpeg_no_huffman_rgb888;
+    for (int x = 0; x < outimg.width * outimg.height; x++) {
+        /* The color can be +- 16 */
+        // Here we allow bigger decoding error
+        // It might be that the Windows decoder used slightly different Huffman tables
+        TEST_ASSERT_UINT8_WITHIN(16, (*o) & 0xff, p[0]);
+        TEST_ASSERT_UINT8_WITHIN(16, (*o >> 8) & 0xff, p[1]);
+        TEST_ASSERT_UINT8_WITHIN(16, (*o >> 16) & 0xff, p[2]);
+
+        p += 3; // this is uint8_t
+        o ++;   // this is unt32_t
+    }
+
+    free(decoded);
+}
+
+#endif
+
+/**
+ * @brief Invalid JPEG marker test
+ *
+ * This test case verifies the behavior of the JPEG decompression library
+ * when encountering an invalid marker (0xFFFF) in the JPEG data stream.
+ * The test uses a known JPEG image (camera_2_jpg) that contains this invalid
+ * marker. The test checks whether the library can handle the invalid marker
+ * gracefully and still decode the image correctly.
+ */
+TEST_CASE("Test JPEG invalid marker 0xFFFF", "[esp_jpeg]")
+{
+    unsigned char *decoded;
+    int decoded_outsize = 160 * 120 * 3;
+
+    decoded = malloc(decoded_outsize);
+    assert(decoded);
+    for (int x = 0; x < decoded_outsize; x += 2) {
+        decoded[x] = 0;
+        decoded[x + 1] = 0xff;
+    }
+
+    /* JPEG decode */
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)camera_2_jpg,
+        .indata_size = camera_2_jpg_len,
+        .outbuf = decoded,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+        .flags = {
+            .swap_color_bytes = 0,
+        }
+    };
+    esp_jpeg_image_output_t outimg;
+    esp_err_t err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+
+    /* Decoded image size */
+    TEST_ASSERT_EQUAL(160, outimg.width);
+    TEST_ASSERT_EQUAL(120, outimg.height);
+
+    free(decoded);
+}
+
+/**
+ * @brief Padded restart marker test
+ *
+ * This test case verifies that a stuffed 0xFF byte (0xFF 0x00) padding the
+ * entropy-coded data before a restart marker is skipped: the image decodes to
+ * the same pixels as the image without the padding bytes.
+ */
+TEST_CASE("Test JPEG restart marker after stuffed 0xFF", "[esp_jpeg]")
+{
+    int decoded_outsize = TESTW * TESTH * 3;
+    uint8_t *decoded = malloc(decoded_outsize);
+    uint8_t *decoded_plain = malloc(decoded_outsize);
+    uint8_t *plain = malloc(restart_padded_jpg_len);
+    TEST_ASSERT_NOT_NULL(decoded);
+    TEST_ASSERT_NOT_NULL(decoded_plain);
+    TEST_ASSERT_NOT_NULL(plain);
+
+    /* Same image without the padding */
+    size_t plain_len = 0;
+    for (size_t i = 0; i < restart_padded_jpg_len; i++) {
+        if (i + 3 < restart_padded_jpg_len && restart_padded_jpg[i] == 0xFF && restart_padded_jpg[i + 1] == 0x00 &&
+                restart_padded_jpg[i + 2] == 0xFF && (restart_padded_jpg[i + 3] & 0xF8) == 0xD0) {
+            i++;
+            continue;
+        }
+        plain[plain_len++] = restart_padded_jpg[i];
+    }
+    TEST_ASSERT_EQUAL(restart_padded_jpg_len - 4 * 2, plain_len);
+
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)restart_padded_jpg,
+        .indata_size = restart_padded_jpg_len,
+        .outbuf = decoded,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+    };
+    esp_jpeg_image_output_t outimg;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_jpeg_decode(&jpeg_cfg, &outimg));
+    TEST_ASSERT_EQUAL(TESTW, outimg.width);
+    TEST_ASSERT_EQUAL(TESTH, outimg.height);
+
+    jpeg_cfg.indata = plain;
+    jpeg_cfg.indata_size = plain_len;
+    jpeg_cfg.outbuf = decoded_plain;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_jpeg_decode(&jpeg_cfg, &outimg));
+    TEST_ASSERT_EQUAL_MEMORY(decoded_plain, decoded, decoded_outsize);
+
+    free(plain);
+    free(decoded_plain);
+    free(decoded);
+}
+
+
+/**
+ * @brief JPEG output stride test
+ *
+ * This test case verifies decoding of an image into a sub-rectangle of
+ * a larger framebuffer. The decoded pixels must match the reference image
+ * and the rest of the framebuffer must not be touched.
+ */
+TEST_CASE("Test JPEG decompression library: Output stride and offset", "[esp_jpeg]")
+{
+    const int fb_w = TESTW + 30, fb_h = TESTH + 20;
+    const int off_x = 20, off_y = 10;
+    int fb_size = fb_w * fb_h * 3;
+    unsigned char *fb = malloc(fb_size);
+    TEST_ASSERT_NOT_NULL(fb);
+    memset(fb, 0xA5, fb_size);
+
+    /* JPEG decode */
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)logo_jpg,
+        .indata_size = logo_jpg_len,
+        .outbuf = fb,
+        .outbuf_size = fb_size,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+        .out_stride = fb_w,
+        .out_x = off_x,
+        .out_y = off_y,
+    };
+    esp_jpeg_image_output_t outimg;
+    esp_err_t err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(TESTW, outimg.width);
+    TEST_ASSERT_EQUAL(TESTH, outimg.height);
+
+    for (int y = 0; y < fb_h; y++) {
+        for (int x = 0; x < fb_w; x++) {
+            const unsigned char *p = &fb[(y * fb_w + x) * 3];
+            if (x >= off_x && x < off_x + TESTW && y >= off_y && y < off_y + TESTH) {
+                /* The color can be +- 2 */
+                const unsigned char *o = &logo_rgb888[((y - off_y) * TESTW + (x - off_x)) * 3];
+                TEST_ASSERT_UINT8_WITHIN(2, o[0], p[0]);
+                TEST_ASSERT_UINT8_WITHIN(2, o[1], p[1]);
+                TEST_ASSERT_UINT8_WITHIN(2, o[2], p[2]);
+            } else {
+                TEST_ASSERT_EQUAL(0xA5, p[0]);
+                TEST_ASSERT_EQUAL(0xA5, p[1]);
+                TEST_ASSERT_EQUAL(0xA5, p[2]);
+            }
+        }
+    }
+
+    /* Image does not fit in the stride */
+    jpeg_cfg.out_x = fb_w - TESTW + 1;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, err);
+
+    /* Image does not fit in the buffer */
+    jpeg_cfg.out_x = off_x;
+    jpeg_cfg.out_y = fb_h - TESTH + 1;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, err);
+
+    free(fb);
+}
+
+/**
+ * @brief JPEG rotation and mirroring test
+ *
+ * This test case decodes the image with all combinations of output rotation
+ * and mirroring and compares every output pixel with the corresponding pixel
+ * of the reference image.
+ */
+TEST_CASE("Test JPEG decompression library: Rotation and mirroring", "[esp_jpeg]")
+{
+    int decoded_outsize = TESTW * TESTH * 3;
+    unsigned char *decoded = malloc(decoded_outsize);
+    TEST_ASSERT_NOT_NULL(decoded);
+
+    for (int rot = JPEG_IMAGE_ROTATE_0; rot <= JPEG_IMAGE_ROTATE_270; rot++) {
+        for (int mirror = 0; mirror < 4; mirror++) {
+            /* JPEG decode */
+            esp_jpeg_image_cfg_t jpeg_cfg = {
+                .indata = (uint8_t *)logo_jpg,
+                .indata_size = logo_jpg_len,
+                .outbuf = decoded,
+                .outbuf_size = decoded_outsize,
+                .out_format = JPEG_IMAGE_FORMAT_RGB888,
+                .out_scale = JPEG_IMAGE_SCALE_0,
+                .out_rotation = rot,
+                .flags = {
+                    .mirror_x = mirror & 1,
+                    .mirror_y = (mirror >> 1) & 1,
+                }
+            };
+            esp_jpeg_image_output_t outimg;
+            esp_err_t err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+            TEST_ASSERT_EQUAL(ESP_OK, err);
+
+            for (int y = 0; y < TESTH; y++) {
+                for (int x = 0; x < TESTW; x++) {
+                    /* Position of reference pixel (x, y) in the output image */
+                    const int mx = (mirror & 1) ? TESTW - 1 - x : x;
+                    const int my = (mirror & 2) ? TESTH - 1 - y : y;
+                    int ox = mx, oy = my;
+                    if (rot == JPEG_IMAGE_ROTATE_90) {
+                        ox = TESTH - 1 - my;
+                        oy = mx;
+                    } else if (rot == JPEG_IMAGE_ROTATE_180) {
+                        ox = TESTW - 1 - mx;
+                        oy = TESTH - 1 - my;
+                    } else if (rot == JPEG_IMAGE_ROTATE_270) {
+                        ox = my;
+                        oy = TESTW - 1 - mx;
+                    }
+                    const unsigned char *o = &logo_rgb888[(y * TESTW + x) * 3];
+                    const unsigned char *p = &decoded[(oy * outimg.width + ox) * 3];
+                    /* The color can be +- 2 */
+                    TEST_ASSERT_UINT8_WITHIN(2, o[0], p[0]);
+                    TEST_ASSERT_UINT8_WITHIN(2, o[1], p[1]);
+                    TEST_ASSERT_UINT8_WITHIN(2, o[2], p[2]);
+                }
+            }
+        }
+    }
+
+    free(decoded);
+}
+
+/**
+ * @brief JPEG working buffer size test
+ *
+ * This test case verifies that the working buffer size reported for an image
+ * is exact: decoding succeeds with a buffer of exactly this size, reports
+ * the whole buffer as used and fails with a smaller buffer.
+ */
+TEST_CASE("Test JPEG working buffer size", "[esp_jpeg]")
+{
+    int decoded_outsize = TESTW * TESTH * 3;
+    unsigned char *decoded = malloc(decoded_outsize);
+    TEST_ASSERT_NOT_NULL(decoded);
+
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)logo_jpg,
+        .indata_size = logo_jpg_len,
+        .outbuf = decoded,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+        .advanced = {
+            .decoder = JPEG_DECODER_DEFAULT,
+        },
+    };
+    size_t size = 0;
+    esp_err_t err = esp_jpeg_get_work_buffer_size(&jpeg_cfg, &size);
+#if CONFIG_JD_USE_ROM
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, err);
+#else
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_GREATER_THAN(0, size);
+
+    /* Exact size */
+    uint8_t *working_buf = malloc(size);
+    TEST_ASSERT_NOT_NULL(working_buf);
+    jpeg_cfg.advanced.working_buffer = working_buf;
+    jpeg_cfg.advanced.working_buffer_size = size;
+    esp_jpeg_image_output_t outimg;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(size, outimg.work_buffer_used);
+
+    /* Smaller buffer */
+    jpeg_cfg.advanced.working_buffer_size = size - 4;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_FAIL, err);
+
+    /* Allocated buffer */
+    jpeg_cfg.advanced.working_buffer = NULL;
+    jpeg_cfg.advanced.working_buffer_size = 0;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(size, outimg.work_buffer_used);
+    free(working_buf);
+#endif
+    free(decoded);
+}
+
+/**
+ * @brief JPEG DC signature test
+ *
+ * This test case verifies that the luma DC signature of an image matches
+ * the 1:8 scaled decoded image (which is also built from DC values only)
+ * and that comparing signatures detects changed blocks.
+ */
+TEST_CASE("Test JPEG DC signature", "[esp_jpeg]")
+{
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)logo_jpg,
+        .indata_size = logo_jpg_len,
+    };
+
+    /* 1. Get signature size */
+    esp_jpeg_dc_signature_t sig = {0};
+    esp_err_t err = esp_jpeg_get_dc_signature(&jpeg_cfg, &sig);
+#if CONFIG_JD_USE_ROM
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, err);
+#else
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL((TESTW + 7) / 8, sig.blocks_w);
+    TEST_ASSERT_EQUAL((TESTH + 7) / 8, sig.blocks_h);
+
+    /* 2. Get signature */
+    sig.blocks_size = sig.blocks_w * sig.blocks_h;
+    sig.blocks = malloc(sig.blocks_size);
+    TEST_ASSERT_NOT_NULL(sig.blocks);
+    err = esp_jpeg_get_dc_signature(&jpeg_cfg, &sig);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+
+#if CONFIG_JD_USE_SCALE
+    /* 3. Compare with luminance of 1:8 scaled image */
+    const int outw = TESTW / 8, outh = TESTH / 8;
+    uint8_t *decoded = malloc(outw * outh * 3);
+    TEST_ASSERT_NOT_NULL(decoded);
+    jpeg_cfg.outbuf = decoded;
+    jpeg_cfg.outbuf_size = outw * outh * 3;
+    jpeg_cfg.out_format = JPEG_IMAGE_FORMAT_RGB888;
+    jpeg_cfg.out_scale = JPEG_IMAGE_SCALE_1_8;
+    esp_jpeg_image_output_t outimg;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    for (int y = 0; y < outh; y++) {
+        for (int x = 0; x < outw; x++) {
+            const uint8_t *p = &decoded[(y * outw + x) * 3];
+            const int luma = (299 * p[0] + 587 * p[1] + 114 * p[2]) / 1000;
+            TEST_ASSERT_UINT8_WITHIN(2, luma, sig.blocks[y * sig.blocks_w + x]);
+        }
+    }
+    free(decoded);
+#endif
+
+    /* 4. Compare signatures */
+    esp_jpeg_dc_signature_t changed = sig;
+    changed.blocks = malloc(sig.blocks_size);
+    TEST_ASSERT_NOT_NULL(changed.blocks);
+    memcpy(changed.blocks, sig.blocks, sig.blocks_size);
+
+    esp_jpeg_motion_t motion;
+    err = esp_jpeg_compare_dc_signature(&sig, &changed, 8, NULL, &motion);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(0, motion.changed_blocks);
+    TEST_ASSERT_EQUAL(0, motion.score);
+    TEST_ASSERT_EQUAL(sig.blocks_w * sig.blocks_h, motion.total_blocks);
+
+    uint8_t changed_map[sig.blocks_size];
+    changed.blocks[1] ^= 0x80;
+    changed.blocks[2] = sig.blocks[2] + (sig.blocks[2] < 128 ? 4 : -4);
+    err = esp_jpeg_compare_dc_signature(&sig, &changed, 8, changed_map, &motion);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(1, motion.changed_blocks);
+    TEST_ASSERT_EQUAL(128 + 4, motion.score);
+    TEST_ASSERT_EQUAL(0, changed_map[0]);
+    TEST_ASSERT_EQUAL(1, changed_map[1]);
+    TEST_ASSERT_EQUAL(0, changed_map[2]);
+
+    free(changed.blocks);
+    free(sig.blocks);
+#endif
+}
+
+/**
+ * @brief JPEG luma statistics test
+ *
+ * This test case verifies that the luma statistics collected while decoding
+ * cover every pixel of the image, that the histogram is consistent with them
+ * and that the mean luma matches the luma computed from the RGB888 output.
+ */
+TEST_CASE("Test JPEG luma statistics", "[esp_jpeg]")
+{
+    int decoded_outsize = TESTW * TESTH * 3;
+    uint8_t *decoded = malloc(decoded_outsize);
+    TEST_ASSERT_NOT_NULL(decoded);
+    uint32_t histogram[256];
+
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)logo_jpg,
+        .indata_size = logo_jpg_len,
+        .outbuf = decoded,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+        .flags = {
+            .luma_stats = 1,
+        },
+        .advanced = {
+            .luma_histogram = histogram,
+            .luma_histogram_bins = 256,
+        },
+    };
+    esp_jpeg_image_output_t outimg;
+    esp_err_t err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+#if CONFIG_JD_USE_ROM
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, err);
+#else
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(TESTW * TESTH, outimg.luma.samples);
+    TEST_ASSERT_LESS_OR_EQUAL(outimg.luma.mean, outimg.luma.min);
+    TEST_ASSERT_GREATER_OR_EQUAL(outimg.luma.mean, outimg.luma.max);
+
+    /* Histogram covers all samples and matches min/max */
+    uint32_t total = 0;
+    for (int i = 0; i < 256; i++) {
+        total += histogram[i];
+    }
+    TEST_ASSERT_EQUAL(TESTW * TESTH, total);
+    TEST_ASSERT_NOT_EQUAL(0, histogram[outimg.luma.min]);
+    TEST_ASSERT_NOT_EQUAL(0, histogram[outimg.luma.max]);
+
+    /* Mean luma is close to the luma of the decoded RGB image */
+    uint32_t sum = 0;
+    for (int x = 0; x < TESTW * TESTH; x++) {
+        const uint8_t *p = &decoded[x * 3];
+        sum += (299 * p[0] + 587 * p[1] + 114 * p[2]) / 1000;
+    }
+    TEST_ASSERT_UINT8_WITHIN(2, sum / (TESTW * TESTH), outimg.luma.mean);
+
+    /* 64 bins histogram */
+    jpeg_cfg.advanced.luma_histogram_bins = 64;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    total = 0;
+    for (int i = 0; i < 64; i++) {
+        total += histogram[i];
+    }
+    TEST_ASSERT_EQUAL(TESTW * TESTH, total);
+
+    /* Unsupported number of bins */
+    jpeg_cfg.advanced.luma_histogram_bins = 100;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, err);
+#endif
+    free(decoded);
+}
+
+/**
+ * @brief JPEG decoder selection test
+ *
+ * This test case verifies that the default and the faster decoder produce
+ * the same image, that the faster decoder is rejected when it is not built
+ * and that automatic selection uses the faster decoder only if it fits
+ * in the working buffer.
+ */
+TEST_CASE("Test JPEG decoder selection", "[esp_jpeg]")
+{
+    int decoded_outsize = TESTW * TESTH * 3;
+    uint8_t *decoded = malloc(decoded_outsize);
+    uint8_t *decoded_fast = malloc(decoded_outsize);
+    TEST_ASSERT_NOT_NULL(decoded);
+    TEST_ASSERT_NOT_NULL(decoded_fast);
+
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)logo_jpg,
+        .indata_size = logo_jpg_len,
+        .outbuf = decoded,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+        .advanced = {
+            .decoder = JPEG_DECODER_DEFAULT,
+        },
+    };
+    esp_jpeg_image_output_t outimg;
+    esp_err_t err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(JPEG_DECODER_DEFAULT, outimg.decoder);
+
+    jpeg_cfg.outbuf = decoded_fast;
+    jpeg_cfg.advanced.decoder = JPEG_DECODER_FAST;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+#if !CONFIG_JD_FAST_VARIANT
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, err);
+#else
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(JPEG_DECODER_FAST, outimg.decoder);
+    TEST_ASSERT_EQUAL_MEMORY(decoded, decoded_fast, decoded_outsize);
+
+    /* Automatic selection by size of the user working buffer */
+    size_t size = 0, size_fast = 0;
+    jpeg_cfg.advanced.decoder = JPEG_DECODER_DEFAULT;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_jpeg_get_work_buffer_size(&jpeg_cfg, &size));
+    jpeg_cfg.advanced.decoder = JPEG_DECODER_FAST;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_jpeg_get_work_buffer_size(&jpeg_cfg, &size_fast));
+    TEST_ASSERT_GREATER_THAN(size, size_fast);
+
+    uint8_t *working_buf = malloc(size_fast);
+    TEST_ASSERT_NOT_NULL(working_buf);
+    jpeg_cfg.advanced.decoder = JPEG_DECODER_AUTO;
+    jpeg_cfg.advanced.working_buffer = working_buf;
+    jpeg_cfg.advanced.working_buffer_size = size_fast;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(JPEG_DECODER_FAST, outimg.decoder);
+
+    jpeg_cfg.advanced.working_buffer_size = size;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(JPEG_DECODER_DEFAULT, outimg.decoder);
+    TEST_ASSERT_EQUAL_MEMORY(decoded, decoded_fast, decoded_outsize);
+    free(working_buf);
+#endif
+    free(decoded);
+    free(decoded_fast);
+}
+
+/**
+ * @brief JPEG profiling counters test
+ *
+ * This test case verifies that the per-stage counters are filled in only
+ * when profiling is enabled and that the block counts match the image.
+ */
+TEST_CASE("Test JPEG profiling counters", "[esp_jpeg]")
+{
+    int decoded_outsize = TESTW * TESTH * 3;
+    uint8_t *decoded = malloc(decoded_outsize);
+    TEST_ASSERT_NOT_NULL(decoded);
+
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)logo_jpg,
+        .indata_size = logo_jpg_len,
+        .outbuf = decoded,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+    };
+    esp_jpeg_image_output_t outimg;
+    esp_err_t err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+#if CONFIG_JD_PROFILE
+    TEST_ASSERT_GREATER_THAN(0, outimg.profile.mcus);
+    /* Y blocks of each MCU and one block of each chroma component */
+    TEST_ASSERT_EQUAL(0, outimg.profile.blocks % outimg.profile.mcus);
+    TEST_ASSERT_GREATER_OR_EQUAL(3, outimg.profile.blocks / outimg.profile.mcus);
+    TEST_ASSERT_LESS_OR_EQUAL(outimg.profile.blocks, outimg.profile.dc_blocks);
+    TEST_ASSERT_GREATER_THAN(0, outimg.profile.entropy_cycles);
+    TEST_ASSERT_GREATER_THAN(0, outimg.profile.idct_cycles);
+    TEST_ASSERT_GREATER_THAN(0, outimg.profile.color_cycles);
+    TEST_ASSERT_GREATER_THAN(0, outimg.profile.output_cycles);
+    TEST_ASSERT_EQUAL(0, outimg.profile.scale_cycles);
+
+    /* Descaling is counted separately */
+    jpeg_cfg.out_scale = JPEG_IMAGE_SCALE_1_2;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_GREATER_THAN(0, outimg.profile.scale_cycles);
+#else
+    TEST_ASSERT_EQUAL(0, outimg.profile.mcus);
+    TEST_ASSERT_EQUAL(0, outimg.profile.blocks);
+#endif
+    free(decoded);
+}
+
+/**
+ * @brief JPEG MCU row index test
+ *
+ * This test case verifies that every band of MCU rows decoded from the row
+ * index matches the same rows of the whole decoded image, also with an index
+ * restored from its serialized form.
+ */
+TEST_CASE("Test JPEG MCU row index", "[esp_jpeg]")
+{
+    int decoded_outsize = TESTW * TESTH * 3;
+    uint8_t *decoded = malloc(decoded_outsize);
+    uint8_t *band = malloc(decoded_outsize);
+    TEST_ASSERT_NOT_NULL(decoded);
+    TEST_ASSERT_NOT_NULL(band);
+
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)logo_jpg,
+        .indata_size = logo_jpg_len,
+        .outbuf = decoded,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+    };
+    esp_jpeg_row_index_t index = {
+        .interval = 2,
+    };
+    esp_err_t err = esp_jpeg_get_row_index(&jpeg_cfg, &index);
+#if CONFIG_JD_USE_ROM
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, err);
+#else
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(TESTW, index.width);
+    TEST_ASSERT_EQUAL(TESTH, index.height);
+    TEST_ASSERT_EQUAL((TESTH + index.mcu_height - 1) / index.mcu_height, index.mcu_rows);
+    TEST_ASSERT_EQUAL((index.mcu_rows + 1) / 2, index.mark_count);
+
+    esp_jpeg_row_mark_t *marks = calloc(index.mark_count, sizeof(esp_jpeg_row_mark_t));
+    TEST_ASSERT_NOT_NULL(marks);
+    index.marks = marks;
+    index.marks_size = index.mark_count;
+    err = esp_jpeg_get_row_index(&jpeg_cfg, &index);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+
+    /* Reference image */
+    esp_jpeg_image_output_t outimg;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+
+    /* Serialize and restore the index */
+    size_t len = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_jpeg_row_index_serialize(&index, NULL, 0, &len));
+    uint8_t *serialized = malloc(len);
+    TEST_ASSERT_NOT_NULL(serialized);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_jpeg_row_index_serialize(&index, serialized, len, &len));
+    esp_jpeg_row_mark_t *restored_marks = calloc(index.mark_count, sizeof(esp_jpeg_row_mark_t));
+    TEST_ASSERT_NOT_NULL(restored_marks);
+    esp_jpeg_row_index_t restored = {
+        .marks = restored_marks,
+        .marks_size = index.mark_count,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, esp_jpeg_row_index_deserialize(serialized, len, &restored));
+    TEST_ASSERT_EQUAL(index.mark_count, restored.mark_count);
+    TEST_ASSERT_EQUAL_MEMORY(marks, restored_marks, index.mark_count * sizeof(esp_jpeg_row_mark_t));
+    serialized[0] ^= 0xFF;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_VERSION, esp_jpeg_row_index_deserialize(serialized, len, &restored));
+
+    /* Every band of one MCU row */
+    jpeg_cfg.outbuf = band;
+    for (uint16_t row = 0; row < restored.mcu_rows; row++) {
+        const int top = row * restored.mcu_height;
+        const int rows = (top + restored.mcu_height <= TESTH) ? restored.mcu_height : TESTH - top;
+        err = esp_jpeg_decode_rows(&jpeg_cfg, &restored, row, 1, &outimg);
+        TEST_ASSERT_EQUAL(ESP_OK, err);
+        TEST_ASSERT_EQUAL(TESTW, outimg.width);
+        TEST_ASSERT_EQUAL(rows, outimg.height);
+        TEST_ASSERT_EQUAL_MEMORY(decoded + top * TESTW * 3, band, rows * TESTW * 3);
+    }
+
+    /* Out of the image */
+    err = esp_jpeg_decode_rows(&jpeg_cfg, &restored, restored.mcu_rows, 1, &outimg);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, err);
+
+    free(serialized);
+    free(restored_marks);
+    free(marks);
+#endif
+    free(decoded);
+    free(band);
+}
+
+/**
+ * @brief JPEG scatter-gather input test
+ *
+ * This test case verifies that an image split across several input buffers
+ * of different sizes (including empty ones) decodes to the same output
+ * as the image in one buffer.
+ */
+TEST_CASE("Test JPEG decompression from several input buffers", "[esp_jpeg]")
+{
+    int decoded_outsize = TESTW * TESTH * 3;
+    uint8_t *decoded = malloc(decoded_outsize);
+    uint8_t *decoded_seg = malloc(decoded_outsize);
+    TEST_ASSERT_NOT_NULL(decoded);
+    TEST_ASSERT_NOT_NULL(decoded_seg);
+
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)logo_jpg,
+        .indata_size = logo_jpg_len,
+        .outbuf = decoded,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+    };
+    esp_jpeg_image_output_t outimg;
+    esp_err_t err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+
+    /* Split the image: header split inside a marker, an empty buffer, entropy data split in small parts */
+    const uint8_t *p = logo_jpg;
+    const esp_jpeg_segment_t segments[] = {
+        { .data = p,       .size = 3 },
+        { .data = p + 3,   .size = 0 },
+        { .data = p + 3,   .size = 150 },
+        { .data = p + 153, .size = 1 },
+        { .data = p + 154, .size = 400 },
+        { .data = p + 554, .size = 33 },
+        { .data = p + 587, .size = logo_jpg_len - 587 },
+    };
+    esp_jpeg_image_cfg_t jpeg_cfg_seg = {
+        .insegments = segments,
+        .insegments_count = sizeof(segments) / sizeof(segments[0]),
+        .outbuf = decoded_seg,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+    };
+    err = esp_jpeg_get_image_info(&jpeg_cfg_seg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(TESTW, outimg.width);
+    TEST_ASSERT_EQUAL(TESTH, outimg.height);
+
+    err = esp_jpeg_decode(&jpeg_cfg_seg, &outimg);
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL_MEMORY(decoded, decoded_seg, decoded_outsize);
+
+    /* Truncated image */
+    jpeg_cfg_seg.insegments_count--;
+    err = esp_jpeg_decode(&jpeg_cfg_seg, &outimg);
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, err);
+
+    free(decoded);
+    free(decoded_seg);
+}
+
+/**
+ * @brief JPEG BGR888 and 32-bit output formats test
+ *
+ * This test case verifies that BGR888, RGBA8888 and ARGB8888 outputs hold
+ * the same colors as RGB888 output, with swapped color bytes and rotation.
+ */
+TEST_CASE("Test JPEG decompression library: BGR888 and 32-bit formats", "[esp_jpeg]")
+{
+    const int pixels = TESTW * TESTH;
+    uint8_t *rgb = malloc(pixels * 3);
+    uint8_t *out = malloc(pixels * 4); /* 4-byte aligned */
+    TEST_ASSERT_NOT_NULL(rgb);
+    TEST_ASSERT_NOT_NULL(out);
+
+    for (int rotation = JPEG_IMAGE_ROTATE_0; rotation <= JPEG_IMAGE_ROTATE_270; rotation++) {
+        esp_jpeg_image_cfg_t jpeg_cfg = {
+            .indata = (uint8_t *)logo_jpg,
+            .indata_size = logo_jpg_len,
+            .outbuf = rgb,
+            .outbuf_size = pixels * 3,
+            .out_format = JPEG_IMAGE_FORMAT_RGB888,
+            .out_scale = JPEG_IMAGE_SCALE_0,
+            .out_rotation = rotation,
+        };
+        esp_jpeg_image_output_t outimg;
+        esp_err_t err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+        TEST_ASSERT_EQUAL(ESP_OK, err);
+
+        jpeg_cfg.outbuf = out;
+        jpeg_cfg.outbuf_size = pixels * 4;
+
+        jpeg_cfg.out_format = JPEG_IMAGE_FORMAT_BGR888;
+        err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+        TEST_ASSERT_EQUAL(ESP_OK, err);
+        TEST_ASSERT_EQUAL(pixels * 3, outimg.output_len);
+        for (int i = 0; i < pixels; i++) {
+            TEST_ASSERT_EQUAL(rgb[i * 3 + 0], out[i * 3 + 2]);
+            TEST_ASSERT_EQUAL(rgb[i * 3 + 1], out[i * 3 + 1]);
+            TEST_ASSERT_EQUAL(rgb[i * 3 + 2], out[i * 3 + 0]);
+        }
+
+        jpeg_cfg.out_format = JPEG_IMAGE_FORMAT_RGBA8888;
+        err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+        TEST_ASSERT_EQUAL(ESP_OK, err);
+        TEST_ASSERT_EQUAL(pixels * 4, outimg.output_len);
+        for (int i = 0; i < pixels; i++) {
+            TEST_ASSERT_EQUAL_MEMORY(&rgb[i * 3], &out[i * 4], 3);
+            TEST_ASSERT_EQUAL(0xFF, out[i * 4 + 3]);
+        }
+
+        jpeg_cfg.out_format = JPEG_IMAGE_FORMAT_ARGB8888;
+        err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+        TEST_ASSERT_EQUAL(ESP_OK, err);
+        for (int i = 0; i < pixels; i++) {
+            TEST_ASSERT_EQUAL(0xFF, out[i * 4]);
+            TEST_ASSERT_EQUAL_MEMORY(&rgb[i * 3], &out[i * 4 + 1], 3);
+        }
+
+        /* ARGB8888 with swapped bytes is BGRA8888 */
+        jpeg_cfg.flags.swap_color_bytes = 1;
+        err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+        TEST_ASSERT_EQUAL(ESP_OK, err);
+        for (int i = 0; i < pixels; i++) {
+            TEST_ASSERT_EQUAL(rgb[i * 3 + 2], out[i * 4 + 0]);
+            TEST_ASSERT_EQUAL(rgb[i * 3 + 1], out[i * 4 + 1]);
+            TEST_ASSERT_EQUAL(rgb[i * 3 + 0], out[i * 4 + 2]);
+            TEST_ASSERT_EQUAL(0xFF, out[i * 4 + 3]);
+        }
+    }
+
+    /* 32-bit formats need aligned output buffer */
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)logo_jpg,
+        .indata_size = logo_jpg_len,
+        .outbuf = out + 1,
+        .outbuf_size = pixels * 4 - 1,
+        .out_format = JPEG_IMAGE_FORMAT_RGBA8888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+    };
+    esp_jpeg_image_output_t outimg;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_jpeg_decode(&jpeg_cfg, &outimg));
+
+    free(rgb);
+    free(out);
+}
+
+typedef struct {
+    int calls;              /* Number of previews */
+    uint16_t last_scans;    /* Scans of the last preview */
+    bool first_blocky;      /* First preview has uniform 8x8 blocks */
+} test_preview_t;
+
+static bool test_preview_cb(esp_jpeg_image_cfg_t *cfg, uint16_t scans, void *arg)
+{
+    test_preview_t *preview = (test_preview_t *)arg;
+
+    if (preview->calls++ == 0) {
+        /* Only DC coefficients are known after the first scan */
+        preview->first_blocky = true;
+        for (int y = 0; y < TESTH; y++) {
+            for (int x = 0; x < TESTW; x++) {
+                const uint8_t *p = &cfg->outbuf[(y * TESTW + x) * 3];
+                const uint8_t *b = &cfg->outbuf[((y & ~7) * TESTW + (x & ~7)) * 3];
+                if (memcmp(p, b, 3) != 0) {
+                    preview->first_blocky = false;
+                }
+            }
+        }
+    }
+    preview->last_scans = scans;
+    return true;
+}
+
+/**
+ * @brief JPEG progressive decompression test
+ *
+ * This test case verifies that a progressive JPEG image is decoded to the same
+ * picture as the baseline image it was converted from, that the preview callback is called after each
+ * scan but the last one, and that a user coefficient buffer is checked for size.
+ */
+TEST_CASE("Test JPEG progressive decompression", "[esp_jpeg]")
+{
+    int decoded_outsize = TESTW * TESTH * 3;
+    uint8_t *decoded = malloc(decoded_outsize);
+    TEST_ASSERT_NOT_NULL(decoded);
+
+    test_preview_t preview = { 0 };
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)logo_progressive_jpg,
+        .indata_size = logo_progressive_jpg_len,
+        .outbuf = decoded,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+        .advanced = {
+            .preview_cb = test_preview_cb,
+            .preview_arg = &preview,
+        },
+    };
+    esp_jpeg_image_output_t outimg;
+    esp_err_t err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    size_t size = 0;
+#if !CONFIG_JD_PROGRESSIVE
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, esp_jpeg_get_coef_buffer_size(&jpeg_cfg, &size));
+#else
+    TEST_ASSERT_EQUAL(ESP_OK, err);
+    TEST_ASSERT_EQUAL(TESTW, outimg.width);
+    TEST_ASSERT_EQUAL(TESTH, outimg.height);
+    TEST_ASSERT_GREATER_THAN(1, outimg.scans);
+    TEST_ASSERT_EQUAL(outimg.scans - 1, preview.calls);
+    TEST_ASSERT_EQUAL(outimg.scans - 1, preview.last_scans);
+    TEST_ASSERT_TRUE(preview.first_blocky);
+
+    /* Same coefficients as the baseline image, the color can be +- 2 */
+    for (int i = 0; i < decoded_outsize; i++) {
+        TEST_ASSERT_UINT8_WITHIN(2, logo_rgb888[i], decoded[i]);
+    }
+
+    /* Coefficient buffer provided by the user */
+    TEST_ASSERT_EQUAL(ESP_OK, esp_jpeg_get_coef_buffer_size(&jpeg_cfg, &size));
+    TEST_ASSERT_EQUAL(((TESTW + 7) / 8) * ((TESTH + 7) / 8) * 3 * 64 * sizeof(int16_t), size);
+    uint8_t *coef = malloc(size);
+    uint8_t *decoded2 = malloc(decoded_outsize);
+    TEST_ASSERT_NOT_NULL(coef);
+    TEST_ASSERT_NOT_NULL(decoded2);
+    jpeg_cfg.outbuf = decoded2;
+    jpeg_cfg.advanced.preview_cb = NULL;
+    jpeg_cfg.advanced.coef_buffer = coef;
+    jpeg_cfg.advanced.coef_buffer_size = size - 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, esp_jpeg_decode(&jpeg_cfg, &outimg));
+    jpeg_cfg.advanced.coef_buffer_size = size;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_jpeg_decode(&jpeg_cfg, &outimg));
+    TEST_ASSERT_EQUAL_MEMORY(decoded, decoded2, decoded_outsize);
+
+    /* Exact working buffer, with a quantization table defined between the scans (loaded by a later scan) */
+    const uint8_t dqt[] = { 0xFF, 0xDB, 0x00, 0x43, 0x03 };
+    size_t sos = logo_progressive_jpg_len - 2;
+    while (sos > 0 && !(logo_progressive_jpg[sos] == 0xFF && logo_progressive_jpg[sos + 1] == 0xDA)) {
+        sos--;
+    }
+    TEST_ASSERT_GREATER_THAN(0, sos);
+    uint8_t *redefined = malloc(logo_progressive_jpg_len + sizeof(dqt) + 64);
+    TEST_ASSERT_NOT_NULL(redefined);
+    memcpy(redefined, logo_progressive_jpg, sos);
+    memcpy(redefined + sos, dqt, sizeof(dqt));
+    memset(redefined + sos + sizeof(dqt), 1, 64);
+    memcpy(redefined + sos + sizeof(dqt) + 64, logo_progressive_jpg + sos, logo_progressive_jpg_len - sos);
+    size_t work_size = 0, work_size_redefined = 0;
+    jpeg_cfg.advanced.decoder = JPEG_DECODER_DEFAULT;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_jpeg_get_work_buffer_size(&jpeg_cfg, &work_size));
+    jpeg_cfg.indata = redefined;
+    jpeg_cfg.indata_size = logo_progressive_jpg_len + sizeof(dqt) + 64;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_jpeg_get_work_buffer_size(&jpeg_cfg, &work_size_redefined));
+    TEST_ASSERT_EQUAL(work_size + 64 * sizeof(int32_t), work_size_redefined);
+    uint8_t *working_buf = malloc(work_size_redefined);
+    TEST_ASSERT_NOT_NULL(working_buf);
+    jpeg_cfg.advanced.working_buffer = working_buf;
+    jpeg_cfg.advanced.working_buffer_size = work_size_redefined;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_jpeg_decode(&jpeg_cfg, &outimg));
+    TEST_ASSERT_EQUAL(work_size_redefined, outimg.work_buffer_used);
+    TEST_ASSERT_EQUAL_MEMORY(decoded, decoded2, decoded_outsize);
+    jpeg_cfg.advanced.working_buffer_size = work_size_redefined - 4;
+    TEST_ASSERT_EQUAL(ESP_FAIL, esp_jpeg_decode(&jpeg_cfg, &outimg));
+    jpeg_cfg.advanced.working_buffer = NULL;
+    jpeg_cfg.advanced.working_buffer_size = 0;
+    jpeg_cfg.advanced.decoder = JPEG_DECODER_AUTO;
+    jpeg_cfg.indata = (uint8_t *)logo_progressive_jpg;
+    jpeg_cfg.indata_size = logo_progressive_jpg_len;
+    free(working_buf);
+    free(redefined);
+
+    /* Row index needs a baseline image */
+    esp_jpeg_row_index_t index = { .interval = 1 };
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, esp_jpeg_get_row_index(&jpeg_cfg, &index));
+
+    /* No coefficient buffer for a baseline image */
+    jpeg_cfg.indata = (uint8_t *)logo_jpg;
+    jpeg_cfg.indata_size = logo_jpg_len;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_jpeg_get_coef_buffer_size(&jpeg_cfg, &size));
+    TEST_ASSERT_EQUAL(0, size);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_jpeg_decode(&jpeg_cfg, &outimg));
+    TEST_ASSERT_EQUAL(1, outimg.scans);
+
+    free(coef);
+    free(decoded2);
+#endif
+    free(decoded);
+}
@@ -0,0 +1,2934 @@
+/*----------------------------------------------------------------------------/
+/ TJpgDec - Tiny JPEG Decompressor R0.03                      (C)ChaN, 2021
+/-----------------------------------------------------------------------------/
+/ The TJpgDec is a generic JPEG decompressor module for tiny embedded systems.
+/ This is a free software that opened for education, research and commercial
+/  developments under license policy of following terms.
+/
+/  Copyright (C) 2021, ChaN, all right reserved.
+/
+/ * The TJpgDec module is a free software and there is NO WARRANTY.
+/ * No restriction on use. You can use, modify and redistribute it for
+/   personal, non-profit or commercial products UNDER YOUR RESPONSIBILITY.
+/ * Redistributions of source code must retain the above copyright notice.
+/
+/-----------------------------------------------------------------------------/
+/ Oct 04, 2011 R0.01  First release.
+/ Feb 19, 2012 R0.01a Fixed decompression fails when scan starts with an escape seq.
+/ Sep 03, 2012 R0.01b Added JD_TBLCLIP option.
+/ Mar 16, 2019 R0.01c Supprted stdint.h.
+/ Jul 01, 2020 R0.01d Fixed wrong integer type usage.
+/ May 08, 2021 R0.02  Supprted grayscale image. Separated configuration options.
+/ Jun 11, 2021 R0.02a Some performance improvement.
+/ Jul 01, 2021 R0.03  Added JD_FASTDECODE option.
+/                     Some performance improvement.
+/----------------------------------------------------------------------------*/
+
+#include "tjpgd.h"
+
+#if JD_PROFILE
+#if defined(ESP_PLATFORM)
+#include "esp_cpu.h"
+#define PROF_TICKS()    ((uint32_t)esp_cpu_get_cycle_count())   /* CPU cycles */
+#else
+#include <time.h>
+static uint32_t PROF_TICKS (void)   /* Nanoseconds */
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+#endif
+#define PROF_START(jd)          (jd)->prof.mark = PROF_TICKS()
+#define PROF_ADD(jd, cnt)       do { uint32_t t = PROF_TICKS(); (jd)->prof.cnt += t - (jd)->prof.mark; (jd)->prof.mark = t; } while (0)  /* Count time since the last stage */
+#define PROF_INC(jd, cnt)       (jd)->prof.cnt++
+#else
+#define PROF_START(jd)
+#define PROF_ADD(jd, cnt)
+#define PROF_INC(jd, cnt)
+#endif
+
+
+#if JD_FASTDECODE == 2
+#define HUFF_BIT    10  /* Bit length to apply fast huffman decode */
+#define HUFF_LEN    (1 << HUFF_BIT)
+#define HUFF_MASK   (HUFF_LEN - 1)
+#endif
+
+#if JD_PROGRESSIVE
+#define PROGRESSIVE(jd)             ((jd)->progressive)
+#define HUFF_MAXCODE                256     /* Max number of code words in a huffman table of progressive JPEG */
+#define HUFF_REUSE(jd, num, cls)    ((jd)->htmax >> ((num) * 2 + (cls)) & 1)   /* Table redefined between scans is loaded into the same memory */
+#else
+#define PROGRESSIVE(jd)             0
+#define HUFF_REUSE(jd, num, cls)    0
+#endif
+
+
+/*-----------------------------------------------*/
+/* Zigzag-order to raster-order conversion table */
+/*-----------------------------------------------*/
+
+static const uint8_t Zig[64] = {    /* Zigzag-order to raster-order conversion table */
+    0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+};
+
+
+
+/*-------------------------------------------------*/
+/* Input scale factor of Arai algorithm            */
+/* (scaled up 16 bits for fixed point operations)  */
+/*-------------------------------------------------*/
+
+static const uint16_t Ipsf[64] = {  /* See also aa_idct.png */
+    (uint16_t)(1.00000 * 8192), (uint16_t)(1.38704 * 8192), (uint16_t)(1.30656 * 8192), (uint16_t)(1.17588 * 8192), (uint16_t)(1.00000 * 8192), (uint16_t)(0.78570 * 8192), (uint16_t)(0.54120 * 8192), (uint16_t)(0.27590 * 8192),
+    (uint16_t)(1.38704 * 8192), (uint16_t)(1.92388 * 8192), (uint16_t)(1.81226 * 8192), (uint16_t)(1.63099 * 8192), (uint16_t)(1.38704 * 8192), (uint16_t)(1.08979 * 8192), (uint16_t)(0.75066 * 8192), (uint16_t)(0.38268 * 8192),
+    (uint16_t)(1.30656 * 8192), (uint16_t)(1.81226 * 8192), (uint16_t)(1.70711 * 8192), (uint16_t)(1.53636 * 8192), (uint16_t)(1.30656 * 8192), (uint16_t)(1.02656 * 8192), (uint16_t)(0.70711 * 8192), (uint16_t)(0.36048 * 8192),
+    (uint16_t)(1.17588 * 8192), (uint16_t)(1.63099 * 8192), (uint16_t)(1.53636 * 8192), (uint16_t)(1.38268 * 8192), (uint16_t)(1.17588 * 8192), (uint16_t)(0.92388 * 8192), (uint16_t)(0.63638 * 8192), (uint16_t)(0.32442 * 8192),
+    (uint16_t)(1.00000 * 8192), (uint16_t)(1.38704 * 8192), (uint16_t)(1.30656 * 8192), (uint16_t)(1.17588 * 8192), (uint16_t)(1.00000 * 8192), (uint16_t)(0.78570 * 8192), (uint16_t)(0.54120 * 8192), (uint16_t)(0.27590 * 8192),
+    (uint16_t)(0.78570 * 8192), (uint16_t)(1.08979 * 8192), (uint16_t)(1.02656 * 8192), (uint16_t)(0.92388 * 8192), (uint16_t)(0.78570 * 8192), (uint16_t)(0.61732 * 8192), (uint16_t)(0.42522 * 8192), (uint16_t)(0.21677 * 8192),
+    (uint16_t)(0.54120 * 8192), (uint16_t)(0.75066 * 8192), (uint16_t)(0.70711 * 8192), (uint16_t)(0.63638 * 8192), (uint16_t)(0.54120 * 8192), (uint16_t)(0.42522 * 8192), (uint16_t)(0.29290 * 8192), (uint16_t)(0.14932 * 8192),
+    (uint16_t)(0.27590 * 8192), (uint16_t)(0.38268 * 8192), (uint16_t)(0.36048 * 8192), (uint16_t)(0.32442 * 8192), (uint16_t)(0.27590 * 8192), (uint16_t)(0.21678 * 8192), (uint16_t)(0.14932 * 8192), (uint16_t)(0.07612 * 8192)
+};
+
+
+
+/*---------------------------------------------*/
+/* Conversion table for fast clipping process  */
+/*---------------------------------------------*/
+
+#if JD_TBLCLIP
+
+#define BYTECLIP(v) Clip8[(unsigned int)(v) & 0x3FF]
+
+static const uint8_t Clip8[1024] = {
+    /* 0..255 */
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+    32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63,
+    64, 65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95,
+    96, 97, 98, 99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125, 126, 127,
+    128, 129, 130, 131, 132, 133, 134, 135, 136, 137, 138, 139, 140, 141, 142, 143, 144, 145, 146, 147, 148, 149, 150, 151, 152, 153, 154, 155, 156, 157, 158, 159,
+    160, 161, 162, 163, 164, 165, 166, 167, 168, 169, 170, 171, 172, 173, 174, 175, 176, 177, 178, 179, 180, 181, 182, 183, 184, 185, 186, 187, 188, 189, 190, 191,
+    192, 193, 194, 195, 196, 197, 198, 199, 200, 201, 202, 203, 204, 205, 206, 207, 208, 209, 210, 211, 212, 213, 214, 215, 216, 217, 218, 219, 220, 221, 222, 223,
+    224, 225, 226, 227, 228, 229, 230, 231, 232, 233, 234, 235, 236, 237, 238, 239, 240, 241, 242, 243, 244, 245, 246, 247, 248, 249, 250, 251, 252, 253, 254, 255,
+    /* 256..511 */
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    /* -512..-257 */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    /* -256..-1 */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+#else   /* JD_TBLCLIP */
+
+static uint8_t BYTECLIP (int val)
+{
+    if (val < 0) {
+        return 0;
+    }
+    if (val > 255) {
+        return 255;
+    }
+    return (uint8_t)val;
+}
+
+#endif
+
+
+
+#if JD_FORMAT == 1
+/*---------------------------------------------------*/
+/* Chroma contribution tables for RGB565 output      */
+/*---------------------------------------------------*/
+
+#define CV_ACC      ((sizeof (int) > 2) ? 1024 : 128)   /* Adaptive accuracy for both 16-/32-bit systems */
+#define CV_R(c)     (int16_t)((int32_t)(1.402 * CV_ACC) * ((c) - 128) / CV_ACC)   /* Cr -> R offset */
+#define CV_B(c)     (int16_t)((int32_t)(1.772 * CV_ACC) * ((c) - 128) / CV_ACC)   /* Cb -> B offset */
+#define CV_GB(c)    ((int32_t)(0.344 * CV_ACC) * ((c) - 128))    /* Cb -> G offset (not descaled) */
+#define CV_GR(c)    ((int32_t)(0.714 * CV_ACC) * ((c) - 128))    /* Cr -> G offset (not descaled) */
+#define CV_T4(f, c)     f(c), f(c + 1), f(c + 2), f(c + 3)
+#define CV_T16(f, c)    CV_T4(f, c), CV_T4(f, c + 4), CV_T4(f, c + 8), CV_T4(f, c + 12)
+#define CV_T64(f, c)    CV_T16(f, c), CV_T16(f, c + 16), CV_T16(f, c + 32), CV_T16(f, c + 48)
+#define CV_T256(f)      CV_T64(f, 0), CV_T64(f, 64), CV_T64(f, 128), CV_T64(f, 192)
+
+static const int16_t CvCrR[256] = { CV_T256(CV_R) };
+static const int16_t CvCbB[256] = { CV_T256(CV_B) };
+static const int32_t CvCbG[256] = { CV_T256(CV_GB) };
+static const int32_t CvCrG[256] = { CV_T256(CV_GR) };
+#endif
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Allocate a memory block from memory pool                              */
+/*-----------------------------------------------------------------------*/
+
+static void *alloc_pool (   /* Pointer to allocated memory block (NULL:no memory available) */
+    JDEC *jd,               /* Pointer to the decompressor object */
+    size_t ndata            /* Number of bytes to allocate */
+)
+{
+    char *rp = 0;
+
+
+    ndata = (ndata + 3) & ~3;           /* Align block size to the word boundary */
+
+    if (jd->sz_pool >= ndata) {
+        jd->sz_pool -= ndata;
+        rp = (char *)jd->pool;          /* Get start of available memory pool */
+        jd->pool = (void *)(rp + ndata); /* Allocate requierd bytes */
+    }
+
+    return (void *)rp;  /* Return allocated memory block (NULL:no memory to allocate) */
+}
+
+
+
+#if JD_FASTDECODE == 2
+/*-----------------------------------------------------------------------*/
+/* Create fast huffman decode table for a loaded huffman table           */
+/*-----------------------------------------------------------------------*/
+
+static JRESULT create_huffman_lut ( /* 0:OK, !0:Failed */
+    JDEC *jd,               /* Pointer to the decompressor object */
+    unsigned int cls,       /* Table class dc(0)/ac(1) */
+    unsigned int num        /* Table number 0/1 */
+)
+{
+    unsigned int i, j, b, span, td, ti;
+    const uint8_t *pb = jd->huffbits[num][cls], *pd = jd->huffdata[num][cls];
+    const uint16_t *ph = jd->huffcode[num][cls];
+    uint16_t *tbl_ac = 0;
+    uint8_t *tbl_dc = 0;
+
+
+    if (cls) {
+        tbl_ac = HUFF_REUSE(jd, num, cls) ? jd->hufflut_ac[num] : alloc_pool(jd, HUFF_LEN * sizeof (uint16_t));  /* LUT for AC elements */
+        if (!tbl_ac) {
+            return JDR_MEM1;    /* Err: not enough memory */
+        }
+        jd->hufflut_ac[num] = tbl_ac;
+        memset(tbl_ac, 0xFF, HUFF_LEN * sizeof (uint16_t));     /* Default value (0xFFFF: may be long code) */
+    } else {
+        tbl_dc = HUFF_REUSE(jd, num, cls) ? jd->hufflut_dc[num] : alloc_pool(jd, HUFF_LEN * sizeof (uint8_t));   /* LUT for AC elements */
+        if (!tbl_dc) {
+            return JDR_MEM1;    /* Err: not enough memory */
+        }
+        jd->hufflut_dc[num] = tbl_dc;
+        memset(tbl_dc, 0xFF, HUFF_LEN * sizeof (uint8_t));      /* Default value (0xFF: may be long code) */
+    }
+    for (i = b = 0; b < HUFF_BIT; b++) {    /* Create LUT */
+        for (j = pb[b]; j; j--) {
+            ti = ph[i] << (HUFF_BIT - 1 - b) & HUFF_MASK;   /* Index of input pattern for the code */
+            if (cls) {
+                td = pd[i++] | ((b + 1) << 8);  /* b15..b8: code length, b7..b0: zero run and data length */
+                for (span = 1 << (HUFF_BIT - 1 - b); span; span--, tbl_ac[ti++] = (uint16_t)td) ;
+            } else {
+                td = pd[i++] | ((b + 1) << 4);  /* b7..b4: code length, b3..b0: data length */
+                for (span = 1 << (HUFF_BIT - 1 - b); span; span--, tbl_dc[ti++] = (uint8_t)td) ;
+            }
+        }
+    }
+    jd->longofs[num][cls] = i;  /* Code table offset for long code */
+
+    return JDR_OK;
+}
+#endif
+
+
+
+#if JD_DEFAULT_HUFFMAN
+/*-----------------------------------------------------------------------*/
+/* Load default Huffman table                                            */
+/*-----------------------------------------------------------------------*/
+
+extern unsigned char esp_jpeg_lum_dc_num_bits[], esp_jpeg_lum_dc_values[];
+extern unsigned char esp_jpeg_chrom_dc_num_bits[], esp_jpeg_chrom_dc_values[];
+extern unsigned char esp_jpeg_lum_ac_num_bits[], esp_jpeg_lum_ac_values[];
+extern unsigned char esp_jpeg_chrom_ac_num_bits[], esp_jpeg_chrom_ac_values[];
+extern unsigned esp_jpeg_lum_dc_codes_total, esp_jpeg_lum_ac_codes_total, esp_jpeg_chrom_dc_codes_total, esp_jpeg_chrom_ac_codes_total;
+JRESULT jd_load_default_huffman (JDEC *jd)
+{
+    // Variable declarations to keep a similar structure to create_huffman_tbl()
+    unsigned int i, j, b;
+    uint8_t *pb;
+    uint16_t hc, *ph;
+
+    // Group default tables for Y/CbCr channels and DC/AC components to access them in loops
+    // These arrays store predefined Huffman bit lengths and values for JPEG decoding
+    unsigned char *num_bits[2][2] = {
+        {esp_jpeg_lum_dc_num_bits, esp_jpeg_lum_ac_num_bits},   // Luminance (Y) DC and AC bit lengths
+        {esp_jpeg_chrom_dc_num_bits, esp_jpeg_chrom_ac_num_bits} // Chrominance (CbCr) DC and AC bit lengths
+    };
+    unsigned codes_total[2][2] = {
+        {esp_jpeg_lum_dc_codes_total, esp_jpeg_lum_ac_codes_total},   // Total codes for Y DC and AC components
+        {esp_jpeg_chrom_dc_codes_total, esp_jpeg_chrom_ac_codes_total} // Total codes for CbCr DC and AC components
+    };
+    unsigned char *values[2][2] = {
+        {esp_jpeg_lum_dc_values, esp_jpeg_lum_ac_values},   // Default Huffman values for Y DC and AC components
+        {esp_jpeg_chrom_dc_values, esp_jpeg_chrom_ac_values} // Default Huffman values for CbCr DC and AC components
+    };
+
+    // Loop over Y/CbCr channels and DC/AC components to initialize Huffman tables
+    for (int ycbcr = 0; ycbcr < 2; ycbcr++) { // Loop for Luminance (Y) and Chrominance (CbCr)
+        for (int dcac = 0; dcac < 2; dcac++) { // Loop for DC and AC tables
+            // Assign the bit lengths and values arrays to Huffman table fields in the JDEC structure
+            jd->huffbits[ycbcr][dcac] = num_bits[ycbcr][dcac];
+            jd->huffdata[ycbcr][dcac] = values[ycbcr][dcac];
+
+            // Calculate Huffman codes from bit lengths to construct codeword tables
+            pb = num_bits[ycbcr][dcac]; // Access bit length array
+            size_t np = codes_total[ycbcr][dcac]; // Total number of codes
+
+            // The bits and values are usually in the Huffman table of the JPEG picture.
+            // The codes themselves must be calculated based on the bits and values; that is what we do here.
+            // Since this function uses default bits and values that are constant and known at compile time,
+            // We could optimize this even more by providing pre-calculated codes too...
+
+            // Allocate memory for the Huffman codeword table
+            ph = alloc_pool(jd, np * sizeof(uint16_t));
+            if (!ph) {
+                return JDR_MEM1;    // Error: Memory allocation failed
+            }
+            jd->huffcode[ycbcr][dcac] = ph; // Store allocated memory address for code table
+            hc = 0; // Initialize Huffman code
+
+            // Generate Huffman codes based on the bit lengths in pb
+            for (j = i = 0; i < 16; i++) { // Iterate over 16 possible code lengths
+                b = pb[i]; // Number of codes with length (i+1) bits
+                while (b--) {
+                    ph[j++] = hc++; // Assign code and increment index
+                }
+                hc <<= 1; // Left shift code to increase bit length
+            }
+#if JD_FASTDECODE == 2
+            // Fast huffman decode table, as for tables loaded from the picture
+            if (create_huffman_lut(jd, dcac, ycbcr)) {
+                return JDR_MEM1;
+            }
+#endif
+        }
+    }
+    return JDR_OK; // Return success status
+}
+#endif
+
+/*-----------------------------------------------------------------------*/
+/* Create de-quantization and prescaling tables with a DQT segment       */
+/*-----------------------------------------------------------------------*/
+
+static JRESULT create_qt_tbl (  /* 0:OK, !0:Failed */
+    JDEC *jd,               /* Pointer to the decompressor object */
+    const uint8_t *data,    /* Pointer to the quantizer tables */
+    size_t ndata            /* Size of input data */
+)
+{
+    unsigned int i, zi;
+    uint8_t d;
+    int32_t *pb;
+
+
+    while (ndata) { /* Process all tables in the segment */
+        if (ndata < 65) {
+            return JDR_FMT1;    /* Err: table size is unaligned */
+        }
+        ndata -= 65;
+        d = *data++;                            /* Get table property */
+        if (d & 0xF0) {
+            return JDR_FMT1;    /* Err: not 8-bit resolution */
+        }
+        i = d & 3;                              /* Get table ID */
+        pb = (PROGRESSIVE(jd) && jd->qttbl[i]) ? jd->qttbl[i] : alloc_pool(jd, 64 * sizeof (int32_t));/* Allocate a memory block for the table (redefined table of progressive JPEG is loaded into the same memory) */
+        if (!pb) {
+            return JDR_MEM1;    /* Err: not enough memory */
+        }
+        jd->qttbl[i] = pb;                      /* Register the table */
+        for (i = 0; i < 64; i++) {              /* Load the table */
+            zi = Zig[i];                        /* Zigzag-order to raster-order conversion */
+            pb[zi] = (int32_t)((uint32_t) * data++ * Ipsf[zi]); /* Apply scale factor of Arai algorithm to the de-quantizers */
+        }
+    }
+
+    return JDR_OK;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Create huffman code tables with a DHT segment                         */
+/*-----------------------------------------------------------------------*/
+
+static JRESULT create_huffman_tbl ( /* 0:OK, !0:Failed */
+    JDEC *jd,                   /* Pointer to the decompressor object */
+    const uint8_t *data,        /* Pointer to the packed huffman tables */
+    size_t ndata                /* Size of input data */
+)
+{
+    unsigned int i, j, b, cls, num, reuse;
+    size_t np, na;
+    uint8_t d, *pb, *pd;
+    uint16_t hc, *ph;
+
+
+    while (ndata) { /* Process all tables in the segment */
+        if (ndata < 17) {
+            return JDR_FMT1;    /* Err: wrong data size */
+        }
+        ndata -= 17;
+        d = *data++;                        /* Get table number and class */
+        if (d & 0xEE) {
+            return JDR_FMT1;    /* Err: invalid class/number */
+        }
+        cls = d >> 4; num = d & 0x0F;       /* class = dc(0)/ac(1), table number = 0/1 */
+        reuse = HUFF_REUSE(jd, num, cls);   /* Tables of progressive JPEG are allocated once at the maximum size and redefined in place */
+        pb = reuse ? jd->huffbits[num][cls] : alloc_pool(jd, 16);   /* Allocate a memory block for the bit distribution table */
+        if (!pb) {
+            return JDR_MEM1;    /* Err: not enough memory */
+        }
+        jd->huffbits[num][cls] = pb;
+        for (np = i = 0; i < 16; i++) {     /* Load number of patterns for 1 to 16-bit code */
+            np += (pb[i] = *data++);        /* Get sum of code words for each code */
+        }
+        na = np;                            /* Number of code words to allocate */
+#if JD_PROGRESSIVE
+        if (jd->progressive) {
+            if (np > HUFF_MAXCODE) {
+                return JDR_FMT1;    /* Err: wrong number of code words */
+            }
+            na = HUFF_MAXCODE;
+        }
+#endif
+        ph = reuse ? jd->huffcode[num][cls] : alloc_pool(jd, na * sizeof (uint16_t));   /* Allocate a memory block for the code word table */
+        if (!ph) {
+            return JDR_MEM1;    /* Err: not enough memory */
+        }
+        jd->huffcode[num][cls] = ph;
+        hc = 0;
+        for (j = i = 0; i < 16; i++) {      /* Re-build huffman code word table */
+            b = pb[i];
+            while (b--) {
+                ph[j++] = hc++;
+            }
+            hc <<= 1;
+        }
+
+        if (ndata < np) {
+            return JDR_FMT1;    /* Err: wrong data size */
+        }
+        ndata -= np;
+        pd = reuse ? jd->huffdata[num][cls] : alloc_pool(jd, na);  /* Allocate a memory block for the decoded data */
+        if (!pd) {
+            return JDR_MEM1;    /* Err: not enough memory */
+        }
+        jd->huffdata[num][cls] = pd;
+        for (i = 0; i < np; i++) {          /* Load decoded data corresponds to each code word */
+            d = *data++;
+            if (!cls && d > 11) {
+                return JDR_FMT1;
+            }
+            pd[i] = d;
+        }
+#if JD_FASTDECODE == 2
+        if (create_huffman_lut(jd, cls, num)) { /* Create fast huffman decode table */
+            return JDR_MEM1;    /* Err: not enough memory */
+        }
+#endif
+#if JD_PROGRESSIVE
+        if (jd->progressive) {
+            jd->htmax |= 1 << (num * 2 + cls);  /* Next definition of this table is loaded into the same memory */
+        }
+#endif
+    }
+
+    return JDR_OK;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Extract a huffman decoded data from input stream                      */
+/*-----------------------------------------------------------------------*/
+
+static int huffext (    /* >=0: decoded data, <0: error code */
+    JDEC *jd,           /* Pointer to the decompressor object */
+    unsigned int id,    /* Table ID (0:Y, 1:C) */
+    unsigned int cls    /* Table class (0:DC, 1:AC) */
+)
+{
+    size_t dc = jd->dctr;
+    uint8_t *dp = jd->dptr;
+    unsigned int d, flg = 0;
+
+#if JD_FASTDECODE == 0
+    uint8_t bm, nd, bl;
+    const uint8_t *hb = jd->huffbits[id][cls];  /* Bit distribution table */
+    const uint16_t *hc = jd->huffcode[id][cls]; /* Code word table */
+    const uint8_t *hd = jd->huffdata[id][cls];  /* Data table */
+
+
+    bm = jd->dbit;  /* Bit mask to extract */
+    d = 0; bl = 16; /* Max code length */
+    do {
+        if (!bm) {      /* Next byte? */
+            if (!dc) {  /* No input data is available, re-fill input buffer */
+                dp = jd->inbuf; /* Top of input buffer */
+                dc = jd->infunc(jd, dp, JD_SZBUF); jd->rdofs += dc;
+                if (!dc) {
+                    return 0 - (int)JDR_INP;    /* Err: read error or wrong stream termination */
+                }
+            } else {
+                dp++;   /* Next data ptr */
+            }
+            dc--;       /* Decrement number of available bytes */
+            if (flg) {      /* In flag sequence? */
+                flg = 0;    /* Exit flag sequence */
+                if (*dp != 0) {
+                    return 0 - (int)JDR_FMT1;    /* Err: unexpected flag is detected (may be collapted data) */
+                }
+                *dp = 0xFF;             /* The flag is a data 0xFF */
+            } else {
+                if (*dp == 0xFF) {      /* Is start of flag sequence? */
+                    flg = 1; continue;  /* Enter flag sequence, get trailing byte */
+                }
+            }
+            bm = 0x80;      /* Read from MSB */
+        }
+        d <<= 1;            /* Get a bit */
+        if (*dp & bm) {
+            d++;
+        }
+        bm >>= 1;
+
+        for (nd = *hb++; nd; nd--) {    /* Search the code word in this bit length */
+            if (d == *hc++) {   /* Matched? */
+                jd->dbit = bm; jd->dctr = dc; jd->dptr = dp;
+                return *hd;     /* Return the decoded data */
+            }
+            hd++;
+        }
+        bl--;
+    } while (bl);
+
+#else
+    const uint8_t *hb, *hd;
+    const uint16_t *hc;
+    unsigned int nc, bl, wbit = jd->dbit % 32;
+    uint32_t w = jd->wreg & ((1UL << wbit) - 1);
+
+
+    while (wbit < 16) { /* Prepare 16 bits into the working register */
+        if (jd->marker) {
+            d = 0xFF;   /* Input stream has stalled for a marker. Generate stuff bits */
+        } else {
+            if (!dc) {  /* Buffer empty, re-fill input buffer */
+                dp = jd->inbuf;                     /* Top of input buffer */
+                dc = jd->infunc(jd, dp, JD_SZBUF); jd->rdofs += dc;
+                if (!dc) {
+                    return 0 - (int)JDR_INP;    /* Err: read error or wrong stream termination */
+                }
+            }
+            d = *dp++; dc--;
+            if (flg) {      /* In flag sequence? */
+                flg = 0;    /* Exit flag sequence */
+                if (d != 0) {
+                    jd->marker = d;    /* Not an escape of 0xFF but a marker */
+                }
+                d = 0xFF;
+            } else {
+                if (d == 0xFF) {        /* Is start of flag sequence? */
+                    flg = 1; continue;  /* Enter flag sequence, get trailing byte */
+                }
+            }
+        }
+        w = w << 8 | d; /* Shift 8 bits in the working register */
+        wbit += 8;
+    }
+    jd->dctr = dc; jd->dptr = dp;
+    jd->wreg = w;
+
+#if JD_FASTDECODE == 2
+    /* Table serch for the short codes */
+    d = (unsigned int)(w >> (wbit - HUFF_BIT)); /* Short code as table index */
+    if (cls) {  /* AC element */
+        d = jd->hufflut_ac[id][d];  /* Table decode */
+        if (d != 0xFFFF) {  /* It is done if hit in short code */
+            jd->dbit = wbit - (d >> 8); /* Snip the code length */
+            return d & 0xFF;    /* b7..0: zero run and following data bits */
+        }
+    } else {    /* DC element */
+        d = jd->hufflut_dc[id][d];  /* Table decode */
+        if (d != 0xFF) {    /* It is done if hit in short code */
+            jd->dbit = wbit - (d >> 4); /* Snip the code length  */
+            return d & 0xF; /* b3..0: following data bits */
+        }
+    }
+
+    /* Incremental serch for the codes longer than HUFF_BIT */
+    hb = jd->huffbits[id][cls] + HUFF_BIT;              /* Bit distribution table */
+    hc = jd->huffcode[id][cls] + jd->longofs[id][cls];  /* Code word table */
+    hd = jd->huffdata[id][cls] + jd->longofs[id][cls];  /* Data table */
+    bl = HUFF_BIT + 1;
+#else
+    /* Incremental serch for all codes */
+    hb = jd->huffbits[id][cls]; /* Bit distribution table */
+    hc = jd->huffcode[id][cls]; /* Code word table */
+    hd = jd->huffdata[id][cls]; /* Data table */
+    bl = 1;
+#endif
+    for ( ; bl <= 16; bl++) {   /* Incremental search */
+        nc = *hb++;
+        if (nc) {
+            d = w >> (wbit - bl);
+            do {    /* Search the code word in this bit length */
+                if (d == *hc++) {       /* Matched? */
+                    jd->dbit = wbit - bl;   /* Snip the huffman code */
+                    return *hd;         /* Return the decoded data */
+                }
+                hd++;
+            } while (--nc);
+        }
+    }
+#endif
+
+    return 0 - (int)JDR_FMT1;   /* Err: code not found (may be collapted data) */
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Extract N bits from input stream                                      */
+/*-----------------------------------------------------------------------*/
+
+static int bitext ( /* >=0: extracted data, <0: error code */
+    JDEC *jd,           /* Pointer to the decompressor object */
+    unsigned int nbit   /* Number of bits to extract (1 to 16) */
+)
+{
+    size_t dc = jd->dctr;
+    uint8_t *dp = jd->dptr;
+    unsigned int d, flg = 0;
+
+#if JD_FASTDECODE == 0
+    uint8_t mbit = jd->dbit;
+
+    d = 0;
+    do {
+        if (!mbit) {            /* Next byte? */
+            if (!dc) {          /* No input data is available, re-fill input buffer */
+                dp = jd->inbuf; /* Top of input buffer */
+                dc = jd->infunc(jd, dp, JD_SZBUF); jd->rdofs += dc;
+                if (!dc) {
+                    return 0 - (int)JDR_INP;    /* Err: read error or wrong stream termination */
+                }
+            } else {
+                dp++;           /* Next data ptr */
+            }
+            dc--;               /* Decrement number of available bytes */
+            if (flg) {          /* In flag sequence? */
+                flg = 0;        /* Exit flag sequence */
+                if (*dp != 0) {
+                    return 0 - (int)JDR_FMT1;    /* Err: unexpected flag is detected (may be collapted data) */
+                }
+                *dp = 0xFF;     /* The flag is a data 0xFF */
+            } else {
+                if (*dp == 0xFF) {      /* Is start of flag sequence? */
+                    flg = 1; continue;  /* Enter flag sequence */
+                }
+            }
+            mbit = 0x80;        /* Read from MSB */
+        }
+        d <<= 1;    /* Get a bit */
+        if (*dp & mbit) {
+            d |= 1;
+        }
+        mbit >>= 1;
+        nbit--;
+    } while (nbit);
+
+    jd->dbit = mbit; jd->dctr = dc; jd->dptr = dp;
+    return (int)d;
+
+#else
+    unsigned int wbit = jd->dbit % 32;
+    uint32_t w = jd->wreg & ((1UL << wbit) - 1);
+
+
+    while (wbit < nbit) {   /* Prepare nbit bits into the working register */
+        if (jd->marker) {
+            d = 0xFF;   /* Input stream stalled, generate stuff bits */
+        } else {
+            if (!dc) {  /* Buffer empty, re-fill input buffer */
+                dp = jd->inbuf; /* Top of input buffer */
+                dc = jd->infunc(jd, dp, JD_SZBUF); jd->rdofs += dc;
+                if (!dc) {
+                    return 0 - (int)JDR_INP;    /* Err: read error or wrong stream termination */
+                }
+            }
+            d = *dp++; dc--;
+            if (flg) {      /* In flag sequence? */
+                flg = 0;    /* Exit flag sequence */
+                if (d != 0) {
+                    jd->marker = d;    /* Not an escape of 0xFF but a marker */
+                }
+                d = 0xFF;
+            } else {
+                if (d == 0xFF) {        /* Is start of flag sequence? */
+                    flg = 1; continue;  /* Enter flag sequence, get trailing byte */
+                }
+            }
+        }
+        w = w << 8 | d; /* Get 8 bits into the working register */
+        wbit += 8;
+    }
+    jd->wreg = w; jd->dbit = wbit - nbit;
+    jd->dctr = dc; jd->dptr = dp;
+
+    return (int)(w >> ((wbit - nbit) % 32));
+#endif
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Process restart interval                                              */
+/*-----------------------------------------------------------------------*/
+
+static JRESULT restart (
+    JDEC *jd,       /* Pointer to the decompressor object */
+    uint16_t rstn   /* Expected restert sequense number */
+)
+{
+    unsigned int i;
+    uint8_t *dp = jd->dptr;
+    size_t dc = jd->dctr;
+
+#if JD_FASTDECODE == 0
+    uint16_t d = 0;
+
+    /* Get two bytes from the input stream */
+    i = 0;
+    while (i < 2) {
+        if (!dc) {  /* No input data is available, re-fill input buffer */
+            dp = jd->inbuf;
+            dc = jd->infunc(jd, dp, JD_SZBUF); jd->rdofs += dc;
+            if (!dc) {
+                return JDR_INP;
+            }
+        } else {
+            dp++;
+        }
+        dc--;
+        d = d << 8 | *dp;   /* Get a byte */
+        i = (d == 0xFF00) ? 0 : i + 1;  /* Skip a stuffed 0xFF byte padding the data (some camera encoders) */
+    }
+    jd->dptr = dp; jd->dctr = dc; jd->dbit = 0;
+
+    /* Check the marker */
+    if ((d & 0xFFD8) != 0xFFD0 || (d & 7) != (rstn & 7)) {
+        return JDR_FMT1;    /* Err: expected RSTn marker is not detected (may be collapted data) */
+    }
+
+#else
+    uint16_t marker;
+
+
+    if (jd->marker) {   /* Generate a maker if it has been detected */
+        marker = 0xFF00 | jd->marker;
+        jd->marker = 0;
+    } else {
+        marker = 0;
+        for (i = 0; i < 2; i++) {   /* Get a restart marker */
+            if (!dc) {      /* No input data is available, re-fill input buffer */
+                dp = jd->inbuf;
+                dc = jd->infunc(jd, dp, JD_SZBUF); jd->rdofs += dc;
+                if (!dc) {
+                    return JDR_INP;
+                }
+            }
+            marker = (marker << 8) | *dp++; /* Get a byte */
+            dc--;
+        }
+        jd->dptr = dp; jd->dctr = dc;
+    }
+
+    /* Check the marker */
+    if ((marker & 0xFFD8) != 0xFFD0 || (marker & 7) != (rstn & 7)) {
+        return JDR_FMT1;    /* Err: expected RSTn marker was not detected (may be collapted data) */
+    }
+
+    jd->dbit = 0;           /* Discard stuff bits */
+#endif
+
+    jd->dcv[2] = jd->dcv[1] = jd->dcv[0] = 0;   /* Reset DC offset */
+#if JD_PROGRESSIVE
+    jd->eobrun = 0;                             /* Reset EOB run */
+#endif
+    return JDR_OK;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Apply Inverse-DCT in Arai Algorithm (see also aa_idct.png)            */
+/*-----------------------------------------------------------------------*/
+
+/* Descale a transformed value 8 bits and store it to the output block */
+#if JD_FASTDECODE >= 1
+#define IDCT_PUT(d, v)  (d) = (int16_t)((v) >> 8)
+#else
+#define IDCT_PUT(d, v)  (d) = BYTECLIP((v) >> 8)
+#endif
+
+static void block_idct (
+    int32_t *src,   /* Input block data (de-quantized and pre-scaled for Arai Algorithm) */
+    jd_yuv_t *dst   /* Pointer to the destination to store the block as byte array */
+)
+{
+    const int32_t M13 = (int32_t)(1.41421 * 4096), M2 = (int32_t)(1.08239 * 4096), M4 = (int32_t)(2.61313 * 4096), M5 = (int32_t)(1.84776 * 4096);
+    int32_t v0, v1, v2, v3, v4, v5, v6, v7;
+    int32_t t10, t11, t12, t13;
+    int i;
+
+    /* Process columns */
+    for (i = 0; i < 8; i++) {
+        if (!(src[8 * 1] | src[8 * 2] | src[8 * 3] | src[8 * 4] | src[8 * 5] | src[8 * 6] | src[8 * 7])) {
+            v0 = src[8 * 0];    /* Only DC element in this column: all outputs are the same */
+            src[8 * 1] = src[8 * 2] = src[8 * 3] = src[8 * 4] = src[8 * 5] = src[8 * 6] = src[8 * 7] = v0;
+            src++;
+            continue;
+        }
+        v0 = src[8 * 0];    /* Get even elements */
+        v1 = src[8 * 2];
+        v2 = src[8 * 4];
+        v3 = src[8 * 6];
+
+        t10 = v0 + v2;      /* Process the even elements */
+        t12 = v0 - v2;
+        t11 = (v1 - v3) * M13 >> 12;
+        v3 += v1;
+        t11 -= v3;
+        v0 = t10 + v3;
+        v3 = t10 - v3;
+        v1 = t11 + t12;
+        v2 = t12 - t11;
+
+        v4 = src[8 * 7];    /* Get odd elements */
+        v5 = src[8 * 1];
+        v6 = src[8 * 5];
+        v7 = src[8 * 3];
+
+        t10 = v5 - v4;      /* Process the odd elements */
+        t11 = v5 + v4;
+        t12 = v6 - v7;
+        v7 += v6;
+        v5 = (t11 - v7) * M13 >> 12;
+        v7 += t11;
+        t13 = (t10 + t12) * M5 >> 12;
+        v4 = t13 - (t10 * M2 >> 12);
+        v6 = t13 - (t12 * M4 >> 12) - v7;
+        v5 -= v6;
+        v4 -= v5;
+
+        src[8 * 0] = v0 + v7;   /* Write-back transformed values */
+        src[8 * 7] = v0 - v7;
+        src[8 * 1] = v1 + v6;
+        src[8 * 6] = v1 - v6;
+        src[8 * 2] = v2 + v5;
+        src[8 * 5] = v2 - v5;
+        src[8 * 3] = v3 + v4;
+        src[8 * 4] = v3 - v4;
+
+        src++;  /* Next column */
+    }
+
+    /* Process rows */
+    src -= 8;
+    for (i = 0; i < 8; i++) {
+        v0 = src[0] + (128L << 8);  /* Get even elements (remove DC offset (-128) here) */
+        if (!(src[1] | src[2] | src[3] | src[4] | src[5] | src[6] | src[7])) {
+            IDCT_PUT(dst[0], v0);   /* Only DC element in this row: all outputs are the same */
+            dst[7] = dst[6] = dst[5] = dst[4] = dst[3] = dst[2] = dst[1] = dst[0];
+            dst += 8; src += 8;
+            continue;
+        }
+        v1 = src[2];
+        v2 = src[4];
+        v3 = src[6];
+
+        t10 = v0 + v2;              /* Process the even elements */
+        t12 = v0 - v2;
+        t11 = (v1 - v3) * M13 >> 12;
+        v3 += v1;
+        t11 -= v3;
+        v0 = t10 + v3;
+        v3 = t10 - v3;
+        v1 = t11 + t12;
+        v2 = t12 - t11;
+
+        v4 = src[7];                /* Get odd elements */
+        v5 = src[1];
+        v6 = src[5];
+        v7 = src[3];
+
+        t10 = v5 - v4;              /* Process the odd elements */
+        t11 = v5 + v4;
+        t12 = v6 - v7;
+        v7 += v6;
+        v5 = (t11 - v7) * M13 >> 12;
+        v7 += t11;
+        t13 = (t10 + t12) * M5 >> 12;
+        v4 = t13 - (t10 * M2 >> 12);
+        v6 = t13 - (t12 * M4 >> 12) - v7;
+        v5 -= v6;
+        v4 -= v5;
+
+        /* Descale the transformed values 8 bits and output a row */
+        IDCT_PUT(dst[0], v0 + v7);
+        IDCT_PUT(dst[7], v0 - v7);
+        IDCT_PUT(dst[1], v1 + v6);
+        IDCT_PUT(dst[6], v1 - v6);
+        IDCT_PUT(dst[2], v2 + v5);
+        IDCT_PUT(dst[5], v2 - v5);
+        IDCT_PUT(dst[3], v3 + v4);
+        IDCT_PUT(dst[4], v3 - v4);
+
+        dst += 8; src += 8; /* Next row */
+    }
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Apply Inverse-DCT to a block with non-zero elements only in top-left 4x4 */
+/*-----------------------------------------------------------------------*/
+
+static void block_idct_4x4 (
+    int32_t *src,   /* Input block data (elements out of the top-left 4x4 must be zero) */
+    jd_yuv_t *dst   /* Pointer to the destination to store the block as byte array */
+)
+{
+    const int32_t M13 = (int32_t)(1.41421 * 4096), M2 = (int32_t)(1.08239 * 4096), M4 = (int32_t)(2.61313 * 4096), M5 = (int32_t)(1.84776 * 4096);
+    int32_t v0, v1, v2, v3, v4, v5, v6, v7;
+    int32_t t10, t11, t12, t13;
+    int i;
+
+    /* Process columns (right four columns are all zero and remain zero) */
+    for (i = 0; i < 4; i++) {
+        v0 = src[8 * 0];
+        if (!(src[8 * 1] | src[8 * 2] | src[8 * 3])) {    /* Only DC element in this column */
+            src[8 * 1] = src[8 * 2] = src[8 * 3] = src[8 * 4] = src[8 * 5] = src[8 * 6] = src[8 * 7] = v0;
+            src++;
+            continue;
+        }
+        t10 = v0;           /* Process the even elements (elements 4 and 6 are zero) */
+        v1 = src[8 * 2];
+        t11 = (v1 * M13 >> 12) - v1;
+        v0 = t10 + v1;
+        v3 = t10 - v1;
+        v1 = t11 + t10;
+        v2 = t10 - t11;
+
+        v5 = src[8 * 1];    /* Process the odd elements (elements 5 and 7 are zero) */
+        v7 = src[8 * 3];
+        t12 = -v7;
+        t13 = (v5 + t12) * M5 >> 12;
+        t10 = (v5 - v7) * M13 >> 12;
+        v7 += v5;
+        v4 = t13 - (v5 * M2 >> 12);
+        v6 = t13 - (t12 * M4 >> 12) - v7;
+        v5 = t10 - v6;
+        v4 -= v5;
+
+        src[8 * 0] = v0 + v7;   /* Write-back transformed values */
+        src[8 * 7] = v0 - v7;
+        src[8 * 1] = v1 + v6;
+        src[8 * 6] = v1 - v6;
+        src[8 * 2] = v2 + v5;
+        src[8 * 5] = v2 - v5;
+        src[8 * 3] = v3 + v4;
+        src[8 * 4] = v3 - v4;
+
+        src++;  /* Next column */
+    }
+
+    /* Process rows (only left four elements of each row can be non-zero) */
+    src -= 4;
+    for (i = 0; i < 8; i++) {
+        v0 = src[0] + (128L << 8);  /* Remove DC offset (-128) here */
+        if (!(src[1] | src[2] | src[3])) {  /* Only DC element in this row */
+            IDCT_PUT(dst[0], v0);
+            dst[7] = dst[6] = dst[5] = dst[4] = dst[3] = dst[2] = dst[1] = dst[0];
+            dst += 8; src += 8;
+            continue;
+        }
+        t10 = v0;                   /* Process the even elements */
+        v1 = src[2];
+        t11 = (v1 * M13 >> 12) - v1;
+        v0 = t10 + v1;
+        v3 = t10 - v1;
+        v1 = t11 + t10;
+        v2 = t10 - t11;
+
+        v5 = src[1];                /* Process the odd elements */
+        v7 = src[3];
+        t12 = -v7;
+        t13 = (v5 + t12) * M5 >> 12;
+        t10 = (v5 - v7) * M13 >> 12;
+        v7 += v5;
+        v4 = t13 - (v5 * M2 >> 12);
+        v6 = t13 - (t12 * M4 >> 12) - v7;
+        v5 = t10 - v6;
+        v4 -= v5;
+
+        IDCT_PUT(dst[0], v0 + v7);  /* Descale the transformed values 8 bits and output a row */
+        IDCT_PUT(dst[7], v0 - v7);
+        IDCT_PUT(dst[1], v1 + v6);
+        IDCT_PUT(dst[6], v1 - v6);
+        IDCT_PUT(dst[2], v2 + v5);
+        IDCT_PUT(dst[5], v2 - v5);
+        IDCT_PUT(dst[3], v3 + v4);
+        IDCT_PUT(dst[4], v3 - v4);
+
+        dst += 8; src += 8; /* Next row */
+    }
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Apply Inverse-DCT to a block with non-zero elements only in top-left 2x2 */
+/*-----------------------------------------------------------------------*/
+
+static void block_idct_2x2 (
+    int32_t *src,   /* Input block data (elements out of the top-left 2x2 must be zero) */
+    jd_yuv_t *dst   /* Pointer to the destination to store the block as byte array */
+)
+{
+    const int32_t M13 = (int32_t)(1.41421 * 4096), M2 = (int32_t)(1.08239 * 4096), M5 = (int32_t)(1.84776 * 4096);
+    int32_t v0, v1, v4, v5, v6, t13;
+    int i;
+
+    /* Process columns (right six columns are all zero and remain zero) */
+    for (i = 0; i < 2; i++) {
+        v0 = src[8 * 0];    /* All even elements are the DC element */
+        v1 = src[8 * 1];    /* The only odd element */
+        if (!v1) {          /* Only DC element in this column */
+            src[8 * 1] = src[8 * 2] = src[8 * 3] = src[8 * 4] = src[8 * 5] = src[8 * 6] = src[8 * 7] = v0;
+            src++;
+            continue;
+        }
+        t13 = v1 * M5 >> 12;
+        v6 = t13 - v1;
+        v5 = (v1 * M13 >> 12) - v6;
+        v4 = t13 - (v1 * M2 >> 12) - v5;
+
+        src[8 * 0] = v0 + v1;   /* Write-back transformed values */
+        src[8 * 7] = v0 - v1;
+        src[8 * 1] = v0 + v6;
+        src[8 * 6] = v0 - v6;
+        src[8 * 2] = v0 + v5;
+        src[8 * 5] = v0 - v5;
+        src[8 * 3] = v0 + v4;
+        src[8 * 4] = v0 - v4;
+
+        src++;  /* Next column */
+    }
+
+    /* Process rows (only left two elements of each row can be non-zero) */
+    src -= 2;
+    for (i = 0; i < 8; i++) {
+        v0 = src[0] + (128L << 8);  /* Remove DC offset (-128) here */
+        v1 = src[1];
+        if (!v1) {                  /* Only DC element in this row */
+            IDCT_PUT(dst[0], v0);
+            dst[7] = dst[6] = dst[5] = dst[4] = dst[3] = dst[2] = dst[1] = dst[0];
+            dst += 8; src += 8;
+            continue;
+        }
+        t13 = v1 * M5 >> 12;
+        v6 = t13 - v1;
+        v5 = (v1 * M13 >> 12) - v6;
+        v4 = t13 - (v1 * M2 >> 12) - v5;
+
+        IDCT_PUT(dst[0], v0 + v1);  /* Descale the transformed values 8 bits and output a row */
+        IDCT_PUT(dst[7], v0 - v1);
+        IDCT_PUT(dst[1], v0 + v6);
+        IDCT_PUT(dst[6], v0 - v6);
+        IDCT_PUT(dst[2], v0 + v5);
+        IDCT_PUT(dst[5], v0 - v5);
+        IDCT_PUT(dst[3], v0 + v4);
+        IDCT_PUT(dst[4], v0 - v4);
+
+        dst += 8; src += 8; /* Next row */
+    }
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Apply IDCT to a de-quantized block and store it into the MCU buffer   */
+/*-----------------------------------------------------------------------*/
+
+static void block_put (
+    JDEC *jd,           /* Pointer to the decompressor object */
+    int32_t *tmp,       /* De-quantized block in raster-order (destroyed) */
+    jd_yuv_t *bp,       /* Pointer to the block in the MCU buffer */
+    unsigned int z      /* Number of elements up to the last non-zero one in zigzag-order (1:DC only) */
+)
+{
+    int d;
+    unsigned int i;
+
+
+    if (z == 1 || (JD_USE_SCALE && jd->scale == 3)) {   /* If no AC element or scale ratio is 1/8, IDCT can be ommited and the block is filled with DC value */
+        if (z == 1) {
+            PROF_INC(jd, dc_blocks);
+        }
+        d = (jd_yuv_t)((*tmp / 256) + 128);
+        if (JD_FASTDECODE >= 1) {
+            for (i = 0; i < 64; bp[i++] = d) ;
+        } else {
+            memset(bp, d, 64);
+        }
+    } else if (z <= 3) {        /* Non-zero elements only in zigzag 0..2 (top-left 2x2)? */
+        block_idct_2x2(tmp, bp);
+    } else if (z <= 10) {       /* Non-zero elements only in zigzag 0..9 (top-left 4x4)? */
+        block_idct_4x4(tmp, bp);
+    } else {
+        block_idct(tmp, bp);    /* Apply IDCT and store the block to the MCU buffer */
+    }
+    PROF_ADD(jd, idct);
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Load all blocks in an MCU into working buffer                         */
+/*-----------------------------------------------------------------------*/
+
+static JRESULT mcu_load (
+    JDEC *jd        /* Pointer to the decompressor object */
+)
+{
+    int32_t *tmp = (int32_t *)jd->workbuf;  /* Block working buffer for de-quantize and IDCT */
+    int d, e;
+    unsigned int blk, nby, i, bc, z, id, cmp;
+    jd_yuv_t *bp;
+    const int32_t *dqf;
+
+
+    nby = jd->msx * jd->msy;    /* Number of Y blocks (1, 2 or 4) */
+    bp = jd->mcubuf;            /* Pointer to the first block of MCU */
+
+    for (blk = 0; blk < nby + 2; blk++) {   /* Get nby Y blocks and two C blocks */
+        cmp = (blk < nby) ? 0 : blk - nby + 1;  /* Component number 0:Y, 1:Cb, 2:Cr */
+
+        if (cmp && jd->ncomp != 3) {        /* Clear C blocks if not exist (monochrome image) */
+            for (i = 0; i < 64; bp[i++] = 128) ;
+
+        } else {                            /* Load Y/C blocks from input stream */
+            id = cmp ? 1 : 0;                       /* Huffman table ID of this component */
+
+            /* Extract a DC element from input stream */
+            d = huffext(jd, id, 0);                 /* Extract a huffman coded data (bit length) */
+            if (d < 0) {
+                return (JRESULT)(0 - d);    /* Err: invalid code or input */
+            }
+            bc = (unsigned int)d;
+            d = jd->dcv[cmp];                       /* DC value of previous block */
+            if (bc) {                               /* If there is any difference from previous block */
+                e = bitext(jd, bc);                 /* Extract data bits */
+                if (e < 0) {
+                    return (JRESULT)(0 - e);    /* Err: input */
+                }
+                bc = 1 << (bc - 1);                 /* MSB position */
+                if (!(e & bc)) {
+                    e -= (bc << 1) - 1;    /* Restore negative value if needed */
+                }
+                d += e;                             /* Get current value */
+                jd->dcv[cmp] = (int16_t)d;          /* Save current DC value for next block */
+            }
+            dqf = jd->qttbl[jd->qtid[cmp]];         /* De-quantizer table ID for this component */
+            tmp[0] = d * dqf[0] >> 8;               /* De-quantize, apply scale factor of Arai algorithm and descale 8 bits */
+
+            /* Extract following 63 AC elements from input stream */
+            memset(&tmp[1], 0, 63 * sizeof (int32_t));  /* Initialize all AC elements */
+            z = 1;      /* Top of the AC elements (in zigzag-order) */
+            do {
+                d = huffext(jd, id, 1);             /* Extract a huffman coded value (zero runs and bit length) */
+                if (d == 0) {
+                    break;    /* EOB? */
+                }
+                if (d < 0) {
+                    return (JRESULT)(0 - d);    /* Err: invalid code or input error */
+                }
+                bc = (unsigned int)d;
+                z += bc >> 4;                       /* Skip leading zero run */
+                if (z >= 64) {
+                    return JDR_FMT1;    /* Too long zero run */
+                }
+                if (bc &= 0x0F) {                   /* Bit length? */
+                    d = bitext(jd, bc);             /* Extract data bits */
+                    if (d < 0) {
+                        return (JRESULT)(0 - d);    /* Err: input device */
+                    }
+                    bc = 1 << (bc - 1);             /* MSB position */
+                    if (!(d & bc)) {
+                        d -= (bc << 1) - 1;    /* Restore negative value if needed */
+                    }
+                    i = Zig[z];                     /* Get raster-order index */
+                    tmp[i] = d * dqf[i] >> 8;       /* De-quantize, apply scale factor of Arai algorithm and descale 8 bits */
+                }
+            } while (++z < 64);     /* Next AC element */
+            PROF_ADD(jd, entropy);
+            PROF_INC(jd, blocks);
+
+            if (JD_FORMAT != 2 || !cmp) {   /* C components may not be processed if in grayscale output */
+                block_put(jd, tmp, bp, z);
+            }
+        }
+
+        bp += 64;               /* Next block */
+    }
+
+    return JDR_OK;  /* All blocks have been loaded successfully */
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Extract only DC values of the Y blocks in an MCU (no IDCT, no output) */
+/*-----------------------------------------------------------------------*/
+
+static JRESULT mcu_scan_dc (
+    JDEC *jd,       /* Pointer to the decompressor object */
+    uint8_t *ydc    /* Pointer to store mean level of each Y block (msx * msy bytes) */
+)
+{
+    int d, e;
+    unsigned int blk, nby, bc, z, id, cmp;
+
+
+    nby = jd->msx * jd->msy;    /* Number of Y blocks (1, 2 or 4) */
+
+    for (blk = 0; blk < nby + 2; blk++) {   /* Get nby Y blocks and two C blocks */
+        cmp = (blk < nby) ? 0 : blk - nby + 1;  /* Component number 0:Y, 1:Cb, 2:Cr */
+        if (cmp && jd->ncomp != 3) {        /* No C blocks in the stream (monochrome image) */
+            continue;
+        }
+        id = cmp ? 1 : 0;                   /* Huffman table ID of this component */
+
+        /* Extract a DC element from input stream */
+        d = huffext(jd, id, 0);             /* Extract a huffman coded data (bit length) */
+        if (d < 0) {
+            return (JRESULT)(0 - d);    /* Err: invalid code or input */
+        }
+        bc = (unsigned int)d;
+        d = jd->dcv[cmp];                   /* DC value of previous block */
+        if (bc) {                           /* If there is any difference from previous block */
+            e = bitext(jd, bc);             /* Extract data bits */
+            if (e < 0) {
+                return (JRESULT)(0 - e);    /* Err: input */
+            }
+            bc = 1 << (bc - 1);             /* MSB position */
+            if (!(e & bc)) {
+                e -= (bc << 1) - 1;    /* Restore negative value if needed */
+            }
+            d += e;                         /* Get current value */
+            jd->dcv[cmp] = (int16_t)d;      /* Save current DC value for next block */
+        }
+        if (!cmp) {     /* Y block: store the block level the same way as a DC-only block is filled in mcu_load() */
+            d = ((d * jd->qttbl[jd->qtid[0]][0] >> 8) / 256) + 128;
+            ydc[blk] = (uint8_t)(d < 0 ? 0 : (d > 255 ? 255 : d));
+        }
+
+        /* Skip following 63 AC elements in the input stream */
+        z = 1;      /* Top of the AC elements (in zigzag-order) */
+        do {
+            d = huffext(jd, id, 1);         /* Extract a huffman coded value (zero runs and bit length) */
+            if (d == 0) {
+                break;    /* EOB? */
+            }
+            if (d < 0) {
+                return (JRESULT)(0 - d);    /* Err: invalid code or input error */
+            }
+            bc = (unsigned int)d;
+            z += bc >> 4;                   /* Skip leading zero run */
+            if (z >= 64) {
+                return JDR_FMT1;    /* Too long zero run */
+            }
+            if (bc &= 0x0F) {               /* Bit length? */
+                d = bitext(jd, bc);         /* Discard data bits */
+                if (d < 0) {
+                    return (JRESULT)(0 - d);    /* Err: input device */
+                }
+            }
+        } while (++z < 64);     /* Next AC element */
+    }
+
+    return JDR_OK;
+}
+
+
+
+
+#if JD_FORMAT == 1
+/*-----------------------------------------------------------------------*/
+/* Build an RGB565 rectangular from Y/C components in a single pass      */
+/*-----------------------------------------------------------------------*/
+
+static void mcu_rgb565 (
+    JDEC *jd,           /* Pointer to the decompressor object */
+    unsigned int rx,    /* Width of the output rectangular (clipped at right end of image) */
+    unsigned int ry     /* Height of the output rectangular (clipped at bottom end of image) */
+)
+{
+    unsigned int cx, cy, ix, iy, sx, sy, px, py;
+    int yy, r, g, b, cb, cr;
+    const jd_yuv_t *pc, *pyb;
+    uint16_t *pix = (uint16_t *)jd->workbuf;
+
+
+    sx = jd->msx; sy = jd->msy;     /* Pixels per chroma sample (1 or 2) */
+    pc = jd->mcubuf + sx * sy * 64; /* Cb block follows the Y blocks, Cr block follows the Cb block */
+
+    for (cy = 0; cy * sy < ry; cy++) {
+        for (cx = 0; cx * sx < rx; cx++) {
+            cb = pc[cy * 8 + cx];       /* Get Cb/Cr component (shared by sx * sy pixels) */
+            cr = pc[cy * 8 + cx + 64];
+            if ((unsigned int)cb < 256 && (unsigned int)cr < 256) {
+                r = CvCrR[cr];          /* Chroma contributions, once per chroma sample */
+                g = (CvCbG[cb] + CvCrG[cr]) / CV_ACC;
+                b = CvCbB[cb];
+            } else {                    /* Not clipped yet (JD_FASTDECODE >= 1): same arithmetic as the tables */
+                r = (int)(1.402 * CV_ACC) * (cr - 128) / CV_ACC;
+                g = ((int)(0.344 * CV_ACC) * (cb - 128) + (int)(0.714 * CV_ACC) * (cr - 128)) / CV_ACC;
+                b = (int)(1.772 * CV_ACC) * (cb - 128) / CV_ACC;
+            }
+            for (iy = 0; iy < sy; iy++) {
+                py = cy * sy + iy;      /* Pixel location in the MCU */
+                if (py >= ry) {
+                    break;
+                }
+                for (ix = 0; ix < sx; ix++) {
+                    px = cx * sx + ix;
+                    if (px >= rx) {
+                        break;
+                    }
+                    pyb = jd->mcubuf + ((py >> 3) * sx + (px >> 3)) * 64;   /* Y block of the pixel */
+                    yy = pyb[(py & 7) * 8 + (px & 7)];
+                    pix[py * rx + px] = (uint16_t)(((BYTECLIP(yy + r) & 0xF8) << 8) | ((BYTECLIP(yy - g) & 0xFC) << 3) | (BYTECLIP(yy + b) >> 3));
+                }
+            }
+        }
+    }
+}
+#endif
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Output an MCU: Convert YCrCb to RGB and output it in RGB form         */
+/*-----------------------------------------------------------------------*/
+
+static JRESULT mcu_output (
+    JDEC *jd,           /* Pointer to the decompressor object */
+    int (*outfunc)(JDEC *, void *, JRECT *), /* RGB output function */
+    unsigned int x,     /* MCU location in the image */
+    unsigned int y      /* MCU location in the image */
+)
+{
+    const int CVACC = (sizeof (int) > 2) ? 1024 : 128;  /* Adaptive accuracy for both 16-/32-bit systems */
+    unsigned int ix, iy, mx, my, rx, ry;
+    int yy, cb, cr, rc;
+    jd_yuv_t *py, *pc;
+    uint8_t *pix;
+    JRECT rect;
+
+
+    mx = jd->msx * 8; my = jd->msy * 8;                 /* MCU size (pixel) */
+    rx = (x + mx <= jd->width) ? mx : jd->width - x;    /* Output rectangular size (it may be clipped at right/bottom end of image) */
+    ry = (y + my <= jd->height) ? my : jd->height - y;
+    if (JD_USE_SCALE) {
+        rx >>= jd->scale; ry >>= jd->scale;
+        if (!rx || !ry) {
+            return JDR_OK;    /* Skip this MCU if all pixel is to be rounded off */
+        }
+        x >>= jd->scale; y >>= jd->scale;
+    }
+    rect.left = x; rect.right = x + rx - 1;             /* Rectangular area in the frame buffer */
+    rect.top = y; rect.bottom = y + ry - 1;
+
+#if JD_FORMAT == 1
+    if (!JD_USE_SCALE || !jd->scale) {  /* RGB565 output without descaling: convert and pack in a single pass */
+        mcu_rgb565(jd, rx, ry);
+        jd->ostride = rx;
+        PROF_ADD(jd, color);
+        rc = outfunc(jd, jd->workbuf, &rect);
+        PROF_ADD(jd, output);
+        return rc ? JDR_OK : JDR_INTR;
+    }
+#endif
+
+    if (!JD_USE_SCALE || jd->scale != 3) {  /* Not for 1/8 scaling */
+        pix = (uint8_t *)jd->workbuf;
+
+        if (JD_FORMAT != 2) {   /* RGB output (build an RGB MCU from Y/C component) */
+            for (iy = 0; iy < my; iy++) {
+                pc = py = jd->mcubuf;
+                if (my == 16) {     /* Double block height? */
+                    pc += 64 * 4 + (iy >> 1) * 8;
+                    if (iy >= 8) {
+                        py += 64;
+                    }
+                } else {            /* Single block height */
+                    pc += mx * 8 + iy * 8;
+                }
+                py += iy * 8;
+                for (ix = 0; ix < mx; ix++) {
+                    cb = pc[0] - 128;   /* Get Cb/Cr component and remove offset */
+                    cr = pc[64] - 128;
+                    if (mx == 16) {                 /* Double block width? */
+                        if (ix == 8) {
+                            py += 64 - 8;    /* Jump to next block if double block heigt */
+                        }
+                        /* Step forward chroma pointer every two pixels */
+                        if (ix % 2) {
+                            pc++;
+                        }
+                    } else {                        /* Single block width */
+                        pc++;                       /* Step forward chroma pointer every pixel */
+                    }
+                    yy = *py++;         /* Get Y component */
+                    *pix++ = /*R*/ BYTECLIP(yy + ((int)(1.402 * CVACC) * cr) / CVACC);
+                    *pix++ = /*G*/ BYTECLIP(yy - ((int)(0.344 * CVACC) * cb + (int)(0.714 * CVACC) * cr) / CVACC);
+                    *pix++ = /*B*/ BYTECLIP(yy + ((int)(1.772 * CVACC) * cb) / CVACC);
+                }
+            }
+        } else {    /* Monochrome output (build a grayscale MCU from Y comopnent) */
+            for (iy = 0; iy < my; iy++) {
+                py = jd->mcubuf + iy * 8;
+                if (my == 16) {     /* Double block height? */
+                    if (iy >= 8) {
+                        py += 64;
+                    }
+                }
+                for (ix = 0; ix < mx; ix++) {
+                    if (mx == 16) {                 /* Double block width? */
+                        if (ix == 8) {
+                            py += 64 - 8;    /* Jump to next block if double block height */
+                        }
+                    }
+                    *pix++ = (uint8_t) * py++;          /* Get and store a Y value as grayscale */
+                }
+            }
+        }
+
+        PROF_ADD(jd, color);
+
+        /* Descale the MCU rectangular if needed */
+        if (JD_USE_SCALE && jd->scale) {
+            unsigned int x, y, r, g, b, s, w, a;
+            uint8_t *op;
+
+            /* Get averaged RGB value of each square correcponds to a pixel */
+            s = jd->scale * 2;  /* Number of shifts for averaging */
+            w = 1 << jd->scale; /* Width of square */
+            a = (mx - w) * (JD_FORMAT != 2 ? 3 : 1);    /* Bytes to skip for next line in the square */
+            op = (uint8_t *)jd->workbuf;
+            for (iy = 0; iy < my; iy += w) {
+                for (ix = 0; ix < mx; ix += w) {
+                    pix = (uint8_t *)jd->workbuf + (iy * mx + ix) * (JD_FORMAT != 2 ? 3 : 1);
+                    r = g = b = 0;
+                    for (y = 0; y < w; y++) {   /* Accumulate RGB value in the square */
+                        for (x = 0; x < w; x++) {
+                            r += *pix++;    /* Accumulate R or Y (monochrome output) */
+                            if (JD_FORMAT != 2) {   /* RGB output? */
+                                g += *pix++;    /* Accumulate G */
+                                b += *pix++;    /* Accumulate B */
+                            }
+                        }
+                        pix += a;
+                    }                           /* Put the averaged pixel value */
+                    *op++ = (uint8_t)(r >> s);  /* Put R or Y (monochrome output) */
+                    if (JD_FORMAT != 2) {   /* RGB output? */
+                        *op++ = (uint8_t)(g >> s);  /* Put G */
+                        *op++ = (uint8_t)(b >> s);  /* Put B */
+                    }
+                }
+            }
+            PROF_ADD(jd, scale);
+        }
+
+    } else {    /* For only 1/8 scaling (left-top pixel in each block are the DC value of the block) */
+
+        /* Build a 1/8 descaled RGB MCU from discrete comopnents */
+        pix = (uint8_t *)jd->workbuf;
+        pc = jd->mcubuf + mx * my;
+        cb = pc[0] - 128;       /* Get Cb/Cr component and restore right level */
+        cr = pc[64] - 128;
+        for (iy = 0; iy < my; iy += 8) {
+            py = jd->mcubuf;
+            if (iy == 8) {
+                py += 64 * 2;
+            }
+            for (ix = 0; ix < mx; ix += 8) {
+                yy = *py;   /* Get Y component */
+                py += 64;
+                if (JD_FORMAT != 2) {
+                    *pix++ = /*R*/ BYTECLIP(yy + ((int)(1.402 * CVACC) * cr / CVACC));
+                    *pix++ = /*G*/ BYTECLIP(yy - ((int)(0.344 * CVACC) * cb + (int)(0.714 * CVACC) * cr) / CVACC);
+                    *pix++ = /*B*/ BYTECLIP(yy + ((int)(1.772 * CVACC) * cb / CVACC));
+                } else {
+                    *pix++ = yy;
+                }
+            }
+        }
+    }
+
+    /* The MCU may span right edge: truncated pixels are left in the lines and skipped by the output function */
+    mx >>= jd->scale;
+    jd->ostride = mx;
+
+    /* Convert RGB888 to RGB565 if needed */
+    if (JD_FORMAT == 1) {
+        uint8_t *s = (uint8_t *)jd->workbuf;
+        uint16_t w, *d = (uint16_t *)s;
+        unsigned int n = mx * ry;
+
+        do {
+            w = (*s++ & 0xF8) << 8;     /* RRRRR----------- */
+            w |= (*s++ & 0xFC) << 3;    /* -----GGGGGG----- */
+            w |= *s++ >> 3;             /* -----------BBBBB */
+            *d++ = w;
+        } while (--n);
+    }
+    PROF_ADD(jd, color);    /* 1/8 scaling and RGB565 packing */
+
+    /* Output the rectangular */
+    rc = outfunc(jd, jd->workbuf, &rect);
+    PROF_ADD(jd, output);
+    return rc ? JDR_OK : JDR_INTR;
+}
+
+
+
+
+#if JD_PROGRESSIVE
+/*-----------------------------------------------------------------------*/
+/* Get the coefficient block of a component in the progressive JPEG      */
+/*-----------------------------------------------------------------------*/
+
+/* The coefficient buffer holds the Y plane ((mcux * msx) x (mcuy * msy) blocks)
+   followed by the Cb and Cr planes (mcux x mcuy blocks each), 64 elements
+   in zigzag-order per block. */
+
+static int16_t *coef_block (   /* Pointer to the 64 coefficients of the block */
+    JDEC *jd,           /* Pointer to the decompressor object */
+    unsigned int cmp,   /* Component number 0:Y, 1:Cb, 2:Cr */
+    unsigned int bx,    /* Block location in the component */
+    unsigned int by
+)
+{
+    size_t mw, mh, n;
+
+
+    mw = (jd->width + jd->msx * 8 - 1) / (jd->msx * 8);     /* Number of MCU columns */
+    mh = (jd->height + jd->msy * 8 - 1) / (jd->msy * 8);    /* Number of MCU rows */
+    if (!cmp) {
+        n = by * mw * jd->msx + bx;
+    } else {
+        n = mw * mh * jd->msx * jd->msy + (cmp - 1) * mw * mh + by * mw + bx;
+    }
+    return jd->coef + n * 64;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Check a SOS segment of the progressive JPEG and set up the scan       */
+/*-----------------------------------------------------------------------*/
+
+static JRESULT setup_scan (
+    JDEC *jd,               /* Pointer to the decompressor object */
+    const uint8_t *seg,     /* Pointer to the SOS segment content */
+    size_t len              /* Size of the segment content */
+)
+{
+    unsigned int i, j, n, b;
+
+
+    n = seg[0];                                 /* Number of components in the scan */
+    if (!n || n > jd->ncomp || len < 4 + 2 * n) {
+        return JDR_FMT1;
+    }
+    jd->scomp = 0;
+    for (i = j = 0; i < n; i++, j++) {
+        while (j < jd->ncomp && jd->cid[j] != seg[1 + 2 * i]) {
+            j++;    /* Components in the scan are in the same order as in the frame */
+        }
+        if (j == jd->ncomp) {
+            return JDR_FMT1;    /* Err: Unknown component */
+        }
+        b = seg[2 + 2 * i];                     /* Huffman table IDs of the component */
+        if (b & 0xEE) {
+            return JDR_FMT3;    /* Err: Table number other than 0/1 */
+        }
+        jd->stbl[j] = (uint8_t)b;
+        jd->scomp |= 1 << j;
+    }
+    seg += 1 + 2 * n;
+    jd->ss = seg[0]; jd->se = seg[1];           /* Spectral selection */
+    jd->ah = seg[2] >> 4; jd->al = seg[2] & 15; /* Successive approximation */
+    if (jd->ss ? (jd->se < jd->ss || jd->se > 63 || n != 1) : jd->se != 0) {
+        return JDR_FMT1;    /* Err: Wrong spectral selection (AC scan must be non-interleaved) */
+    }
+    if ((jd->ah && jd->ah != jd->al + 1) || jd->al > 13) {
+        return JDR_FMT1;    /* Err: Wrong successive approximation */
+    }
+
+    /* Check if all tables needed by the scan have been loaded */
+    for (i = 0; i < jd->ncomp; i++) {
+        if (!(jd->scomp & (1 << i))) {
+            continue;
+        }
+        if (jd->ss ? !jd->huffbits[jd->stbl[i] & 1][1] : (!jd->ah && !jd->huffbits[jd->stbl[i] >> 4][0])) {
+            return JDR_FMT1;    /* Err: Huffman table not loaded */
+        }
+        if (!jd->qttbl[jd->qtid[i]]) {
+            return JDR_FMT1;    /* Err: Dequantizer table not loaded */
+        }
+    }
+    jd->dcv[2] = jd->dcv[1] = jd->dcv[0] = 0;   /* Reset DC offset */
+    jd->eobrun = 0;                             /* Reset EOB run */
+
+    return JDR_OK;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Refine a non-zero AC element with a correction bit                    */
+/*-----------------------------------------------------------------------*/
+
+static int ac_refine (  /* 0:OK, <0: error code */
+    JDEC *jd,           /* Pointer to the decompressor object */
+    int16_t *c,         /* Pointer to the coefficient */
+    int p1              /* Weight of the bit to refine */
+)
+{
+    int d = bitext(jd, 1);
+
+
+    if (d < 0) {
+        return d;
+    }
+    if (d && !(*c & p1)) {
+        *c += (*c >= 0) ? p1 : -p1; /* Add the bit away from zero */
+    }
+    return 0;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Decode a block of the current scan into the coefficient buffer        */
+/*-----------------------------------------------------------------------*/
+
+static JRESULT block_scan (
+    JDEC *jd,           /* Pointer to the decompressor object */
+    int16_t *blk,       /* Coefficients of the block in zigzag-order */
+    unsigned int cmp    /* Component number 0:Y, 1:Cb, 2:Cr */
+)
+{
+    int d, e, p1 = 1 << jd->al;
+    unsigned int bc, r, z, id;
+
+
+    if (!jd->ss) {              /* DC scan */
+        if (jd->ah) {           /* Refinement: a bit to append */
+            d = bitext(jd, 1);
+            if (d < 0) {
+                return (JRESULT)(0 - d);    /* Err: input */
+            }
+            if (d) {
+                blk[0] |= p1;
+            }
+            return JDR_OK;
+        }
+        d = huffext(jd, jd->stbl[cmp] >> 4, 0); /* First scan: extract a huffman coded data (bit length) */
+        if (d < 0) {
+            return (JRESULT)(0 - d);    /* Err: invalid code or input */
+        }
+        bc = (unsigned int)d;
+        d = jd->dcv[cmp];                       /* DC value of previous block */
+        if (bc) {                               /* If there is any difference from previous block */
+            e = bitext(jd, bc);                 /* Extract data bits */
+            if (e < 0) {
+                return (JRESULT)(0 - e);    /* Err: input */
+            }
+            bc = 1 << (bc - 1);                 /* MSB position */
+            if (!(e & bc)) {
+                e -= (bc << 1) - 1;    /* Restore negative value if needed */
+            }
+            d += e;                             /* Get current value */
+            jd->dcv[cmp] = (int16_t)d;          /* Save current DC value for next block */
+        }
+        blk[0] = (int16_t)(d * p1);
+        return JDR_OK;
+    }
+
+    id = jd->stbl[cmp] & 1;     /* AC scan */
+    z = jd->ss;
+    if (!jd->ah) {              /* First scan of the band */
+        if (jd->eobrun) {       /* In EOB run? */
+            jd->eobrun--;
+            return JDR_OK;
+        }
+        for ( ; z <= jd->se; z++) {
+            d = huffext(jd, id, 1);             /* Extract a huffman coded value (zero runs and bit length) */
+            if (d < 0) {
+                return (JRESULT)(0 - d);    /* Err: invalid code or input error */
+            }
+            r = (unsigned int)d >> 4; bc = (unsigned int)d & 0x0F;
+            if (!bc) {
+                if (r < 15) {                   /* EOBr: end of this band and following 2^r + n - 1 blocks */
+                    jd->eobrun = (uint16_t)((1 << r) - 1);
+                    if (r) {
+                        d = bitext(jd, r);
+                        if (d < 0) {
+                            return (JRESULT)(0 - d);    /* Err: input */
+                        }
+                        jd->eobrun += (uint16_t)d;
+                    }
+                    break;
+                }
+                z += 15;                        /* ZRL: skip 16 zeros */
+                continue;
+            }
+            z += r;                             /* Skip leading zero run */
+            if (z > jd->se) {
+                return JDR_FMT1;    /* Too long zero run */
+            }
+            d = bitext(jd, bc);                 /* Extract data bits */
+            if (d < 0) {
+                return (JRESULT)(0 - d);    /* Err: input */
+            }
+            bc = 1 << (bc - 1);                 /* MSB position */
+            if (!(d & bc)) {
+                d -= (bc << 1) - 1;    /* Restore negative value if needed */
+            }
+            blk[z] = (int16_t)(d * p1);
+        }
+        return JDR_OK;
+    }
+
+    if (!jd->eobrun) {          /* Refinement: correction bits of non-zero elements and new elements of +/-1 */
+        for ( ; z <= jd->se; z++) {
+            d = huffext(jd, id, 1);             /* Extract a huffman coded value (zero runs and bit length) */
+            if (d < 0) {
+                return (JRESULT)(0 - d);    /* Err: invalid code or input error */
+            }
+            r = (unsigned int)d >> 4; bc = (unsigned int)d & 0x0F;
+            e = 0;
+            if (bc) {                           /* A new element of +/-1 follows r zeros */
+                d = bitext(jd, 1);
+                if (d < 0) {
+                    return (JRESULT)(0 - d);    /* Err: input */
+                }
+                e = d ? p1 : -p1;
+            } else if (r < 15) {                /* EOBr: rest of the band is refined below */
+                jd->eobrun = (uint16_t)(1 << r);
+                if (r) {
+                    d = bitext(jd, r);
+                    if (d < 0) {
+                        return (JRESULT)(0 - d);    /* Err: input */
+                    }
+                    jd->eobrun += (uint16_t)d;
+                }
+                break;
+            }
+            for ( ; z <= jd->se; z++) {         /* Skip r zero elements, refining non-zero ones on the way */
+                if (blk[z]) {
+                    d = ac_refine(jd, &blk[z], p1);
+                    if (d < 0) {
+                        return (JRESULT)(0 - d);    /* Err: input */
+                    }
+                } else {
+                    if (!r) {
+                        break;
+                    }
+                    r--;
+                }
+            }
+            if (e) {
+                if (z > jd->se) {
+                    return JDR_FMT1;    /* Too long zero run */
+                }
+                blk[z] = (int16_t)e;
+            }
+        }
+    }
+    if (jd->eobrun) {           /* In EOB run: refine non-zero elements in rest of the band */
+        for ( ; z <= jd->se; z++) {
+            if (blk[z]) {
+                d = ac_refine(jd, &blk[z], p1);
+                if (d < 0) {
+                    return (JRESULT)(0 - d);    /* Err: input */
+                }
+            }
+        }
+        jd->eobrun--;
+    }
+
+    return JDR_OK;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Load all blocks in an MCU from the coefficient buffer                 */
+/*-----------------------------------------------------------------------*/
+
+static JRESULT mcu_load_coef (
+    JDEC *jd,           /* Pointer to the decompressor object */
+    unsigned int x,     /* MCU location in the image */
+    unsigned int y
+)
+{
+    int32_t *tmp = (int32_t *)jd->workbuf;  /* Block working buffer for de-quantize and IDCT */
+    unsigned int blk, nby, i, k, z, cmp;
+    const int16_t *cp;
+    jd_yuv_t *bp;
+    const int32_t *dqf;
+
+
+    nby = jd->msx * jd->msy;    /* Number of Y blocks (1, 2 or 4) */
+    bp = jd->mcubuf;            /* Pointer to the first block of MCU */
+    x /= jd->msx * 8; y /= jd->msy * 8;
+
+    for (blk = 0; blk < nby + 2; blk++) {   /* Get nby Y blocks and two C blocks */
+        cmp = (blk < nby) ? 0 : blk - nby + 1;  /* Component number 0:Y, 1:Cb, 2:Cr */
+
+        if (cmp && jd->ncomp != 3) {        /* Clear C blocks if not exist (monochrome image) */
+            for (i = 0; i < 64; bp[i++] = 128) ;
+
+        } else if (JD_FORMAT != 2 || !cmp) {    /* C components may not be processed if in grayscale output */
+            if (cmp) {
+                cp = coef_block(jd, cmp, x, y);
+            } else {
+                cp = coef_block(jd, 0, x * jd->msx + blk % jd->msx, y * jd->msy + blk / jd->msx);
+            }
+            dqf = jd->qttbl[jd->qtid[cmp]];     /* De-quantizer table ID for this component */
+            memset(tmp, 0, 64 * sizeof (int32_t));
+            for (z = 1, i = 0; i < 64; i++) {   /* De-quantize the elements in zigzag-order */
+                if (cp[i]) {
+                    k = Zig[i];                 /* Get raster-order index */
+                    tmp[k] = cp[i] * dqf[k] >> 8;   /* De-quantize, apply scale factor of Arai algorithm and descale 8 bits */
+                    if (i) {
+                        z = i + 1;
+                    }
+                }
+            }
+            PROF_ADD(jd, entropy);
+            PROF_INC(jd, blocks);
+            block_put(jd, tmp, bp, z);
+        }
+
+        bp += 64;               /* Next block */
+    }
+
+    return JDR_OK;
+}
+#endif
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Analyze the JPEG image and Initialize decompressor object             */
+/*-----------------------------------------------------------------------*/
+
+#define LDB_WORD(ptr)       (uint16_t)(((uint16_t)*((uint8_t*)(ptr))<<8)|(uint16_t)*(uint8_t*)((ptr)+1))
+
+
+JRESULT jd_prepare (
+    JDEC *jd,               /* Blank decompressor object */
+    size_t (*infunc)(JDEC *, uint8_t *, size_t), /* JPEG strem input function */
+    void *pool,             /* Working buffer for the decompression session */
+    size_t sz_pool,         /* Size of working buffer */
+    void *dev               /* I/O device identifier for the session */
+)
+{
+    uint8_t *seg, b;
+    uint16_t marker;
+    unsigned int n, i, ofs;
+    size_t len;
+    JRESULT rc;
+
+
+    memset(jd, 0, sizeof (JDEC));   /* Clear decompression object (this might be a problem if machine's null pointer is not all bits zero) */
+    jd->pool = pool;        /* Work memroy */
+    jd->sz_pool = sz_pool;  /* Size of given work memory */
+    jd->infunc = infunc;    /* Stream input function */
+    jd->device = dev;       /* I/O device identifier */
+
+    jd->inbuf = seg = alloc_pool(jd, JD_SZBUF);     /* Allocate stream input buffer */
+    if (!seg) {
+        return JDR_MEM1;
+    }
+
+    ofs = marker = 0;       /* Find SOI marker */
+    do {
+        if (jd->infunc(jd, seg, 1) != 1) {
+            return JDR_INP;    /* Err: SOI was not detected */
+        }
+        ofs++;
+        marker = marker << 8 | seg[0];
+    } while (marker != 0xFFD8);
+
+    for (;;) {              /* Parse JPEG segments */
+        /* Get a JPEG marker */
+        if (jd->infunc(jd, seg, 4) != 4) {
+            return JDR_INP;
+        }
+        marker = LDB_WORD(seg);     /* Marker */
+        len = LDB_WORD(seg + 2);    /* Length field */
+
+        /*
+        In the baseline JPEG specification, 0xFF is always used as the "marker prefix," and the byte that follows determines
+        the marker type (e.g., 0xD8 for SOI, 0xD9 for EOI, 0xDA for SOS, etc.).
+        A 0xFFFF sequence, however, does not correspond to any valid, standard JPEG marker.
+
+        In JPEG-compressed data, any single 0xFF in the entropy-coded segment is supposed to be followed by 0x00 if it is not a marker.
+        Sometimes, encoders or hardware incorrectly insert repeated 0xFF bytes without the 0x00 "stuffing" byte.
+        This confuses decoders that strictly follow the JPEG standard.
+        */
+        if (marker == 0xFFFF) {
+            // Check if ignoring seg[0] byte gives us valid marker
+            // We must read 1 more byte from the input stream
+            if (jd->infunc(jd, &seg[4], 1) != 1) {
+                return JDR_INP;
+            }
+            marker = LDB_WORD(seg + 1);
+            len = LDB_WORD(seg + 3);
+            ofs++;
+        }
+        if (len <= 2 || (marker >> 8) != 0xFF) {
+            return JDR_FMT1;
+        }
+        len -= 2;           /* Segent content size */
+        ofs += 4 + len;     /* Number of bytes loaded */
+
+        switch (marker & 0xFF) {
+#if JD_PROGRESSIVE
+        case 0xC2:  /* SOF2 (progressive JPEG) */
+#endif
+        case 0xC0:  /* SOF0 (baseline JPEG) */
+            if (len > JD_SZBUF) {
+                return JDR_MEM2;
+            }
+            if (jd->infunc(jd, seg, len) != len) {
+                return JDR_INP;    /* Load segment data */
+            }
+
+            jd->width = LDB_WORD(&seg[3]);      /* Image width in unit of pixel */
+            jd->height = LDB_WORD(&seg[1]);     /* Image height in unit of pixel */
+            jd->ncomp = seg[5];                 /* Number of color components */
+            if (jd->ncomp != 3 && jd->ncomp != 1) {
+                return JDR_FMT3;    /* Err: Supports only Grayscale and Y/Cb/Cr */
+            }
+#if JD_PROGRESSIVE
+            jd->progressive = (marker & 0xFF) == 0xC2;
+#endif
+
+            /* Check each image component */
+            for (i = 0; i < jd->ncomp; i++) {
+                b = seg[7 + 3 * i];                         /* Get sampling factor */
+                if (i == 0) {   /* Y component */
+                    if (b != 0x11 && b != 0x22 && b != 0x21) {  /* Check sampling factor */
+                        return JDR_FMT3;                    /* Err: Supports only 4:4:4, 4:2:0 or 4:2:2 */
+                    }
+                    jd->msx = b >> 4; jd->msy = b & 15;     /* Size of MCU [blocks] */
+                } else {        /* Cb/Cr component */
+                    if (b != 0x11) {
+                        return JDR_FMT3;    /* Err: Sampling factor of Cb/Cr must be 1 */
+                    }
+                }
+                jd->qtid[i] = seg[8 + 3 * i];               /* Get dequantizer table ID for this component */
+                if (jd->qtid[i] > 3) {
+                    return JDR_FMT3;    /* Err: Invalid ID */
+                }
+#if JD_PROGRESSIVE
+                jd->cid[i] = seg[6 + 3 * i];                /* Get component ID to be referred by the scans */
+#endif
+            }
+            break;
+
+        case 0xDD:  /* DRI - Define Restart Interval */
+            if (len > JD_SZBUF) {
+                return JDR_MEM2;
+            }
+            if (jd->infunc(jd, seg, len) != len) {
+                return JDR_INP;    /* Load segment data */
+            }
+
+            jd->nrst = LDB_WORD(seg);   /* Get restart interval (MCUs) */
+            break;
+
+        case 0xC4:  /* DHT - Define Huffman Tables */
+            if (len > JD_SZBUF) {
+                return JDR_MEM2;
+            }
+            if (jd->infunc(jd, seg, len) != len) {
+                return JDR_INP;    /* Load segment data */
+            }
+
+            rc = create_huffman_tbl(jd, seg, len);  /* Create huffman tables */
+            if (rc) {
+                return rc;
+            }
+            break;
+
+        case 0xDB:  /* DQT - Define Quaitizer Tables */
+            if (len > JD_SZBUF) {
+                return JDR_MEM2;
+            }
+            if (jd->infunc(jd, seg, len) != len) {
+                return JDR_INP;    /* Load segment data */
+            }
+
+            rc = create_qt_tbl(jd, seg, len);   /* Create de-quantizer tables */
+            if (rc) {
+                return rc;
+            }
+            break;
+
+        case 0xDA:  /* SOS - Start of Scan */
+            if (len > JD_SZBUF) {
+                return JDR_MEM2;
+            }
+            if (jd->infunc(jd, seg, len) != len) {
+                return JDR_INP;    /* Load segment data */
+            }
+
+            if (!jd->width || !jd->height) {
+                return JDR_FMT1;    /* Err: Invalid image size */
+            }
+#if JD_PROGRESSIVE
+            if (jd->progressive) {  /* Progressive JPEG: check the first scan and its tables */
+                rc = setup_scan(jd, seg, len);
+                if (rc) {
+                    return rc;
+                }
+            }
+#endif
+            if (!PROGRESSIVE(jd) && seg[0] != jd->ncomp) {
+                return JDR_FMT3;    /* Err: Wrong color components */
+            }
+
+            /* Check if all tables corresponding to each components have been loaded */
+            for (i = 0; !PROGRESSIVE(jd) && i < jd->ncomp; i++) {
+                b = seg[2 + 2 * i]; /* Get huffman table ID */
+                if (b != 0x00 && b != 0x11) {
+                    return JDR_FMT3;    /* Err: Different table number for DC/AC element */
+                }
+                n = i ? 1 : 0;                          /* Component class */
+                if (!jd->huffbits[n][0] || !jd->huffbits[n][1]) {   /* Check huffman table for this component */
+#if JD_DEFAULT_HUFFMAN
+                    jd_load_default_huffman(jd); // Always returns OK
+#else
+                    return JDR_FMT1;                    /* Err: Nnot loaded */
+#endif
+                }
+                if (!jd->qttbl[jd->qtid[i]]) {          /* Check dequantizer table for this component */
+                    return JDR_FMT1;                    /* Err: Not loaded */
+                }
+            }
+
+            /* Allocate working buffer for MCU and pixel output */
+            n = jd->msy * jd->msx;                      /* Number of Y blocks in the MCU */
+            if (!n) {
+                return JDR_FMT1;    /* Err: SOF0 has not been loaded */
+            }
+            len = n * 64 * 2 + 64;                      /* Allocate buffer for IDCT and RGB output */
+            if (len < 256) {
+                len = 256;    /* but at least 256 byte is required for IDCT */
+            }
+            jd->workbuf = alloc_pool(jd, len);          /* and it may occupy a part of following MCU working buffer for RGB output */
+            if (!jd->workbuf) {
+                return JDR_MEM1;    /* Err: not enough memory */
+            }
+            jd->mcubuf = alloc_pool(jd, (n + 2) * 64 * sizeof (jd_yuv_t));  /* Allocate MCU working buffer */
+            if (!jd->mcubuf) {
+                return JDR_MEM1;    /* Err: not enough memory */
+            }
+
+            /* Align stream read offset to JD_SZBUF */
+            jd->rdofs = ofs;
+            if (ofs %= JD_SZBUF) {
+                jd->dctr = jd->infunc(jd, seg + ofs, (size_t)(JD_SZBUF - ofs));
+                jd->rdofs += jd->dctr;
+            }
+            jd->dptr = seg + ofs - (JD_FASTDECODE ? 0 : 1);
+
+            return JDR_OK;      /* Initialization succeeded. Ready to decompress the JPEG image. */
+
+        case 0xC1:  /* SOF1 */
+#if !JD_PROGRESSIVE
+        case 0xC2:  /* SOF2 */
+#endif
+        case 0xC3:  /* SOF3 */
+        case 0xC5:  /* SOF5 */
+        case 0xC6:  /* SOF6 */
+        case 0xC7:  /* SOF7 */
+        case 0xC9:  /* SOF9 */
+        case 0xCA:  /* SOF10 */
+        case 0xCB:  /* SOF11 */
+        case 0xCD:  /* SOF13 */
+        case 0xCE:  /* SOF14 */
+        case 0xCF:  /* SOF15 */
+        case 0xD9:  /* EOI */
+            return JDR_FMT3;    /* Unsuppoted JPEG standard (may be progressive JPEG) */
+
+        default:    /* Unknown segment (comment, exif or etc..) */
+            /* Skip segment data (null pointer specifies to remove data from the stream) */
+            if (jd->infunc(jd, 0, len) != len) {
+                return JDR_INP;
+            }
+        }
+    }
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Save/restore decoding state at the top of an MCU row                  */
+/*-----------------------------------------------------------------------*/
+
+static void save_mark (
+    JDEC *jd,           /* Pointer to the decompressor object */
+    JMARK *mark,        /* Pointer to store the decoding state */
+    unsigned int row,   /* MCU row */
+    uint16_t rst,       /* MCUs since the last restart */
+    uint16_t rsc        /* Number of the next restart marker */
+)
+{
+    mark->ofs = jd->rdofs - (uint32_t)jd->dctr;    /* Bytes left in the input buffer are read again */
+#if JD_FASTDECODE == 0
+    mark->wreg = jd->dbit ? *jd->dptr : 0;          /* Current byte (the rest of it is not extracted yet) */
+    mark->marker = 0;
+#else
+    mark->wreg = jd->wreg;
+    mark->marker = jd->marker;
+#endif
+    mark->dbit = jd->dbit;
+    mark->row = (uint16_t)row;
+    mark->rst = rst; mark->rsc = rsc;
+    mark->dcv[0] = jd->dcv[0]; mark->dcv[1] = jd->dcv[1]; mark->dcv[2] = jd->dcv[2];
+}
+
+
+static void restore_mark (
+    JDEC *jd,           /* Pointer to the decompressor object */
+    const JMARK *mark   /* Decoding state to restore */
+)
+{
+    jd->dptr = jd->inbuf;   /* Input buffer is empty, the input function continues from mark->ofs */
+    jd->dctr = 0;
+    jd->rdofs = mark->ofs;
+#if JD_FASTDECODE == 0
+    jd->inbuf[0] = (uint8_t)mark->wreg;
+#else
+    jd->wreg = mark->wreg;
+    jd->marker = mark->marker;
+#endif
+    jd->dbit = mark->dbit;
+    jd->dcv[0] = mark->dcv[0]; jd->dcv[1] = mark->dcv[1]; jd->dcv[2] = mark->dcv[2];
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Start to decompress the JPEG picture                                  */
+/*-----------------------------------------------------------------------*/
+
+JRESULT jd_decomp (
+    JDEC *jd,                               /* Initialized decompression object */
+    int (*outfunc)(JDEC *, void *, JRECT *), /* RGB output function */
+    uint8_t scale                           /* Output de-scaling factor (0 to 3) */
+)
+{
+    return jd_decomp_rows(jd, outfunc, scale, 0, 0, 0);
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Decompress a band of MCU rows of the JPEG picture                     */
+/*-----------------------------------------------------------------------*/
+
+JRESULT jd_decomp_rows (
+    JDEC *jd,                               /* Initialized decompression object */
+    int (*outfunc)(JDEC *, void *, JRECT *), /* RGB output function */
+    uint8_t scale,                          /* Output de-scaling factor (0 to 3) */
+    const JMARK *mark,                      /* Decoding state to resume from (NULL:top of the picture). The input function must continue from mark->ofs */
+    unsigned int top,                       /* First MCU row to output (rows from the mark are only entropy decoded) */
+    unsigned int nrow                       /* Number of MCU rows to output (0:to the bottom of the picture) */
+)
+{
+    unsigned int x, y, mx, my, ys, ye;
+    uint16_t rst, rsc;
+    uint8_t ydc[4];
+    JRECT rect;
+    JRESULT rc;
+
+
+    if (scale > (JD_USE_SCALE ? 3 : 0)) {
+        return JDR_PAR;
+    }
+    jd->scale = scale;
+
+    mx = jd->msx * 8; my = jd->msy * 8;         /* Size of the MCU (pixel) */
+#if JD_PROGRESSIVE
+    if (jd->progressive && (!jd->coef || mark)) {
+        return JDR_PAR;     /* Progressive JPEG is output from the coefficient buffer after jd_scan() */
+    }
+#endif
+
+    if (mark) {                                 /* Resume from the saved decoding state */
+        if (mark->row > top) {
+            return JDR_PAR;
+        }
+        restore_mark(jd, mark);
+        rst = mark->rst; rsc = mark->rsc;
+        y = mark->row * my;
+    } else {
+        jd->dcv[2] = jd->dcv[1] = jd->dcv[0] = 0;   /* Initialize DC values */
+        rst = rsc = 0;
+        y = 0;
+    }
+    ys = top * my;                              /* Output rows */
+    if (PROGRESSIVE(jd)) {
+        y = ys;                                 /* No need to decode the rows above the band */
+    }
+    ye = (nrow && ys + nrow * my < jd->height) ? ys + nrow * my : jd->height;
+#if JD_PROFILE
+    memset(&jd->prof, 0, sizeof jd->prof);
+    PROF_START(jd);
+#endif
+
+    rc = JDR_OK;
+    for ( ; y < ye; y += my) {                  /* Vertical loop of MCUs */
+        for (x = 0; x < jd->width; x += mx) {   /* Horizontal loop of MCUs */
+            if (!PROGRESSIVE(jd) && jd->nrst && rst++ == jd->nrst) {    /* Process restart interval if enabled */
+                rc = restart(jd, rsc++);
+                if (rc != JDR_OK) {
+                    return rc;
+                }
+                rst = 1;
+            }
+            if (y < ys) {                       /* Above the band: entropy decode only */
+                rc = mcu_scan_dc(jd, ydc);
+                if (rc != JDR_OK) {
+                    return rc;
+                }
+                continue;
+            }
+            PROF_INC(jd, mcus);
+#if JD_PROGRESSIVE
+            rc = jd->progressive ? mcu_load_coef(jd, x, y) : mcu_load(jd);  /* Load an MCU (decompress huffman coded stream or get coefficients, dequantize and apply IDCT) */
+#else
+            rc = mcu_load(jd);                  /* Load an MCU (decompress huffman coded stream, dequantize and apply IDCT) */
+#endif
+            if (rc != JDR_OK) {
+                return rc;
+            }
+            if (jd->mcufunc) {                  /* Pass the Y/C blocks to the inspection function if set */
+                rect.left = x; rect.right = (x + mx <= jd->width ? x + mx : jd->width) - 1;
+                rect.top = y; rect.bottom = (y + my <= jd->height ? y + my : jd->height) - 1;
+                jd->mcufunc(jd, jd->mcubuf, &rect);
+                PROF_ADD(jd, output);
+            }
+            rc = mcu_output(jd, outfunc, x, y); /* Output the MCU (YCbCr to RGB, scaling and output) */
+            if (rc != JDR_OK) {
+                return rc;
+            }
+        }
+    }
+
+    return rc;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Build an index of decoding states for jd_decomp_rows()                */
+/*-----------------------------------------------------------------------*/
+
+JRESULT jd_index (
+    JDEC *jd,           /* Initialized decompression object */
+    JMARK *mark,        /* Array to store the decoding state at the top of every nrow MCU rows */
+    unsigned int nmark, /* Number of items in the array */
+    unsigned int nrow   /* MCU rows between two saved states */
+)
+{
+    unsigned int x, y, mx, my, row, n;
+    uint16_t rst, rsc;
+    uint8_t ydc[4];
+    JRESULT rc;
+
+
+    if (PROGRESSIVE(jd)) {
+        return JDR_FMT3;    /* Not available for progressive JPEG */
+    }
+    mx = jd->msx * 8; my = jd->msy * 8;         /* Size of the MCU (pixel) */
+    n = (jd->height + my - 1) / my;             /* Number of MCU rows */
+    if (!nrow || nmark < (n + nrow - 1) / nrow) {
+        return JDR_PAR;
+    }
+
+    jd->dcv[2] = jd->dcv[1] = jd->dcv[0] = 0;   /* Initialize DC values */
+    rst = rsc = 0;
+
+    for (y = row = 0; y < jd->height; y += my, row++) { /* Vertical loop of MCUs */
+        if (row % nrow == 0) {
+            save_mark(jd, mark++, row, rst, rsc);
+            if (row + nrow >= n) {
+                break;      /* No more states to save */
+            }
+        }
+        for (x = 0; x < jd->width; x += mx) {   /* Horizontal loop of MCUs */
+            if (jd->nrst && rst++ == jd->nrst) {    /* Process restart interval if enabled */
+                rc = restart(jd, rsc++);
+                if (rc != JDR_OK) {
+                    return rc;
+                }
+                rst = 1;
+            }
+            rc = mcu_scan_dc(jd, ydc);          /* Entropy decode an MCU */
+            if (rc != JDR_OK) {
+                return rc;
+            }
+        }
+    }
+
+    return JDR_OK;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Scan the JPEG picture and extract the mean level of each Y block      */
+/*-----------------------------------------------------------------------*/
+
+JRESULT jd_dcscan (
+    JDEC *jd,       /* Initialized decompression object */
+    uint8_t *dcmap  /* Output map of Y block levels, one byte per block in the MCU aligned image */
+)
+{
+    unsigned int x, y, mx, my, bw, i, j;
+    uint16_t rst, rsc;
+    uint8_t ydc[4];
+    JRESULT rc;
+
+
+    if (PROGRESSIVE(jd)) {
+        return JDR_FMT3;    /* Not available for progressive JPEG */
+    }
+    mx = jd->msx * 8; my = jd->msy * 8;         /* Size of the MCU (pixel) */
+    bw = (jd->width + mx - 1) / mx * jd->msx;   /* Number of blocks in a row of the map */
+
+    jd->dcv[2] = jd->dcv[1] = jd->dcv[0] = 0;   /* Initialize DC values */
+    rst = rsc = 0;
+
+    for (y = 0; y < jd->height; y += my) {      /* Vertical loop of MCUs */
+        for (x = 0; x < jd->width; x += mx) {   /* Horizontal loop of MCUs */
+            if (jd->nrst && rst++ == jd->nrst) {    /* Process restart interval if enabled */
+                rc = restart(jd, rsc++);
+                if (rc != JDR_OK) {
+                    return rc;
+                }
+                rst = 1;
+            }
+            rc = mcu_scan_dc(jd, ydc);          /* Entropy decode an MCU and keep DC values of Y blocks */
+            if (rc != JDR_OK) {
+                return rc;
+            }
+            for (i = 0; i < jd->msy; i++) {     /* Put the Y blocks at their location in the map */
+                for (j = 0; j < jd->msx; j++) {
+                    dcmap[(y / 8 + i) * bw + x / 8 + j] = ydc[i * jd->msx + j];
+                }
+            }
+        }
+    }
+
+    return JDR_OK;
+}
+
+
+
+
+#if JD_PROGRESSIVE
+/*-----------------------------------------------------------------------*/
+/* Byte access to the stream between the scans of progressive JPEG       */
+/*-----------------------------------------------------------------------*/
+
+/* jd->dptr points the next byte to read and jd->dctr bytes follow it */
+
+static int stream_getc (    /* >=0: a byte, <0: error code */
+    JDEC *jd                /* Pointer to the decompressor object */
+)
+{
+    if (!jd->dctr) {        /* No input data is available, re-fill input buffer */
+        jd->dptr = jd->inbuf;
+        jd->dctr = jd->infunc(jd, jd->dptr, JD_SZBUF); jd->rdofs += jd->dctr;
+        if (!jd->dctr) {
+            return 0 - (int)JDR_INP;
+        }
+    }
+    jd->dctr--;
+    return *jd->dptr++;
+}
+
+
+static JRESULT stream_load (
+    JDEC *jd,               /* Pointer to the decompressor object */
+    uint8_t **seg,          /* Pointer to return the loaded data in the input buffer */
+    size_t len              /* Number of bytes to load */
+)
+{
+    size_t n;
+
+
+    if (len > JD_SZBUF) {
+        return JDR_MEM2;
+    }
+    if (jd->dctr < len) {   /* Move the rest to top of the input buffer and fill it */
+        memmove(jd->inbuf, jd->dptr, jd->dctr);
+        jd->dptr = jd->inbuf;
+        do {
+            n = jd->infunc(jd, jd->inbuf + jd->dctr, JD_SZBUF - jd->dctr);
+            if (!n) {
+                return JDR_INP;
+            }
+            jd->dctr += n; jd->rdofs += n;
+        } while (jd->dctr < len);
+    }
+    *seg = jd->dptr;
+    jd->dptr += len; jd->dctr -= len;
+    return JDR_OK;
+}
+
+
+static JRESULT stream_skip (
+    JDEC *jd,               /* Pointer to the decompressor object */
+    size_t len              /* Number of bytes to skip */
+)
+{
+    size_t n = jd->dctr < len ? jd->dctr : len;
+
+
+    jd->dptr += n; jd->dctr -= n;
+    len -= n;
+    if (len) {              /* Remove the rest from the stream */
+        if (jd->infunc(jd, 0, len) != len) {
+            return JDR_INP;
+        }
+        jd->rdofs += len;
+    }
+    return JDR_OK;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Process the segments between the scans up to the next SOS or EOI      */
+/*-----------------------------------------------------------------------*/
+
+static JRESULT next_scan (
+    JDEC *jd        /* Pointer to the decompressor object */
+)
+{
+    uint8_t *seg;
+    unsigned int marker = 0;
+    size_t len;
+    int d;
+    JRESULT rc;
+
+
+#if JD_FASTDECODE == 0
+    jd->dptr++;                 /* Rest of the current byte is stuff bits */
+#else
+    marker = jd->marker;        /* A marker may have been read by the huffman decoder */
+    jd->marker = 0;
+#endif
+    jd->dbit = 0;
+
+    for (;;) {
+        while (!marker || (marker & 0xF8) == 0xD0) {    /* Find a marker (stuffed 0xFF and RSTn are skipped) */
+            marker = 0;
+            d = stream_getc(jd);
+            if (d < 0) {
+                return (JRESULT)(0 - d);
+            }
+            if (d == 0xFF) {
+                do {            /* Skip fill bytes */
+                    d = stream_getc(jd);
+                    if (d < 0) {
+                        return (JRESULT)(0 - d);
+                    }
+                } while (d == 0xFF);
+                marker = (unsigned int)d;
+            }
+        }
+        if (marker == 0xD9) {   /* EOI: no more scan */
+            jd->scomp = 0;
+            return JDR_OK;
+        }
+
+        rc = stream_load(jd, &seg, 2);      /* Get length field */
+        if (rc) {
+            return rc;
+        }
+        len = LDB_WORD(seg);
+        if (len <= 2) {
+            return JDR_FMT1;
+        }
+        len -= 2;           /* Segent content size */
+        if (marker == 0xDA || marker == 0xC4 || marker == 0xDB || marker == 0xDD) {
+            rc = stream_load(jd, &seg, len);    /* Load segment data */
+        } else {
+            rc = stream_skip(jd, len);          /* Skip unknown segment */
+        }
+        if (rc) {
+            return rc;
+        }
+
+        switch (marker) {
+        case 0xDA:  /* SOS - Start of Scan */
+            rc = setup_scan(jd, seg, len);
+#if JD_FASTDECODE == 0
+            jd->dptr--;     /* The first byte is read with pre-increment */
+#endif
+            return rc;
+
+        case 0xC4:  /* DHT - Define Huffman Tables */
+            rc = create_huffman_tbl(jd, seg, len);
+            break;
+
+        case 0xDB:  /* DQT - Define Quaitizer Tables */
+            rc = create_qt_tbl(jd, seg, len);
+            break;
+
+        case 0xDD:  /* DRI - Define Restart Interval */
+            jd->nrst = LDB_WORD(seg);
+            break;
+        }
+        if (rc) {
+            return rc;
+        }
+        marker = 0;
+    }
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Decode a scan of the progressive JPEG into the coefficient buffer     */
+/*-----------------------------------------------------------------------*/
+
+JRESULT jd_scan (
+    JDEC *jd,           /* Initialized decompression object */
+    int16_t *coef       /* Coefficient buffer of jd_coefsize() bytes, cleared before the first scan */
+)
+{
+    unsigned int x, y, bw, bh, blk, nby, cmp = 0;
+    uint16_t rst, rsc;
+    int16_t *cp;
+    JRESULT rc;
+
+
+    if (!jd->progressive || !jd->scomp || !coef) {
+        return JDR_PAR;     /* Not a progressive JPEG or no more scan */
+    }
+    jd->coef = coef;
+    nby = jd->msx * jd->msy;    /* Number of Y blocks (1, 2 or 4) */
+    rst = rsc = 0;
+
+    if (jd->scomp & (jd->scomp - 1)) {  /* Interleaved scan: MCUs in raster-order */
+        bw = (jd->width + jd->msx * 8 - 1) / (jd->msx * 8);
+        bh = (jd->height + jd->msy * 8 - 1) / (jd->msy * 8);
+    } else {                            /* Non-interleaved scan: blocks of the component in raster-order */
+        nby = 0;
+        cmp = (jd->scomp & 1) ? 0 : (jd->scomp & 2) ? 1 : 2;
+        bw = cmp ? (jd->width + jd->msx * 8 - 1) / (jd->msx * 8) : (jd->width + 7) / 8;
+        bh = cmp ? (jd->height + jd->msy * 8 - 1) / (jd->msy * 8) : (jd->height + 7) / 8;
+    }
+
+    for (y = 0; y < bh; y++) {
+        for (x = 0; x < bw; x++) {
+            if (jd->nrst && rst++ == jd->nrst) {    /* Process restart interval if enabled */
+                rc = restart(jd, rsc++);
+                if (rc != JDR_OK) {
+                    return rc;
+                }
+                rst = 1;
+            }
+            if (!nby) {     /* A block */
+                rc = block_scan(jd, coef_block(jd, cmp, x, y), cmp);
+                if (rc != JDR_OK) {
+                    return rc;
+                }
+                continue;
+            }
+            for (blk = 0; blk < nby + 2; blk++) {   /* Blocks of the components in the MCU */
+                cmp = (blk < nby) ? 0 : blk - nby + 1;
+                if (!(jd->scomp & (1 << cmp))) {
+                    continue;
+                }
+                if (cmp) {
+                    cp = coef_block(jd, cmp, x, y);
+                } else {
+                    cp = coef_block(jd, 0, x * jd->msx + blk % jd->msx, y * jd->msy + blk / jd->msx);
+                }
+                rc = block_scan(jd, cp, cmp);
+                if (rc != JDR_OK) {
+                    return rc;
+                }
+            }
+        }
+    }
+    jd->nscan++;
+
+    return next_scan(jd);   /* Get ready for the next scan */
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Get size of the coefficient buffer for jd_scan()                      */
+/*-----------------------------------------------------------------------*/
+
+size_t jd_coefsize (
+    JDEC *jd            /* Initialized decompression object */
+)
+{
+    size_t mw, mh;
+
+
+    if (!jd->progressive) {
+        return 0;
+    }
+    mw = (jd->width + jd->msx * 8 - 1) / (jd->msx * 8);     /* Number of MCU columns */
+    mh = (jd->height + jd->msy * 8 - 1) / (jd->msy * 8);    /* Number of MCU rows */
+    return mw * mh * (jd->msx * jd->msy + (jd->ncomp == 3 ? 2 : 0)) * 64 * sizeof (int16_t);
+}
+#endif
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Get size of the memory pool required by jd_prepare (dry run)          */
+/*-----------------------------------------------------------------------*/
+
+#define POOL_ALIGN(n)   (((n) + 3) & ~(size_t)3)    /* Block size aligned as in alloc_pool() */
+
+#if JD_PROGRESSIVE
+static uint16_t skip_scan ( /* Marker following the entropy-coded segment (0:input error) */
+    JDEC *jd                /* Decompressor object of jd_poolsize() */
+)
+{
+    uint8_t d, ff = 0;
+
+
+    for (;;) {
+        if (jd->infunc(jd, &d, 1) != 1) {
+            return 0;
+        }
+        if (ff && d != 0xFF && d != 0x00 && (d & 0xF8) != 0xD0) {   /* Stuffed 0xFF, fill bytes and RSTn are part of the scan */
+            return 0xFF00 | d;
+        }
+        ff = (d == 0xFF);
+    }
+}
+#endif
+
+JRESULT jd_poolsize (
+    JDEC *jd,               /* Blank decompressor object (only the input function is used) */
+    size_t (*infunc)(JDEC *, uint8_t *, size_t), /* JPEG strem input function */
+    void *dev,              /* I/O device identifier for the session */
+    size_t *sz_pool         /* Pointer to return the required size of working buffer */
+)
+{
+    uint8_t seg[17], b, ncomp = 0, msx = 0, msy = 0, ht = 0, prog = 0, htp = 0, qt = 0;
+    uint16_t marker, next = 0;
+    unsigned int i, n;
+    size_t len, np, sz;
+#if JD_PROGRESSIVE
+    unsigned int nscan = 0;
+#endif
+
+
+    memset(jd, 0, sizeof (JDEC));
+    jd->infunc = infunc;    /* Stream input function */
+    jd->device = dev;       /* I/O device identifier */
+
+    sz = POOL_ALIGN(JD_SZBUF);  /* Stream input buffer */
+
+    marker = 0;             /* Find SOI marker */
+    do {
+        if (jd->infunc(jd, seg, 1) != 1) {
+            return JDR_INP;    /* Err: SOI was not detected */
+        }
+        marker = marker << 8 | seg[0];
+    } while (marker != 0xFFD8);
+
+    for (;;) {              /* Parse JPEG segments in the same way as jd_prepare() */
+        if (next) {         /* Marker at the end of a scan of progressive JPEG */
+            marker = next;
+            next = 0;
+            if (marker == 0xFFD9) {     /* EOI: tables of all scans are counted */
+                break;
+            }
+            if (jd->infunc(jd, seg + 2, 2) != 2) {
+                return JDR_INP;
+            }
+        } else if (jd->infunc(jd, seg, 4) != 4) {
+            return JDR_INP;
+        } else {
+            marker = LDB_WORD(seg);     /* Marker */
+        }
+        len = LDB_WORD(seg + 2);    /* Length field */
+        if (marker == 0xFFFF) {     /* Invalid marker 0xFFFF (see jd_prepare()) */
+            if (jd->infunc(jd, &seg[4], 1) != 1) {
+                return JDR_INP;
+            }
+            marker = LDB_WORD(seg + 1);
+            len = LDB_WORD(seg + 3);
+        }
+        if (len <= 2 || (marker >> 8) != 0xFF) {
+            return JDR_FMT1;
+        }
+        len -= 2;           /* Segent content size */
+
+        switch (marker & 0xFF) {
+        case 0xC0:  /* SOF0 (baseline JPEG): get MCU size */
+#if JD_PROGRESSIVE
+        case 0xC2:  /* SOF2 (progressive JPEG) */
+#endif
+        case 0xDA:  /* SOS: get number of components in the scan */
+            if (len > JD_SZBUF) {
+                return JDR_MEM2;
+            }
+            n = len < sizeof seg ? len : sizeof seg;
+            if (jd->infunc(jd, seg, n) != n || (len > n && jd->infunc(jd, 0, len - n) != len - n)) {
+                return JDR_INP;
+            }
+            if ((marker & 0xFF) != 0xDA) {
+                if (n < 8) {
+                    return JDR_FMT1;
+                }
+                prog = (marker & 0xFF) == 0xC2;
+                ncomp = seg[5];
+                b = seg[7];                     /* Sampling factor of Y component */
+                if (b != 0x11 && b != 0x22 && b != 0x21) {
+                    return JDR_FMT3;
+                }
+                msx = b >> 4; msy = b & 15;
+                break;
+            }
+
+            /* SOS: default huffman tables are loaded if any table of the components is missing */
+            if (!msx || !ncomp) {
+                return JDR_FMT1;    /* Err: SOF0 has not been loaded */
+            }
+#if JD_PROGRESSIVE
+            if (nscan++) {  /* Later scan of progressive JPEG: only tables defined between the scans use the pool */
+                next = skip_scan(jd);
+                if (!next) {
+                    return JDR_INP;
+                }
+                break;
+            }
+#endif
+            if (prog) {     /* Progressive JPEG has no default huffman tables */
+                ht = 0x0F;
+            }
+            for (i = 0; i < ncomp; i++) {
+                n = i ? 1 : 0;
+                if ((ht & (3 << (n * 2))) != (3 << (n * 2))) {
+#if JD_DEFAULT_HUFFMAN
+                    sz += POOL_ALIGN(esp_jpeg_lum_dc_codes_total * sizeof (uint16_t)) + POOL_ALIGN(esp_jpeg_lum_ac_codes_total * sizeof (uint16_t))
+                          + POOL_ALIGN(esp_jpeg_chrom_dc_codes_total * sizeof (uint16_t)) + POOL_ALIGN(esp_jpeg_chrom_ac_codes_total * sizeof (uint16_t));
+#if JD_FASTDECODE == 2
+                    sz += 2 * (POOL_ALIGN(HUFF_LEN * sizeof (uint16_t)) + POOL_ALIGN(HUFF_LEN * sizeof (uint8_t)));
+#endif
+                    ht = 0x0F;
+#else
+                    return JDR_FMT1;    /* Err: Not loaded */
+#endif
+                }
+            }
+
+            /* Working buffer for MCU and pixel output */
+            n = msx * msy;
+            len = n * 64 * 2 + 64;
+            if (len < 256) {
+                len = 256;
+            }
+            sz += POOL_ALIGN(len) + POOL_ALIGN((n + 2) * 64 * sizeof (jd_yuv_t));
+
+#if JD_PROGRESSIVE
+            if (prog) {     /* Tables may still be defined between the scans */
+                next = skip_scan(jd);
+                if (!next) {
+                    return JDR_INP;
+                }
+                break;
+            }
+#endif
+            *sz_pool = sz;
+            return JDR_OK;
+
+        case 0xC4:  /* DHT: bit distribution, code word and decoded data tables (and LUT) for each table */
+            if (len > JD_SZBUF) {
+                return JDR_MEM2;
+            }
+            while (len) {
+                if (len < 17) {
+                    return JDR_FMT1;
+                }
+                if (jd->infunc(jd, seg, 17) != 17) {
+                    return JDR_INP;
+                }
+                len -= 17;
+                if (seg[0] & 0xEE) {
+                    return JDR_FMT1;
+                }
+                for (np = 0, i = 1; i < 17; i++) {
+                    np += seg[i];
+                }
+                if (len < np) {
+                    return JDR_FMT1;
+                }
+                if (jd->infunc(jd, 0, np) != np) {
+                    return JDR_INP;
+                }
+                len -= np;
+                if (!prog) {    /* Tables after SOF2 are counted at EOI */
+                    sz += POOL_ALIGN(16) + POOL_ALIGN(np * sizeof (uint16_t)) + POOL_ALIGN(np);
+#if JD_FASTDECODE == 2
+                    sz += (seg[0] >> 4) ? POOL_ALIGN(HUFF_LEN * sizeof (uint16_t)) : POOL_ALIGN(HUFF_LEN * sizeof (uint8_t));
+#endif
+                } else {
+                    htp |= 1 << ((seg[0] & 1) * 2 + (seg[0] >> 4));
+                }
+                ht |= 1 << ((seg[0] & 1) * 2 + (seg[0] >> 4));  /* Table [num][cls] is loaded */
+            }
+            break;
+
+        case 0xDB:  /* DQT: de-quantizer table for each table */
+            if (len > JD_SZBUF) {
+                return JDR_MEM2;
+            }
+            if (len % 65) {
+                return JDR_FMT1;
+            }
+            for (; len; len -= 65) {
+                if (jd->infunc(jd, seg, 1) != 1 || jd->infunc(jd, 0, 64) != 64) {
+                    return JDR_INP;
+                }
+                if (!prog || !(qt & (1 << (seg[0] & 3)))) {   /* A table redefined after SOF2 is loaded into the same memory */
+                    sz += POOL_ALIGN(64 * sizeof (int32_t));
+                }
+                qt |= 1 << (seg[0] & 3);
+            }
+            break;
+
+        case 0xC1:  /* SOF1 */
+#if !JD_PROGRESSIVE
+        case 0xC2:  /* SOF2 */
+#endif
+        case 0xC3:  /* SOF3 */
+        case 0xC5:  /* SOF5 */
+        case 0xC6:  /* SOF6 */
+        case 0xC7:  /* SOF7 */
+        case 0xC9:  /* SOF9 */
+        case 0xCA:  /* SOF10 */
+        case 0xCB:  /* SOF11 */
+        case 0xCD:  /* SOF13 */
+        case 0xCE:  /* SOF14 */
+        case 0xCF:  /* SOF15 */
+        case 0xD9:  /* EOI */
+            return JDR_FMT3;    /* Unsuppoted JPEG standard (may be progressive JPEG) */
+
+        default:    /* DRI and unknown segments do not use the memory pool */
+            if (jd->infunc(jd, 0, len) != len) {
+                return JDR_INP;
+            }
+        }
+    }
+
+#if JD_PROGRESSIVE
+    for (i = 0; i < 4; i++) {   /* Huffman tables defined after SOF2 are allocated once at the maximum size */
+        if (htp & (1 << i)) {
+            sz += POOL_ALIGN(16) + POOL_ALIGN(HUFF_MAXCODE * sizeof (uint16_t)) + POOL_ALIGN(HUFF_MAXCODE);
+#if JD_FASTDECODE == 2
+            sz += (i & 1) ? POOL_ALIGN(HUFF_LEN * sizeof (uint16_t)) : POOL_ALIGN(HUFF_LEN * sizeof (uint8_t));
+#endif
+        }
+    }
+#endif
+    *sz_pool = sz;
+    return JDR_OK;
+}
@@ -0,0 +1,171 @@
+/*----------------------------------------------------------------------------/
+/ TJpgDec - Tiny JPEG Decompressor R0.03 include file         (C)ChaN, 2021
+/----------------------------------------------------------------------------*/
+#ifndef DEF_TJPGDEC
+#define DEF_TJPGDEC
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "tjpgdcnf.h"
+#include <string.h>
+
+#if defined(_WIN32) /* VC++ or some compiler without stdint.h */
+typedef unsigned char   uint8_t;
+typedef unsigned short  uint16_t;
+typedef short           int16_t;
+typedef unsigned long   uint32_t;
+typedef long            int32_t;
+#else               /* Embedded platform */
+#include <stdint.h>
+#endif
+
+#if JD_FASTDECODE >= 1
+typedef int16_t jd_yuv_t;
+#else
+typedef uint8_t jd_yuv_t;
+#endif
+
+
+/* Error code */
+typedef enum {
+    JDR_OK = 0, /* 0: Succeeded */
+    JDR_INTR,   /* 1: Interrupted by output function */
+    JDR_INP,    /* 2: Device error or wrong termination of input stream */
+    JDR_MEM1,   /* 3: Insufficient memory pool for the image */
+    JDR_MEM2,   /* 4: Insufficient stream input buffer */
+    JDR_PAR,    /* 5: Parameter error */
+    JDR_FMT1,   /* 6: Data format error (may be broken data) */
+    JDR_FMT2,   /* 7: Right format but not supported */
+    JDR_FMT3    /* 8: Not supported JPEG standard */
+} JRESULT;
+
+
+
+/* Rectangular region in the output image */
+typedef struct {
+    uint16_t left;      /* Left end */
+    uint16_t right;     /* Right end */
+    uint16_t top;       /* Top end */
+    uint16_t bottom;    /* Bottom end */
+} JRECT;
+
+
+
+#if JD_PROFILE
+/* Per-stage counters of jd_decomp() (CPU cycles, nanoseconds on host) */
+typedef struct {
+    uint32_t entropy;   /* Huffman decoding and de-quantization (huffext, bitext) */
+    uint32_t idct;      /* IDCT or filling DC-only blocks */
+    uint32_t color;     /* YCbCr to RGB conversion, including RGB565 packing */
+    uint32_t scale;     /* Descaling of the RGB MCU */
+    uint32_t output;    /* Output and inspection functions */
+    uint32_t mcus;      /* Number of decoded MCUs */
+    uint32_t blocks;    /* Number of decoded blocks */
+    uint32_t dc_blocks; /* Number of blocks without AC elements */
+    uint32_t mark;      /* Time stamp of the end of the last counted stage */
+} JPROF;
+#endif
+
+
+
+/* Decoding state at the top of an MCU row (see jd_index) */
+typedef struct {
+    uint32_t ofs;               /* Stream offset of the next byte to read by the input function */
+    uint32_t wreg;              /* Bits read ahead (working shift register, or current byte if JD_FASTDECODE == 0) */
+    uint8_t dbit;               /* Number of bits available in wreg (reading bit mask if JD_FASTDECODE == 0) */
+    uint8_t marker;             /* Detected marker (0:None) */
+    uint16_t row;               /* MCU row */
+    uint16_t rst, rsc;          /* MCUs since the last restart, number of the next restart marker */
+    int16_t dcv[3];             /* Previous DC element of each component */
+} JMARK;
+
+
+
+/* Decompressor object structure */
+typedef struct JDEC JDEC;
+struct JDEC {
+    size_t dctr;                /* Number of bytes available in the input buffer */
+    uint8_t *dptr;              /* Current data read ptr */
+    uint8_t *inbuf;             /* Bit stream input buffer */
+    uint32_t rdofs;             /* Stream offset of the end of data in the input buffer */
+    uint8_t dbit;               /* Number of bits availavble in wreg or reading bit mask */
+    uint8_t scale;              /* Output scaling ratio */
+    uint8_t msx, msy;           /* MCU size in unit of block (width, height) */
+    uint8_t qtid[3];            /* Quantization table ID of each component, Y, Cb, Cr */
+    uint8_t ncomp;              /* Number of color components 1:grayscale, 3:color */
+    int16_t dcv[3];             /* Previous DC element of each component */
+    uint16_t nrst;              /* Restart inverval */
+    uint16_t width, height;     /* Size of the input image (pixel) */
+    uint16_t ostride;           /* Line length of the rectangular passed to the output function (pixel) */
+    uint8_t *huffbits[2][2];    /* Huffman bit distribution tables [id][dcac] */
+    uint16_t *huffcode[2][2];   /* Huffman code word tables [id][dcac] */
+    uint8_t *huffdata[2][2];    /* Huffman decoded data tables [id][dcac] */
+    int32_t *qttbl[4];          /* Dequantizer tables [id] */
+#if JD_FASTDECODE >= 1
+    uint32_t wreg;              /* Working shift register */
+    uint8_t marker;             /* Detected marker (0:None) */
+#if JD_FASTDECODE == 2 || defined(CONFIG_JD_FAST_VARIANT)  /* Same layout for both decoder builds */
+    uint8_t longofs[2][2];      /* Table offset of long code [id][dcac] */
+    uint16_t *hufflut_ac[2];    /* Fast huffman decode tables for AC short code [id] */
+    uint8_t *hufflut_dc[2];     /* Fast huffman decode tables for DC short code [id] */
+#endif
+#endif
+    void *workbuf;              /* Working buffer for IDCT and RGB output */
+    jd_yuv_t *mcubuf;           /* Working buffer for the MCU */
+    void *pool;                 /* Pointer to available memory pool */
+    size_t sz_pool;             /* Size of momory pool (bytes available) */
+    size_t (*infunc)(JDEC *, uint8_t *, size_t); /* Pointer to jpeg stream input function */
+    void (*mcufunc)(JDEC *, const jd_yuv_t *, const JRECT *); /* Pointer to optional Y/C block inspection function (set after jd_prepare) */
+    void *device;               /* Pointer to I/O device identifiler for the session */
+#if JD_PROGRESSIVE
+    uint8_t progressive;        /* Progressive JPEG (SOF2) */
+    uint8_t cid[3];             /* Component ID of each component */
+    uint8_t scomp;              /* Components in the current scan (bit mask, 0:no more scan) */
+    uint8_t stbl[3];            /* Huffman table IDs (DC << 4 | AC) of each component in the current scan */
+    uint8_t ss, se, ah, al;     /* Spectral selection and successive approximation of the current scan */
+    uint8_t htmax;              /* Huffman tables allocated at the maximum size [id][dcac] (bit 2 * id + dcac) */
+    uint16_t nscan;             /* Number of decoded scans */
+    uint16_t eobrun;            /* Remaining blocks of the EOB run */
+    int16_t *coef;              /* Coefficient buffer of the picture (see jd_scan) */
+#endif
+#if JD_PROFILE
+    JPROF prof;                 /* Per-stage counters of the last jd_decomp() */
+#endif
+};
+
+
+
+/* TJpgDec API functions */
+JRESULT jd_prepare (JDEC *jd, size_t (*infunc)(JDEC *, uint8_t *, size_t), void *pool, size_t sz_pool, void *dev);
+JRESULT jd_decomp (JDEC *jd, int (*outfunc)(JDEC *, void *, JRECT *), uint8_t scale);
+JRESULT jd_decomp_rows (JDEC *jd, int (*outfunc)(JDEC *, void *, JRECT *), uint8_t scale, const JMARK *mark, unsigned int top, unsigned int nrow);
+JRESULT jd_index (JDEC *jd, JMARK *mark, unsigned int nmark, unsigned int nrow);    /* mark: ceil(ceil(height / (msy * 8)) / nrow) items */
+JRESULT jd_dcscan (JDEC *jd, uint8_t *dcmap);  /* dcmap: (ceil(width / (msx * 8)) * msx) x (ceil(height / (msy * 8)) * msy) bytes */
+JRESULT jd_poolsize (JDEC *jd, size_t (*infunc)(JDEC *, uint8_t *, size_t), void *dev, size_t *sz_pool);  /* Size of pool jd_prepare() (and jd_scan()) need for the stream */
+#if JD_PROGRESSIVE
+JRESULT jd_scan (JDEC *jd, int16_t *coef);  /* coef: jd_coefsize() bytes, cleared before the first scan */
+size_t jd_coefsize (JDEC *jd);              /* Size of the coefficient buffer of a progressive JPEG (0:baseline JPEG) */
+#endif
+
+#if defined(CONFIG_JD_FAST_VARIANT)
+/* Same API of the additional decoder built with JD_FASTDECODE == 2 (tjpgd_fast.c) */
+JRESULT jd_fast_prepare (JDEC *jd, size_t (*infunc)(JDEC *, uint8_t *, size_t), void *pool, size_t sz_pool, void *dev);
+JRESULT jd_fast_decomp (JDEC *jd, int (*outfunc)(JDEC *, void *, JRECT *), uint8_t scale);
+JRESULT jd_fast_decomp_rows (JDEC *jd, int (*outfunc)(JDEC *, void *, JRECT *), uint8_t scale, const JMARK *mark, unsigned int top, unsigned int nrow);
+JRESULT jd_fast_index (JDEC *jd, JMARK *mark, unsigned int nmark, unsigned int nrow);
+JRESULT jd_fast_dcscan (JDEC *jd, uint8_t *dcmap);
+JRESULT jd_fast_poolsize (JDEC *jd, size_t (*infunc)(JDEC *, uint8_t *, size_t), void *dev, size_t *sz_pool);
+#if JD_PROGRESSIVE
+JRESULT jd_fast_scan (JDEC *jd, int16_t *coef);
+size_t jd_fast_coefsize (JDEC *jd);
+#endif
+#endif
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TJPGDEC */
@@ -0,0 +1,22 @@
+/*----------------------------------------------------------------------------/
+/ TJpgDec - Additional decoder build with table conversion for huffman decoding
+/-----------------------------------------------------------------------------/
+/ Builds tjpgd.c a second time with JD_FASTDECODE == 2. Public functions are
+/ renamed to jd_fast_*() so that both decoders can be linked together and one
+/ of them selected at run time (see esp_jpeg_image_cfg_t::advanced.decoder).
+/ Other options (JD_SZBUF, JD_FORMAT, JD_USE_SCALE, JD_TBLCLIP) are shared.
+/----------------------------------------------------------------------------*/
+
+#define JD_FASTDECODE_VARIANT   2
+
+#define jd_prepare              jd_fast_prepare
+#define jd_decomp               jd_fast_decomp
+#define jd_decomp_rows          jd_fast_decomp_rows
+#define jd_index                jd_fast_index
+#define jd_dcscan               jd_fast_dcscan
+#define jd_poolsize             jd_fast_poolsize
+#define jd_scan                 jd_fast_scan
+#define jd_coefsize             jd_fast_coefsize
+#define jd_load_default_huffman jd_fast_load_default_huffman
+
+#include "tjpgd.c"
@@ -34,15 +34,39 @@
 /  1: Enable
 */
 
+#if defined(JD_FASTDECODE_VARIANT)
+#define JD_FASTDECODE   JD_FASTDECODE_VARIANT   /* Set by the additional decoder build (tjpgd_fast.c) */
+#else
 #define JD_FASTDECODE   CONFIG_JD_FASTDECODE
+#endif
 /* Optimization level
 /  0: Basic optimization. Suitable for 8/16-bit MCUs.
 /  1: + 32-bit barrel shifter. Suitable for 32-bit MCUs.
 /  2: + Table conversion for huffman decoding (wants 6 << HUFF_BIT bytes of RAM)
 */
 
+#if defined(CONFIG_JD_PROFILE)
+#define JD_PROFILE      1
+#else
+#define JD_PROFILE      0
+#endif
+/* Collect per-stage CPU cycle counters in JDEC.prof while decompressing.
+/  0: Disable
+/  1: Enable
+*/
+
 #if defined(CONFIG_JD_DEFAULT_HUFFMAN)
 #define JD_DEFAULT_HUFFMAN CONFIG_JD_DEFAULT_HUFFMAN
 #else
 #define JD_DEFAULT_HUFFMAN 0
 #endif
+
+#if defined(CONFIG_JD_PROGRESSIVE)
+#define JD_PROGRESSIVE  1
+#else
+#define JD_PROGRESSIVE  0
+#endif
+/* Support progressive JPEG (SOF2). All scans are decoded into a coefficient buffer (see jd_scan).
+/  0: Disable
+/  1: Enable
+*/
@@ -0,0 +1,204 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "camera_control.h"
+
+#define TAG "CAMERA_STREAM"
+
+// Steps the frame size and JPEG quality of the camera through CAMERA_LEVELS to hold the stream latency
+// (capture to sent) at a target, so the stream gets the best image the Wi-Fi link can carry.
+// The link is judged once per period on the stream client with the lowest latency: the others are
+// slowed down by their own link, not by the camera's. It is overloaded when its latency is over the
+// target or sending takes most of its frame interval, and has room when both are well below.
+// Hysteresis: one level down after CAMERA_CONTROL_DOWN_PERIODS overloaded periods, one level up
+// after CAMERA_CONTROL_UP_PERIODS periods with room.
+// "/control" sets the policy: ?mode=auto&target_ms=N, or ?mode=manual&level=N (or &quality=N).
+#define CAMERA_DEFAULT_LEVEL         2               // QQVGA q12
+#define CAMERA_CONTROL_TARGET_MS     250
+#define CAMERA_CONTROL_DOWN_PERIODS  2
+#define CAMERA_CONTROL_UP_PERIODS    5
+#define CAMERA_CONTROL_BUSY_PCT      80     // Overloaded if sending takes more than this % of the frame interval
+#define CAMERA_CONTROL_IDLE_PCT      40     // Room if sending takes less than this %, and latency is under half the target
+
+typedef struct {
+    framesize_t frame_size;
+    int quality;                // 4 best - 63 smallest
+    const char *name;
+} camera_level_t;
+
+static const camera_level_t CAMERA_LEVELS[] = {
+    { FRAMESIZE_QQVGA, 30, "QQVGA q30" },
+    { FRAMESIZE_QQVGA, 20, "QQVGA q20" },
+    { FRAMESIZE_QQVGA, 12, "QQVGA q12" },
+    { FRAMESIZE_HQVGA, 15, "HQVGA q15" },
+    { FRAMESIZE_QVGA,  20, "QVGA q20" },
+    { FRAMESIZE_QVGA,  12, "QVGA q12" },
+    { FRAMESIZE_VGA,   15, "VGA q15" },
+    { FRAMESIZE_VGA,   10, "VGA q10" },
+};
+#define CAMERA_LEVEL_COUNT (sizeof(CAMERA_LEVELS) / sizeof(CAMERA_LEVELS[0]))
+
+static struct {
+    portMUX_TYPE lock;
+    bool manual;
+    uint32_t target_latency_us;
+    int level;                  // Index in CAMERA_LEVELS
+    int quality;                // Set quality; CAMERA_LEVELS[level].quality unless set by hand
+    int overloaded;             // Consecutive overloaded periods
+    int room;                   // Consecutive periods with room
+    uint32_t steps_down;
+    uint32_t steps_up;
+    camera_link_t link;         // Last measurement
+    framesize_t applied_frame_size;
+    int applied_quality;
+    framesize_t max_frame_size;     // Frame size the frame buffers were allocated for
+} camera_control = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+    .target_latency_us = CAMERA_CONTROL_TARGET_MS * 1000,
+    .level = CAMERA_DEFAULT_LEVEL,
+    .quality = -1,              // From the level
+    .applied_frame_size = FRAMESIZE_INVALID,
+    .max_frame_size = CAMERA_MAX_FRAMESIZE,
+};
+
+// Highest level the frame buffers can take
+static int camera_control_max_level(void) {
+    int max = 0;
+    for (int i = 0; i < (int)CAMERA_LEVEL_COUNT; i++) {
+        if (CAMERA_LEVELS[i].frame_size <= camera_control.max_frame_size) max = i;
+    }
+    return max;
+}
+
+void camera_control_set_max_frame_size(framesize_t frame_size) {
+    taskENTER_CRITICAL(&camera_control.lock);
+    camera_control.max_frame_size = frame_size;
+    taskEXIT_CRITICAL(&camera_control.lock);
+}
+
+static void camera_control_set_level(int level) {
+    camera_control.level = level;
+    camera_control.quality = -1;
+    camera_control.overloaded = 0;
+    camera_control.room = 0;
+}
+
+void camera_control_set_quality(int quality) {
+    taskENTER_CRITICAL(&camera_control.lock);
+    camera_control.manual = true;
+    camera_control.quality = quality;
+    taskEXIT_CRITICAL(&camera_control.lock);
+}
+
+void camera_control_update(const camera_link_t *link) {
+    taskENTER_CRITICAL(&camera_control.lock);
+    if (link) camera_control.link = *link;
+    if (link && !camera_control.manual) {
+        uint32_t busy_pct = link->interval_us ? link->send_us * 100 / link->interval_us : 0;
+        if (link->latency_us > camera_control.target_latency_us || busy_pct > CAMERA_CONTROL_BUSY_PCT) {
+            camera_control.room = 0;
+            if (++camera_control.overloaded >= CAMERA_CONTROL_DOWN_PERIODS && camera_control.level > 0) {
+                camera_control_set_level(camera_control.level - 1);
+                camera_control.steps_down++;
+            }
+        } else if (link->latency_us < camera_control.target_latency_us / 2 && busy_pct < CAMERA_CONTROL_IDLE_PCT) {
+            camera_control.overloaded = 0;
+            if (++camera_control.room >= CAMERA_CONTROL_UP_PERIODS && camera_control.level < camera_control_max_level()) {
+                camera_control_set_level(camera_control.level + 1);
+                camera_control.steps_up++;
+            }
+        } else {
+            camera_control.overloaded = 0;
+            camera_control.room = 0;
+        }
+    }
+    taskEXIT_CRITICAL(&camera_control.lock);
+}
+
+void camera_control_apply(void) {
+    taskENTER_CRITICAL(&camera_control.lock);
+    framesize_t frame_size = CAMERA_LEVELS[camera_control.level].frame_size;
+    int quality = camera_control.quality >= 0 ? camera_control.quality : CAMERA_LEVELS[camera_control.level].quality;
+    bool changed = frame_size != camera_control.applied_frame_size || quality != camera_control.applied_quality;
+    camera_control.applied_frame_size = frame_size;
+    camera_control.applied_quality = quality;
+    taskEXIT_CRITICAL(&camera_control.lock);
+    if (!changed) return;
+
+    sensor_t *sensor = esp_camera_sensor_get();
+    if (!sensor || sensor->set_framesize(sensor, frame_size) != 0 || sensor->set_quality(sensor, quality) != 0) {
+        ESP_LOGE(TAG, "Camera settings not applied");
+        return;
+    }
+    ESP_LOGI(TAG, "Camera set to frame size %d, quality %d", frame_size, quality);
+}
+
+esp_err_t control_handler(httpd_req_t *req) {
+    char query[64];
+    char value[8];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        int target_ms = -1;
+        int level = -1;
+        int quality = -1;
+        bool manual = false;
+        bool set_mode = false;
+        if (httpd_query_key_value(query, "mode", value, sizeof(value)) == ESP_OK) {
+            set_mode = true;
+            manual = !strcmp(value, "manual");
+            if (!manual && strcmp(value, "auto")) {
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "mode must be auto or manual");
+                return ESP_FAIL;
+            }
+        }
+        if (httpd_query_key_value(query, "target_ms", value, sizeof(value)) == ESP_OK) target_ms = atoi(value);
+        if (httpd_query_key_value(query, "level", value, sizeof(value)) == ESP_OK) level = atoi(value);
+        if (httpd_query_key_value(query, "quality", value, sizeof(value)) == ESP_OK) quality = atoi(value);
+        if ((target_ms != -1 && (target_ms < 20 || target_ms > 10000)) ||
+                (level != -1 && (level < 0 || level > camera_control_max_level())) ||
+                (quality != -1 && (quality < 4 || quality > 63))) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "target_ms, level or quality out of range");
+            return ESP_FAIL;
+        }
+
+        taskENTER_CRITICAL(&camera_control.lock);
+        if (set_mode) {
+            camera_control.manual = manual;
+        } else if (level >= 0 || quality >= 0) {
+            camera_control.manual = true;   // Set by hand
+        }
+        if (target_ms >= 0) camera_control.target_latency_us = target_ms * 1000;
+        if (level >= 0) camera_control_set_level(level);     // In auto mode: the level to start from
+        if (quality >= 0 && camera_control.manual) camera_control.quality = quality;
+        if (!camera_control.manual) camera_control.quality = -1;    // The quality of the level
+        taskEXIT_CRITICAL(&camera_control.lock);
+    }
+
+    // Copied under the lock, formatted after: snprintf is too slow for a critical section
+    taskENTER_CRITICAL(&camera_control.lock);
+    bool manual = camera_control.manual;
+    uint32_t target_latency_us = camera_control.target_latency_us;
+    int level = camera_control.level;
+    int applied_quality = camera_control.applied_quality;
+    camera_link_t link = camera_control.link;
+    uint32_t steps_down = camera_control.steps_down;
+    uint32_t steps_up = camera_control.steps_up;
+    taskEXIT_CRITICAL(&camera_control.lock);
+
+    char buf[384];
+    int len = snprintf(buf, sizeof(buf),
+                       "{\"mode\":\"%s\",\"target_ms\":%" PRIu32 ",\"level\":%d,\"max_level\":%d,\"name\":\"%s\""
+                       ",\"quality\":%d,\"latency_ms\":%.1f,\"send_ms\":%.1f,\"interval_ms\":%.1f,\"kbps\":%" PRIu32
+                       ",\"steps_down\":%" PRIu32 ",\"steps_up\":%" PRIu32 "}",
+                       manual ? "manual" : "auto", target_latency_us / 1000,
+                       level, camera_control_max_level(), CAMERA_LEVELS[level].name,
+                       applied_quality, link.latency_us / 1000.0, link.send_us / 1000.0, link.interval_us / 1000.0,
+                       link.kbps, steps_down, steps_up);
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, len);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_camera.h"
+#include "esp_http_server.h"
+
+#define CAMERA_MAX_FRAMESIZE         FRAMESIZE_QVGA  // Frame buffers are allocated for it, in DRAM
+#define CAMERA_MAX_FRAMESIZE_PSRAM   FRAMESIZE_VGA
+#define CAMERA_CONTROL_PERIOD_US     1000000
+
+// State of the link, measured on a stream client
+typedef struct {
+    uint32_t latency_us;        // Capture to sent
+    uint32_t send_us;           // Time to send a frame
+    uint32_t interval_us;       // Frame interval of the client
+    uint32_t kbps;              // Send throughput
+} camera_link_t;
+
+// Frame size the frame buffers were allocated for; set by camera_init() before the first capture
+void camera_control_set_max_frame_size(framesize_t frame_size);
+
+// Sets the quality by hand, keeping the frame size; the controller stops until mode=auto
+void camera_control_set_quality(int quality);
+
+// One control period, every CAMERA_CONTROL_PERIOD_US; link is NULL without stream clients
+void camera_control_update(const camera_link_t *link);
+
+// Sets the sensor as the controller wants; only called by the task that captures, between frames
+void camera_control_apply(void);
+
+// "/control" sets the policy of the controller and returns its state, as JSON
+esp_err_t control_handler(httpd_req_t *req);
@@ -0,0 +1,125 @@
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "camera_fb.h"
+
+#define TAG "CAMERA_STREAM"
+
+// The camera grabs into CAMERA_FB_COUNT_PSRAM buffers in PSRAM when there is some (2 in DRAM otherwise),
+// in CAMERA_GRAB_LATEST mode: the driver overwrites the oldest buffer instead of waiting for consumers,
+// so camera_fb_acquire() always gets the newest completed frame, at most one frame old. A frame older
+// than CAMERA_FB_MAX_AGE_US anyway (e.g. the sensor stalled) is returned at once for a newer one.
+// Statistics: time waited for a frame, age of the frame when handed over (capture to consume), stale
+// frames returned and overruns, the frames of the sensor that nobody got. The sensor frames are
+// counted on VSYNC: on the ESP32-S3 the driver takes VSYNC through LCD_CAM, the GPIO interrupt of the
+// pin is free. Without it the capture task could only see its own grab rate, not the sensor's.
+#define CAMERA_VSYNC_WINDOW_US       1000000    // Sensor frame period measured over this window
+#define CAMERA_FB_MAX_AGE_US         200000
+#define CAMERA_FB_MAX_RETRIES        2      // Stale frames returned before taking what comes
+
+static struct {
+    portMUX_TYPE lock;
+    uint32_t frames;                // Frames of the sensor (VSYNC), 0 if not counted
+    int64_t window_start_us;        // Current VSYNC window
+    uint32_t window_frames;
+    uint32_t period_us;             // Frame period of the sensor over the last full window
+    uint32_t grabs;                 // Frames handed over
+    uint32_t failed;                // esp_camera_fb_get() failures
+    uint32_t stale;                 // Stale frames returned
+    uint32_t wait_us;               // Smoothed time waited in esp_camera_fb_get()
+    uint32_t max_wait_us;
+    uint32_t age_us;                // Smoothed capture to consume time
+    uint32_t max_age_us;
+} camera_fb_stats = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+};
+
+static void IRAM_ATTR camera_vsync_isr(void *arg) {
+    int64_t now_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL_ISR(&camera_fb_stats.lock);
+    camera_fb_stats.frames++;
+    if (!camera_fb_stats.window_start_us) {
+        camera_fb_stats.window_start_us = now_us;
+    } else {
+        camera_fb_stats.window_frames++;
+        if (now_us - camera_fb_stats.window_start_us >= CAMERA_VSYNC_WINDOW_US) {
+            // Integer only: no FPU in an ISR
+            camera_fb_stats.period_us = (now_us - camera_fb_stats.window_start_us) / camera_fb_stats.window_frames;
+            camera_fb_stats.window_start_us = now_us;
+            camera_fb_stats.window_frames = 0;
+        }
+    }
+    taskEXIT_CRITICAL_ISR(&camera_fb_stats.lock);
+}
+
+void camera_vsync_count_start(gpio_num_t vsync_gpio) {
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err == ESP_OK || err == ESP_ERR_INVALID_STATE) {    // Already installed by another driver
+        gpio_set_intr_type(vsync_gpio, GPIO_INTR_POSEDGE);
+        err = gpio_isr_handler_add(vsync_gpio, camera_vsync_isr, NULL);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Sensor frames not counted: %s", esp_err_to_name(err));
+    }
+}
+
+int64_t camera_fb_timestamp_us(const camera_fb_t *fb) {
+    return fb->timestamp.tv_sec * 1000000LL + fb->timestamp.tv_usec;
+}
+
+camera_fb_t *camera_fb_acquire(void) {
+    for (int attempt = 0; ; attempt++) {
+        int64_t start_us = esp_timer_get_time();
+        camera_fb_t *fb = esp_camera_fb_get();
+        int64_t now_us = esp_timer_get_time();
+        if (!fb) {
+            taskENTER_CRITICAL(&camera_fb_stats.lock);
+            camera_fb_stats.failed++;
+            taskEXIT_CRITICAL(&camera_fb_stats.lock);
+            return NULL;
+        }
+
+        uint32_t wait_us = now_us - start_us;
+        int64_t timestamp_us = camera_fb_timestamp_us(fb);
+        uint32_t age_us = now_us > timestamp_us ? now_us - timestamp_us : 0;
+        if (age_us > CAMERA_FB_MAX_AGE_US && attempt < CAMERA_FB_MAX_RETRIES) {
+            esp_camera_fb_return(fb);
+            taskENTER_CRITICAL(&camera_fb_stats.lock);
+            camera_fb_stats.stale++;
+            taskEXIT_CRITICAL(&camera_fb_stats.lock);
+            continue;
+        }
+
+        taskENTER_CRITICAL(&camera_fb_stats.lock);
+        camera_fb_stats.wait_us = camera_fb_stats.grabs ? (camera_fb_stats.wait_us * 7 + wait_us) / 8 : wait_us;
+        camera_fb_stats.age_us = camera_fb_stats.grabs ? (camera_fb_stats.age_us * 7 + age_us) / 8 : age_us;
+        if (wait_us > camera_fb_stats.max_wait_us) camera_fb_stats.max_wait_us = wait_us;
+        if (age_us > camera_fb_stats.max_age_us) camera_fb_stats.max_age_us = age_us;
+        camera_fb_stats.grabs++;
+        taskEXIT_CRITICAL(&camera_fb_stats.lock);
+        return fb;
+    }
+}
+
+void camera_fb_release(camera_fb_t *fb) {
+    esp_camera_fb_return(fb);
+}
+
+void camera_fb_get_stats(camera_fb_stats_t *stats) {
+    taskENTER_CRITICAL(&camera_fb_stats.lock);
+    *stats = (camera_fb_stats_t) {
+        .frames = camera_fb_stats.frames,
+        .period_us = camera_fb_stats.period_us,
+        .grabs = camera_fb_stats.grabs,
+        .failed = camera_fb_stats.failed,
+        .stale = camera_fb_stats.stale,
+        .wait_us = camera_fb_stats.wait_us,
+        .max_wait_us = camera_fb_stats.max_wait_us,
+        .age_us = camera_fb_stats.age_us,
+        .max_age_us = camera_fb_stats.max_age_us,
+    };
+    taskEXIT_CRITICAL(&camera_fb_stats.lock);
+}
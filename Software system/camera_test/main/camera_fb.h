@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_camera.h"
+#include "driver/gpio.h"
+
+#define CAMERA_FB_COUNT_PSRAM        3
+#define CAMERA_FB_COUNT_DRAM         2
+
+// Statistics of the framebuffer manager
+typedef struct {
+    uint32_t frames;                // Frames of the sensor (VSYNC), 0 if not counted
+    uint32_t period_us;             // Frame period of the sensor over the last full window
+    uint32_t grabs;                 // Frames handed over
+    uint32_t failed;                // esp_camera_fb_get() failures
+    uint32_t stale;                 // Stale frames returned
+    uint32_t wait_us;               // Smoothed time waited in esp_camera_fb_get()
+    uint32_t max_wait_us;
+    uint32_t age_us;                // Smoothed capture to consume time
+    uint32_t max_age_us;
+} camera_fb_stats_t;
+
+// Counts the frames of the sensor on vsync_gpio, once the camera is initialized
+void camera_vsync_count_start(gpio_num_t vsync_gpio);
+
+// Capture time of a frame; esp32-camera stamps frames with esp_timer_get_time()
+int64_t camera_fb_timestamp_us(const camera_fb_t *fb);
+
+// Returns the newest frame of the camera, to give back with camera_fb_release(), or NULL
+camera_fb_t *camera_fb_acquire(void);
+
+void camera_fb_release(camera_fb_t *fb);
+
+void camera_fb_get_stats(camera_fb_stats_t *stats);
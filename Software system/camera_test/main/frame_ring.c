@@ -0,0 +1,152 @@
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "frame_ring.h"
+
+#define TAG "CAMERA_STREAM"
+
+// The last FRAME_RING_SECONDS of frames, recorded all the time by the capture task, so that a capture
+// request uploads the frame of the moment it was received, or a window around it, instead of the
+// next frame to come out of the camera.
+//
+// Frames are stored one after the other in a single arena (in PSRAM when there is some), wrapping
+// around at its end; writing a frame evicts the oldest frames it overlaps. Entries are indexed by
+// sequence number: the entry of seq is entries[seq % FRAME_RING_SLOTS].
+#define FRAME_RING_SLOTS         (FRAME_RING_FPS * FRAME_RING_SECONDS)
+#define FRAME_RING_ARENA_PSRAM   (1024 * 1024)
+#define FRAME_RING_ARENA_DRAM    (48 * 1024)    // Without PSRAM: about one second of QQVGA frames
+
+typedef struct {
+    int64_t timestamp_us;   // Capture time (esp_timer_get_time)
+    size_t offset;          // Offset in the arena
+    size_t len;
+} frame_ring_entry_t;
+
+static struct {
+    SemaphoreHandle_t lock;
+    uint8_t *arena;
+    size_t arena_size;
+    size_t head;                                // Arena offset for the next frame
+    uint32_t first;                             // Oldest frame, valid if first != next
+    uint32_t next;                              // Sequence number of the next frame
+    frame_ring_entry_t entries[FRAME_RING_SLOTS];
+} frame_ring;
+
+void frame_ring_init(void) {
+    frame_ring.lock = xSemaphoreCreateMutex();
+    frame_ring.arena_size = FRAME_RING_ARENA_PSRAM;
+    frame_ring.arena = heap_caps_malloc(frame_ring.arena_size, MALLOC_CAP_SPIRAM);
+    if (!frame_ring.arena) {
+        frame_ring.arena_size = FRAME_RING_ARENA_DRAM;
+        frame_ring.arena = heap_caps_malloc(frame_ring.arena_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (!frame_ring.arena) {
+        ESP_LOGE(TAG, "No memory for the frame ring, capture requests wait for the next frame");
+        frame_ring.arena_size = 0;
+        return;
+    }
+    ESP_LOGI(TAG, "Frame ring: %u KB", (unsigned)(frame_ring.arena_size / 1024));
+}
+
+// Drops the oldest frames while they overlap [start, end) of the arena
+static void frame_ring_evict(size_t start, size_t end) {
+    while (frame_ring.first != frame_ring.next) {
+        const frame_ring_entry_t *oldest = &frame_ring.entries[frame_ring.first % FRAME_RING_SLOTS];
+        if (oldest->offset >= end || oldest->offset + oldest->len <= start) break;
+        frame_ring.first++;
+    }
+}
+
+void frame_ring_push(const camera_fb_t *fb, int64_t timestamp_us) {
+    size_t len = fb->len;
+    if (len > frame_ring.arena_size) return;
+
+    xSemaphoreTake(frame_ring.lock, portMAX_DELAY);
+    if (frame_ring.next - frame_ring.first == FRAME_RING_SLOTS) {
+        frame_ring.first++;
+    }
+    size_t offset = (frame_ring.head + 3) & ~(size_t)3;
+    if (offset + len > frame_ring.arena_size) {
+        // Wrap around: the frames up to the end of the arena are the oldest ones
+        frame_ring_evict(offset, frame_ring.arena_size);
+        offset = 0;
+    }
+    frame_ring_evict(offset, offset + len);
+
+    frame_ring.entries[frame_ring.next % FRAME_RING_SLOTS] = (frame_ring_entry_t) {
+        .timestamp_us = timestamp_us,
+        .offset = offset,
+        .len = len,
+    };
+    memcpy(frame_ring.arena + offset, fb->buf, len);
+    frame_ring.head = offset + len;
+    frame_ring.next++;
+    xSemaphoreGive(frame_ring.lock);
+}
+
+uint32_t frame_ring_find(int64_t from_us, int64_t to_us, uint32_t *first, size_t *bytes) {
+    uint32_t count = 0;
+    size_t total = 0;
+
+    xSemaphoreTake(frame_ring.lock, portMAX_DELAY);
+    for (uint32_t seq = frame_ring.first; seq != frame_ring.next; seq++) {
+        const frame_ring_entry_t *entry = &frame_ring.entries[seq % FRAME_RING_SLOTS];
+        if (entry->timestamp_us > to_us) break;
+        if (entry->timestamp_us < from_us) continue;
+        if (count++ == 0) *first = seq;
+        total += entry->len;
+    }
+    if (bytes) *bytes = total;
+    xSemaphoreGive(frame_ring.lock);
+    return count;
+}
+
+int64_t frame_ring_span_us(int64_t now_us) {
+    int64_t span_us = 0;
+
+    xSemaphoreTake(frame_ring.lock, portMAX_DELAY);
+    if (frame_ring.first != frame_ring.next) {
+        span_us = now_us - frame_ring.entries[frame_ring.first % FRAME_RING_SLOTS].timestamp_us;
+    }
+    xSemaphoreGive(frame_ring.lock);
+    return span_us > 0 ? span_us : 0;
+}
+
+bool frame_ring_closest(int64_t timestamp_us, uint32_t *closest) {
+    int64_t best_us = INT64_MAX;
+
+    xSemaphoreTake(frame_ring.lock, portMAX_DELAY);
+    for (uint32_t seq = frame_ring.first; seq != frame_ring.next; seq++) {
+        int64_t diff_us = llabs(frame_ring.entries[seq % FRAME_RING_SLOTS].timestamp_us - timestamp_us);
+        if (diff_us < best_us) {
+            best_us = diff_us;
+            *closest = seq;
+        }
+    }
+    xSemaphoreGive(frame_ring.lock);
+    return best_us != INT64_MAX;
+}
+
+esp_err_t frame_ring_copy(uint32_t seq, uint8_t **copy, size_t *len, int64_t *timestamp_us) {
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+
+    *copy = NULL;
+    xSemaphoreTake(frame_ring.lock, portMAX_DELAY);
+    if (seq - frame_ring.first < frame_ring.next - frame_ring.first) {
+        const frame_ring_entry_t *entry = &frame_ring.entries[seq % FRAME_RING_SLOTS];
+        *copy = malloc(entry->len);
+        if (*copy) {
+            memcpy(*copy, frame_ring.arena + entry->offset, entry->len);
+            *len = entry->len;
+            *timestamp_us = entry->timestamp_us;
+            err = ESP_OK;
+        } else {
+            err = ESP_ERR_NO_MEM;
+        }
+    }
+    xSemaphoreGive(frame_ring.lock);
+    return err;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_camera.h"
+
+#define FRAME_RING_FPS           10     // Frames recorded per second
+#define FRAME_RING_SECONDS       3
+#define FRAME_RING_INTERVAL_US   (1000000 / FRAME_RING_FPS)
+
+void frame_ring_init(void);
+
+// Records the frame captured at timestamp_us, evicting the oldest frames it needs the room of
+void frame_ring_push(const camera_fb_t *fb, int64_t timestamp_us);
+
+// Returns the number of frames captured in [from_us, to_us], the first of them in *first and their
+// total size in *bytes (may be NULL)
+uint32_t frame_ring_find(int64_t from_us, int64_t to_us, uint32_t *first, size_t *bytes);
+
+// Returns the time the ring covers up to now_us: the age of its oldest frame, 0 if it is empty.
+// Less than FRAME_RING_SECONDS when the arena fills up first (large frames, no PSRAM).
+int64_t frame_ring_span_us(int64_t now_us);
+
+// Finds the frame captured closest to timestamp_us, returns false if the ring is empty
+bool frame_ring_closest(int64_t timestamp_us, uint32_t *closest);
+
+// Makes a malloc'ed copy of frame seq in *copy.
+// Returns ESP_ERR_NOT_FOUND if the frame was evicted, ESP_ERR_NO_MEM if out of memory.
+esp_err_t frame_ring_copy(uint32_t seq, uint8_t **copy, size_t *len, int64_t *timestamp_us);
@@ -1,12 +1,20 @@
 #include "esp_camera.h"
 #include "esp_log.h"
 #include "esp_http_server.h"
-#include "esp_http_client.h"
 #include "esp_wifi.h"
 #include "nvs_flash.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/gpio.h"
+#include "esp_heap_caps.h"
+#include "camera_fb.h"
+#include "camera_control.h"
+#include "frame_ring.h"
+#include "stream_hub.h"
+#include "mjpeg_stream.h"
+#include "tcp_stream.h"
+#include "ws_stream.h"
+#include "upload_queue.h"
 
 #define TAG "CAMERA_STREAM"
 
@@ -35,79 +43,6 @@
 #define HREF_GPIO_NUM    47
 #define PCLK_GPIO_NUM    13
 
-// ==== MJPEG Stream Handler ====
-esp_err_t stream_handler(httpd_req_t *req) {
-    camera_fb_t *fb = NULL;
-    esp_err_t res = ESP_OK;
-    const char *part_header = "Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
-
-    res = httpd_resp_set_type(req, "multipart/x-mixed-replace; boundary=frame");
-    if (res != ESP_OK) return res;
-
-    while (true) {
-        fb = esp_camera_fb_get();
-        if (!fb) {
-            ESP_LOGE(TAG, "Camera capture failed");
-            continue;
-        }
-
-        res = httpd_resp_send_chunk(req, "--frame\r\n", strlen("--frame\r\n"));
-        if (res == ESP_OK) {
-            char header[100];
-            int header_len = snprintf(header, sizeof(header), part_header, fb->len);
-            res = httpd_resp_send_chunk(req, header, header_len);
-        }
-
-        if (res == ESP_OK) {
-            res = httpd_resp_send_chunk(req, (const char *)fb->buf, fb->len);
-        }
-
-        if (res == ESP_OK) {
-            res = httpd_resp_send_chunk(req, "\r\n", 2);
-        }
-
-        esp_camera_fb_return(fb);
-
-        if (res != ESP_OK) break;
-        vTaskDelay(pdMS_TO_TICKS(50));  // ~20 FPS
-    }
-
-    return res;
-}
-
-// ==== Photo Capture + Upload Handler ====
-esp_err_t capture_handler(httpd_req_t *req) {
-    camera_fb_t *fb = esp_camera_fb_get();
-    if (!fb) {
-        ESP_LOGE(TAG, "Camera capture failed");
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
-    }
-
-    // HTTP POST config to backend
-    esp_http_client_config_t config = {
-        .url = "http://192.168.1.13:3000/upload",
-        .method = HTTP_METHOD_POST,
-    };
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-
-    esp_http_client_set_header(client, "Content-Type", "image/jpeg");
-    esp_http_client_set_post_field(client, (const char *)fb->buf, fb->len);
-
-    esp_err_t err = esp_http_client_perform(client);
-    if (err == ESP_OK) {
-        ESP_LOGI(TAG, "Image sent to server. Status = %d", esp_http_client_get_status_code(client));
-        httpd_resp_sendstr(req, "Image captured and sent");
-    } else {
-        ESP_LOGE(TAG, "Failed to send image to server: %s", esp_err_to_name(err));
-        httpd_resp_send_500(req);
-    }
-
-    esp_http_client_cleanup(client);
-    esp_camera_fb_return(fb);
-    return ESP_OK;
-}
-
 // ==== HTTP Server Setup ====
 httpd_handle_t start_webserver(void) {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
@@ -130,6 +65,47 @@ httpd_handle_t start_webserver(void) {
             .user_ctx  = NULL
         };
         httpd_register_uri_handler(server, &capture_uri);
+
+        httpd_uri_t stream_stats_uri = {
+            .uri       = "/stream-stats",
+            .method    = HTTP_GET,
+            .handler   = stream_stats_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(server, &stream_stats_uri);
+
+        httpd_uri_t upload_stats_uri = {
+            .uri       = "/upload-stats",
+            .method    = HTTP_GET,
+            .handler   = upload_stats_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(server, &upload_stats_uri);
+
+        httpd_uri_t ws_uri = {
+            .uri          = "/ws",
+            .method       = HTTP_GET,
+            .handler      = ws_stream_handler,
+            .user_ctx     = NULL,
+            .is_websocket = true
+        };
+        httpd_register_uri_handler(server, &ws_uri);
+
+        httpd_uri_t control_uri = {
+            .uri       = "/control",
+            .method    = HTTP_GET,
+            .handler   = control_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(server, &control_uri);
+
+        httpd_uri_t tcp_stream_uri = {
+            .uri       = "/tcp-stream",
+            .method    = HTTP_GET,
+            .handler   = tcp_stream_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(server, &tcp_stream_uri);
     }
 
     return server;
@@ -184,18 +160,27 @@ void camera_init() {
         .ledc_timer   = LEDC_TIMER_0,
         .ledc_channel = LEDC_CHANNEL_0,
         .pixel_format = PIXFORMAT_JPEG,
-        .frame_size   = FRAMESIZE_QQVGA,
+        .frame_size   = CAMERA_MAX_FRAMESIZE,   // Set to the level of the camera control before the first capture
         .jpeg_quality = 12,
-        .fb_count     = 2,
-        .fb_location  = CAMERA_FB_IN_DRAM
+        .fb_count     = CAMERA_FB_COUNT_DRAM,
+        .fb_location  = CAMERA_FB_IN_DRAM,
+        .grab_mode    = CAMERA_GRAB_LATEST
     };
+    if (heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0) {
+        config.frame_size = CAMERA_MAX_FRAMESIZE_PSRAM;
+        config.fb_count = CAMERA_FB_COUNT_PSRAM;
+        config.fb_location = CAMERA_FB_IN_PSRAM;
+    }
 
     esp_err_t err = esp_camera_init(&config);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Camera init failed: %s", esp_err_to_name(err));
         return;
     }
-    ESP_LOGI(TAG, "Camera initialized");
+    camera_control_set_max_frame_size(config.frame_size);
+    camera_vsync_count_start(VSYNC_GPIO_NUM);
+    ESP_LOGI(TAG, "Camera initialized: %u frame buffers in %s", (unsigned)config.fb_count,
+             config.fb_location == CAMERA_FB_IN_PSRAM ? "PSRAM" : "DRAM");
 }
 
 // ==== Main App ====
@@ -204,6 +189,9 @@ void app_main() {
     wifi_init_sta();
 
     camera_init();
+    frame_ring_init();
+    stream_hub_start();
+    upload_queue_start();
     start_webserver();
     ESP_LOGI(TAG, "HTTP MJPEG Stream available at http://<ESP_IP>/stream");
 
@@ -0,0 +1,81 @@
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "stream_hub.h"
+#include "mjpeg_stream.h"
+
+#define TAG "CAMERA_STREAM"
+
+// Every /stream client is a stream hub client with its own sender task. Frames are the multipart parts
+// built by the hub, each sent with a single raw write; the response is not chunked, it ends when the
+// connection is closed.
+
+// Sends buf on the socket of the request as is, without chunked encoding
+static esp_err_t stream_send_raw(httpd_req_t *req, const void *buf, size_t len) {
+    const char *p = buf;
+
+    while (len > 0) {
+        int sent = httpd_send(req, p, len);
+        if (sent <= 0) return ESP_FAIL;
+        p += sent;
+        len -= sent;
+    }
+    return ESP_OK;
+}
+
+static bool stream_send_part(void *ctx, const stream_frame_t *frame) {
+    return stream_send_raw(ctx, frame->part, frame->part_len) == ESP_OK;
+}
+
+static void stream_sender_task(void *arg) {
+    httpd_req_t *req = arg;
+
+    // "/stream?fps=5" asks for 5 frames per second
+    char query[32];
+    char fps_str[8];
+    int fps = STREAM_DEFAULT_FPS;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+            httpd_query_key_value(query, "fps", fps_str, sizeof(fps_str)) == ESP_OK) {
+        fps = atoi(fps_str);
+        fps = fps < 1 ? 1 : fps > STREAM_MAX_FPS ? STREAM_MAX_FPS : fps;
+    }
+
+    int slot = stream_hub_subscribe(xTaskGetCurrentTaskHandle(), 1000000 / fps);
+    if (slot < 0) {
+        ESP_LOGW(TAG, "Too many stream clients");
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_sendstr(req, "Too many stream clients");
+        httpd_req_async_handler_complete(req);
+        vTaskDelete(NULL);
+    }
+
+    const char *resp_header = "HTTP/1.1 200 OK\r\n"
+                              "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n"
+                              "Cache-Control: no-cache\r\n"
+                              "Connection: close\r\n\r\n";
+    if (stream_send_raw(req, resp_header, strlen(resp_header)) == ESP_OK) {
+        stream_client_run(slot, stream_send_part, req);
+    } else {
+        stream_hub_unsubscribe(slot);
+    }
+
+    // The response has no length, the connection cannot be reused
+    httpd_sess_trigger_close(req->handle, httpd_req_to_sockfd(req));
+    httpd_req_async_handler_complete(req);
+    vTaskDelete(NULL);
+}
+
+// Hands the request over to a sender task and returns, the httpd worker is free for other requests.
+esp_err_t stream_handler(httpd_req_t *req) {
+    httpd_req_t *async_req = NULL;
+
+    esp_err_t res = httpd_req_async_handler_begin(req, &async_req);
+    if (res != ESP_OK) return res;
+
+    if (xTaskCreate(stream_sender_task, "stream_sender", STREAM_TASK_STACK, async_req, STREAM_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Cannot start stream sender task");
+        httpd_req_async_handler_complete(async_req);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "esp_http_server.h"
+
+// "/stream[?fps=N]" streams the camera as multipart/x-mixed-replace JPEG frames
+esp_err_t stream_handler(httpd_req_t *req);
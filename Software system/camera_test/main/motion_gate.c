@@ -0,0 +1,94 @@
+#include <stdlib.h>
+#include <string.h>
+#include "motion_gate.h"
+
+// A frame is new when enough of its 8x8 blocks changed in mean luma
+#define MOTION_BLOCK_THRESHOLD   8      // Mean luma change for an 8x8 block to count as changed
+#define MOTION_MIN_CHANGED       2      // Changed blocks needed to treat the frame as new
+
+#if CONFIG_JD_FAST_VARIANT
+#define MOTION_GATE_DECODER JPEG_DECODER_FAST
+#else
+#define MOTION_GATE_DECODER JPEG_DECODER_DEFAULT
+#endif
+
+void motion_gate_free(motion_gate_t *gate) {
+    free(gate->ref.blocks);
+    free(gate->cur.blocks);
+    free(gate->working_buffer);
+    memset(gate, 0, sizeof(*gate));
+}
+
+// Sizes the working buffer for the frame of jpeg_cfg.
+// It only grows: the size depends on the tables and subsampling of the camera, which hardly change.
+static esp_err_t motion_gate_size_working_buffer(motion_gate_t *gate, esp_jpeg_image_cfg_t *jpeg_cfg) {
+    size_t size;
+    esp_err_t err = esp_jpeg_get_work_buffer_size(jpeg_cfg, &size);
+    if (err != ESP_OK) return err;
+
+    if (size > gate->working_buffer_size) {
+        free(gate->working_buffer);
+        gate->working_buffer = malloc(size);
+        gate->working_buffer_size = gate->working_buffer ? size : 0;
+        if (!gate->working_buffer) return ESP_ERR_NO_MEM;
+    }
+    jpeg_cfg->advanced.working_buffer = gate->working_buffer;
+    jpeg_cfg->advanced.working_buffer_size = gate->working_buffer_size;
+    return ESP_OK;
+}
+
+bool motion_gate_check(motion_gate_t *gate, const camera_fb_t *fb) {
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = fb->buf,
+        .indata_size = fb->len,
+        .advanced = {
+            .working_buffer = gate->working_buffer,
+            .working_buffer_size = gate->working_buffer_size,
+            .decoder = MOTION_GATE_DECODER,    // Not AUTO: no second prepare when the buffer is too small
+        },
+    };
+
+    // No allocation per frame: the decoder works in the buffer of the gate, sized on the first frame
+    if (!gate->working_buffer && motion_gate_size_working_buffer(gate, &jpeg_cfg) != ESP_OK) {
+        return true;    // No signature (e.g. ROM decoder in use), never gate
+    }
+    esp_err_t err = esp_jpeg_get_dc_signature(&jpeg_cfg, &gate->cur);
+    if (err == ESP_FAIL) {
+        // The working buffer may be too small for this frame: grow it and try once more
+        size_t size = gate->working_buffer_size;
+        if (motion_gate_size_working_buffer(gate, &jpeg_cfg) == ESP_OK && gate->working_buffer_size > size) {
+            err = esp_jpeg_get_dc_signature(&jpeg_cfg, &gate->cur);
+        }
+    }
+    if (err == ESP_ERR_INVALID_SIZE || (err == ESP_OK && !gate->cur.blocks)) {
+        // First frame or bigger frame size: (re)allocate both signatures
+        size_t size = gate->cur.blocks_w * gate->cur.blocks_h;
+        free(gate->ref.blocks);
+        free(gate->cur.blocks);
+        gate->ref.blocks = malloc(size);
+        gate->cur.blocks = malloc(size);
+        if (!gate->ref.blocks || !gate->cur.blocks) {
+            motion_gate_free(gate);
+            return true;
+        }
+        gate->ref.blocks_size = gate->cur.blocks_size = size;
+        gate->valid = false;
+        err = esp_jpeg_get_dc_signature(&jpeg_cfg, &gate->cur);
+    }
+    if (err != ESP_OK) {
+        return true;    // No signature (e.g. ROM decoder in use), never gate
+    }
+
+    esp_jpeg_motion_t motion;
+    if (gate->valid &&
+            esp_jpeg_compare_dc_signature(&gate->ref, &gate->cur, MOTION_BLOCK_THRESHOLD, NULL, &motion) == ESP_OK &&
+            motion.changed_blocks < MOTION_MIN_CHANGED) {
+        return false;
+    }
+
+    esp_jpeg_dc_signature_t tmp = gate->ref;
+    gate->ref = gate->cur;
+    gate->cur = tmp;
+    gate->valid = true;
+    return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_camera.h"
+#include "jpeg_decoder.h"
+
+// Motion gating: compares the luma DC signature of consecutive JPEG frames.
+// A zeroed motion_gate_t is ready to use; motion_gate_free() releases its buffers.
+typedef struct {
+    esp_jpeg_dc_signature_t ref;    // Signature of the last accepted frame
+    esp_jpeg_dc_signature_t cur;    // Scratch signature of the current frame
+    bool valid;                     // ref holds a signature
+    void *working_buffer;           // Decoder working buffer, kept across frames
+    size_t working_buffer_size;
+} motion_gate_t;
+
+void motion_gate_free(motion_gate_t *gate);
+
+// Returns true if the frame differs from the last accepted one, or if that cannot be told.
+// An accepted frame becomes the new reference.
+bool motion_gate_check(motion_gate_t *gate, const camera_fb_t *fb);
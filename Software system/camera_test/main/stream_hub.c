@@ -0,0 +1,412 @@
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "camera_fb.h"
+#include "camera_control.h"
+#include "frame_ring.h"
+#include "motion_gate.h"
+#include "stream_hub.h"
+
+#define TAG "CAMERA_STREAM"
+
+// ==== Stream Hub ====
+// One capture task grabs each frame once and publishes it as a reference-counted frame.
+// Every stream client (/stream, /ws, the TCP sender) has its own sender task that sends the latest frame it has not sent yet,
+// so a slow client skips frames instead of slowing down the others, and no httpd worker is tied up.
+//
+// Frames are paced by deadlines in microseconds rather than a fixed delay after each frame, so the
+// time spent capturing and sending is not added to the frame interval (ticks are 10 ms with
+// CONFIG_FREERTOS_HZ=100, the rounding of one frame is caught up by the next one).
+// Each client asks for a frame rate (/stream?fps=N), and is slowed down to the rate its link
+// can take, measured by the time to send a frame. The camera runs at the rate of the fastest client,
+// and at least at FRAME_RING_FPS to keep the frame ring filled.
+//
+// A frame is sent as one multipart part: the boundary and part headers are written in front of the
+// JPEG copy and the trailing CRLF after it, and the part is sent with a single raw write instead of
+// four chunked-encoding records. The response is not chunked, it ends when the connection is closed.
+#define STREAM_SEND_BACKOFF_PCT   125   // Frame interval of a client is at least this % of its send time
+#define STREAM_FPS_WINDOW_US      1000000
+#define STREAM_KEEPALIVE_MS       1000  // Send a frame at least this often even if nothing changed
+
+typedef struct {
+    int64_t window_start_us;
+    uint32_t window_frames;
+    float fps;          // Frames per second over the last full window
+} fps_meter_t;
+
+typedef struct {
+    TaskHandle_t task;      // Sender task, NULL for a free slot
+    uint32_t interval_us;   // Requested frame interval
+    uint32_t send_us;       // Smoothed time to send one frame
+    uint32_t latency_us;    // Smoothed time from capture to sent
+    uint32_t kbps;          // Smoothed send throughput
+    uint32_t sent;          // Frames sent
+    uint32_t dropped;       // Published frames skipped because the client was not ready for them
+    fps_meter_t fps;
+} stream_client_t;
+
+static struct {
+    portMUX_TYPE lock;
+    stream_frame_t *latest;                     // Last published frame, NULL if none
+    TaskHandle_t capture_task;
+    stream_client_t clients[STREAM_MAX_CLIENTS];
+    uint32_t interval_us;                       // Current capture interval
+    uint32_t captured;                          // Frames taken from the camera
+    uint32_t published;                         // Frames published to the clients (changed or keepalive)
+    uint32_t capture_failed;                    // Failed captures
+    uint32_t no_mem;                            // Frames dropped for lack of memory
+    fps_meter_t capture_fps;
+} stream_hub = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+};
+
+static void fps_meter_tick(fps_meter_t *meter, int64_t now_us) {
+    if (!meter->window_start_us) {
+        meter->window_start_us = now_us;
+        return;
+    }
+    meter->window_frames++;
+    if (now_us - meter->window_start_us >= STREAM_FPS_WINDOW_US) {
+        meter->fps = meter->window_frames * 1e6f / (now_us - meter->window_start_us);
+        meter->window_start_us = now_us;
+        meter->window_frames = 0;
+    }
+}
+
+void stream_sleep_until(int64_t deadline_us) {
+    int64_t wait_us = deadline_us - esp_timer_get_time();
+    if (wait_us > 0) {
+        const int64_t tick_us = portTICK_PERIOD_MS * 1000LL;
+        vTaskDelay((wait_us + tick_us - 1) / tick_us);
+    }
+}
+
+// Copies the camera frame into a multipart part ready to be sent, NULL if out of memory
+static stream_frame_t *stream_frame_new(const camera_fb_t *fb, uint32_t seq, int64_t timestamp_us) {
+    stream_frame_t *frame = malloc(sizeof(stream_frame_t) + STREAM_PART_HEADROOM + fb->len + 2);
+    if (!frame) return NULL;
+
+    char header[STREAM_PART_HEADROOM];
+    int header_len = snprintf(header, sizeof(header),
+                              "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n", (unsigned)fb->len);
+    uint8_t *jpeg = frame->buf + STREAM_PART_HEADROOM;
+
+    frame->seq = seq;
+    frame->flags = 0;
+    frame->timestamp_us = timestamp_us;
+    frame->len = fb->len;
+    frame->part = jpeg - header_len;
+    frame->part_len = header_len + fb->len + 2;
+    memcpy(frame->part, header, header_len);
+    memcpy(jpeg, fb->buf, fb->len);
+    memcpy(jpeg + fb->len, "\r\n", 2);
+    return frame;
+}
+
+static void stream_frame_release(stream_frame_t *frame) {
+    if (!frame) return;
+
+    taskENTER_CRITICAL(&stream_hub.lock);
+    bool unused = --frame->refs == 0;
+    taskEXIT_CRITICAL(&stream_hub.lock);
+    if (unused) free(frame);
+}
+
+// Returns the latest frame if it is not last_seq, with a reference to release, or NULL.
+static stream_frame_t *stream_hub_get(uint32_t last_seq) {
+    stream_frame_t *frame = NULL;
+
+    taskENTER_CRITICAL(&stream_hub.lock);
+    if (stream_hub.latest && stream_hub.latest->seq != last_seq) {
+        frame = stream_hub.latest;
+        frame->refs++;
+    }
+    taskEXIT_CRITICAL(&stream_hub.lock);
+    return frame;
+}
+
+static void stream_hub_publish(stream_frame_t *frame) {
+    TaskHandle_t tasks[STREAM_MAX_CLIENTS];
+
+    frame->refs = 1;
+    taskENTER_CRITICAL(&stream_hub.lock);
+    stream_frame_t *old = stream_hub.latest;
+    stream_hub.latest = frame;
+    stream_hub.published++;
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        tasks[i] = stream_hub.clients[i].task;
+    }
+    taskEXIT_CRITICAL(&stream_hub.lock);
+
+    stream_frame_release(old);
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        if (tasks[i]) xTaskNotifyGive(tasks[i]);
+    }
+}
+
+int stream_hub_subscribe(TaskHandle_t task, uint32_t interval_us) {
+    int slot = -1;
+    bool first = true;
+
+    taskENTER_CRITICAL(&stream_hub.lock);
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        if (stream_hub.clients[i].task) {
+            first = false;
+        } else if (slot < 0) {
+            slot = i;
+        }
+    }
+    if (slot >= 0) {
+        stream_hub.clients[slot] = (stream_client_t) {
+            .task = task,
+            .interval_us = interval_us,
+        };
+    }
+    taskEXIT_CRITICAL(&stream_hub.lock);
+
+    if (slot >= 0 && first) {
+        ESP_LOGI(TAG, "Streaming started");
+    }
+    return slot;
+}
+
+void stream_hub_unsubscribe(int slot) {
+    stream_frame_t *old = NULL;
+    bool last = true;
+
+    taskENTER_CRITICAL(&stream_hub.lock);
+    stream_hub.clients[slot].task = NULL;
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        if (stream_hub.clients[i].task) last = false;
+    }
+    if (last) {
+        // The next client must not start with a stale frame
+        old = stream_hub.latest;
+        stream_hub.latest = NULL;
+    }
+    taskEXIT_CRITICAL(&stream_hub.lock);
+    stream_frame_release(old);
+}
+
+static void stream_hub_sent(int slot, const stream_frame_t *frame, uint32_t dropped, uint32_t send_us, int64_t now_us) {
+    uint32_t latency_us = now_us - frame->timestamp_us;
+    uint32_t kbps = send_us ? (uint64_t)frame->len * 8000 / send_us : 0;
+
+    taskENTER_CRITICAL(&stream_hub.lock);
+    stream_client_t *client = &stream_hub.clients[slot];
+    client->send_us = client->sent ? (client->send_us * 7 + send_us) / 8 : send_us;
+    client->latency_us = client->sent ? (client->latency_us * 7 + latency_us) / 8 : latency_us;
+    client->kbps = client->sent ? (client->kbps * 7 + kbps) / 8 : kbps;
+    client->sent++;
+    client->dropped += dropped;
+    fps_meter_tick(&client->fps, now_us);
+    taskEXIT_CRITICAL(&stream_hub.lock);
+}
+
+void stream_hub_set_interval(int slot, uint32_t interval_us) {
+    taskENTER_CRITICAL(&stream_hub.lock);
+    stream_hub.clients[slot].interval_us = interval_us;
+    taskEXIT_CRITICAL(&stream_hub.lock);
+}
+
+// Frame interval of a client: the requested one, or longer if its link cannot take it
+static uint32_t stream_client_interval_us(const stream_client_t *client) {
+    uint32_t backoff_us = client->send_us * STREAM_SEND_BACKOFF_PCT / 100;
+    return backoff_us > client->interval_us ? backoff_us : client->interval_us;
+}
+
+// Link of the client with the lowest latency that has sent frames, false if there is none
+static bool stream_hub_best_link(camera_link_t *link) {
+    bool found = false;
+
+    taskENTER_CRITICAL(&stream_hub.lock);
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        const stream_client_t *client = &stream_hub.clients[i];
+        if (client->task && client->sent && (!found || client->latency_us < link->latency_us)) {
+            *link = (camera_link_t) {
+                .latency_us = client->latency_us,
+                .send_us = client->send_us,
+                .interval_us = stream_client_interval_us(client),
+                .kbps = client->kbps,
+            };
+            found = true;
+        }
+    }
+    taskEXIT_CRITICAL(&stream_hub.lock);
+    return found;
+}
+
+// Capture interval: the one of the fastest client, 0 if there is no client
+static uint32_t stream_hub_interval_us(void) {
+    uint32_t interval_us = UINT32_MAX;
+
+    taskENTER_CRITICAL(&stream_hub.lock);
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        if (stream_hub.clients[i].task) {
+            uint32_t client_us = stream_client_interval_us(&stream_hub.clients[i]);
+            if (client_us < interval_us) interval_us = client_us;
+        }
+    }
+    if (interval_us == UINT32_MAX) interval_us = 0;
+    stream_hub.interval_us = interval_us;
+    taskEXIT_CRITICAL(&stream_hub.lock);
+    return interval_us;
+}
+
+static void stream_capture_task(void *arg) {
+    motion_gate_t gate = {0};
+    int64_t last_published_us = 0;
+    int64_t last_recorded_us = 0;
+    int64_t next_capture_us = 0;
+    int64_t next_control_us = 0;
+    uint32_t seq = 0;
+
+    while (true) {
+        uint32_t stream_interval_us = stream_hub_interval_us();
+        uint32_t interval_us = stream_interval_us && stream_interval_us < FRAME_RING_INTERVAL_US ?
+                               stream_interval_us : FRAME_RING_INTERVAL_US;
+        if (!stream_interval_us) {
+            motion_gate_free(&gate);    // The next client starts from scratch
+        }
+
+        stream_sleep_until(next_capture_us);
+        // One interval after the previous deadline, but do not catch up more than one frame
+        int64_t now_us = esp_timer_get_time();
+        next_capture_us = (next_capture_us > now_us - interval_us ? next_capture_us : now_us) + interval_us;
+
+        if (now_us >= next_control_us) {
+            camera_link_t link;
+            camera_control_update(stream_hub_best_link(&link) ? &link : NULL);
+            next_control_us = now_us + CAMERA_CONTROL_PERIOD_US;
+        }
+        camera_control_apply();
+
+        camera_fb_t *fb = camera_fb_acquire();
+        if (!fb) {
+            ESP_LOGE(TAG, "Camera capture failed");
+            taskENTER_CRITICAL(&stream_hub.lock);
+            stream_hub.capture_failed++;
+            taskEXIT_CRITICAL(&stream_hub.lock);
+            continue;
+        }
+
+        now_us = esp_timer_get_time();
+        int64_t captured_us = camera_fb_timestamp_us(fb);
+        taskENTER_CRITICAL(&stream_hub.lock);
+        stream_hub.captured++;
+        fps_meter_tick(&stream_hub.capture_fps, now_us);
+        taskEXIT_CRITICAL(&stream_hub.lock);
+
+        // Every frame at FRAME_RING_FPS; deadlines are rounded to ticks, allow some jitter
+        if (now_us - last_recorded_us >= FRAME_RING_INTERVAL_US * 3 / 4) {
+            frame_ring_push(fb, captured_us);
+            last_recorded_us = now_us;
+        }
+
+        // Skip unchanged frames, but keep the streams alive
+        bool changed = stream_interval_us && motion_gate_check(&gate, fb);
+        if (stream_interval_us && (changed || now_us - last_published_us >= STREAM_KEEPALIVE_MS * 1000LL)) {
+            stream_frame_t *frame = stream_frame_new(fb, seq + 1, captured_us);
+            if (frame) {
+                seq++;
+                if (!changed) frame->flags |= STREAM_FRAME_UNCHANGED;
+                stream_hub_publish(frame);
+                last_published_us = now_us;
+            } else {
+                ESP_LOGW(TAG, "No memory for stream frame, dropped");
+                taskENTER_CRITICAL(&stream_hub.lock);
+                stream_hub.no_mem++;
+                taskEXIT_CRITICAL(&stream_hub.lock);
+            }
+        }
+        camera_fb_release(fb);
+    }
+}
+
+void stream_client_run(int slot, stream_send_t send, void *ctx) {
+    uint32_t last_seq = 0;
+    int64_t next_send_us = 0;
+    bool ok = true;
+
+    while (ok) {
+        stream_sleep_until(next_send_us);
+        stream_frame_t *frame = stream_hub_get(last_seq);
+        if (!frame) {
+            // Wait for the next frame (published at least every STREAM_KEEPALIVE_MS while streaming)
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(STREAM_KEEPALIVE_MS));
+            continue;
+        }
+        uint32_t dropped = last_seq ? frame->seq - last_seq - 1 : 0;
+        last_seq = frame->seq;
+
+        int64_t start_us = esp_timer_get_time();
+        ok = send(ctx, frame);
+        int64_t now_us = esp_timer_get_time();
+        stream_hub_sent(slot, frame, dropped, now_us - start_us, now_us);
+        stream_frame_release(frame);
+
+        taskENTER_CRITICAL(&stream_hub.lock);
+        next_send_us = start_us + stream_client_interval_us(&stream_hub.clients[slot]);
+        taskEXIT_CRITICAL(&stream_hub.lock);
+    }
+    stream_hub_unsubscribe(slot);
+}
+
+void stream_hub_start(void) {
+    xTaskCreate(stream_capture_task, "stream_capture", STREAM_TASK_STACK, NULL, STREAM_TASK_PRIORITY, &stream_hub.capture_task);
+}
+
+// ==== Stream Statistics Handler ====
+esp_err_t stream_stats_handler(httpd_req_t *req) {
+    char buf[1280];
+    int len;
+
+    // Copied under the locks, formatted after: snprintf is too slow for a critical section
+    camera_fb_stats_t fb;
+    camera_fb_get_stats(&fb);
+    // Sensor frames neither handed over nor returned stale; the frames in the buffers count until taken
+    uint32_t fb_overruns = fb.frames > fb.grabs + fb.stale ? fb.frames - fb.grabs - fb.stale : 0;
+
+    stream_client_t clients[STREAM_MAX_CLIENTS];
+    taskENTER_CRITICAL(&stream_hub.lock);
+    float capture_fps = stream_hub.capture_fps.fps;
+    uint32_t interval_us = stream_hub.interval_us;
+    uint32_t captured = stream_hub.captured;
+    uint32_t published = stream_hub.published;
+    uint32_t capture_failed = stream_hub.capture_failed;
+    uint32_t no_mem = stream_hub.no_mem;
+    memcpy(clients, stream_hub.clients, sizeof(clients));
+    taskEXIT_CRITICAL(&stream_hub.lock);
+
+    len = snprintf(buf, sizeof(buf),
+                   "{\"capture_fps\":%.1f,\"interval_ms\":%.1f,\"captured\":%" PRIu32 ",\"published\":%" PRIu32
+                   ",\"capture_failed\":%" PRIu32 ",\"no_mem\":%" PRIu32
+                   ",\"fb\":{\"sensor_frames\":%" PRIu32 ",\"grabs\":%" PRIu32 ",\"failed\":%" PRIu32 ",\"stale\":%" PRIu32 ",\"overruns\":%" PRIu32
+                   ",\"sensor_fps\":%.1f,\"wait_ms\":%.1f,\"max_wait_ms\":%.1f,\"age_ms\":%.1f,\"max_age_ms\":%.1f}"
+                   ",\"clients\":[",
+                   capture_fps, interval_us / 1000.0, captured, published, capture_failed, no_mem,
+                   fb.frames, fb.grabs, fb.failed, fb.stale, fb_overruns, fb.period_us ? 1e6 / fb.period_us : 0.0,
+                   fb.wait_us / 1000.0, fb.max_wait_us / 1000.0, fb.age_us / 1000.0, fb.max_age_us / 1000.0);
+    const char *sep = "";
+    for (int i = 0; i < STREAM_MAX_CLIENTS && len < (int)sizeof(buf); i++) {
+        const stream_client_t *client = &clients[i];
+        if (!client->task) continue;
+        len += snprintf(buf + len, sizeof(buf) - len,
+                        "%s{\"fps\":%.1f,\"target_fps\":%.1f,\"send_ms\":%.1f,\"latency_ms\":%.1f,\"kbps\":%" PRIu32
+                        ",\"sent\":%" PRIu32 ",\"dropped\":%" PRIu32 "}",
+                        sep, client->fps.fps, 1e6 / client->interval_us, client->send_us / 1000.0, client->latency_us / 1000.0,
+                        client->kbps, client->sent, client->dropped);
+        sep = ",";
+    }
+    if (len < (int)sizeof(buf)) {
+        len += snprintf(buf + len, sizeof(buf) - len, "]}");
+    }
+    if (len >= (int)sizeof(buf)) {
+        return httpd_resp_send_500(req);
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, len);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define STREAM_MAX_CLIENTS        4     // Concurrent stream clients, of all kinds
+#define STREAM_DEFAULT_FPS        20    // Frame rate of a client that asks for none
+#define STREAM_MAX_FPS            30
+#define STREAM_PART_HEADROOM      80    // Room for the boundary and part headers in front of the JPEG
+#define STREAM_FRAME_UNCHANGED    0x1   // Published to keep the streams alive, the scene did not change
+#define STREAM_TASK_STACK         4096
+#define STREAM_TASK_PRIORITY      5     // Same as the httpd task
+
+typedef struct {
+    uint32_t refs;      // Latest frame of the hub + senders using it, guarded by the hub
+    uint32_t seq;       // Sequence number of the published frame
+    uint32_t flags;     // STREAM_FRAME_*
+    int64_t timestamp_us;   // Capture time (esp_timer_get_time)
+    size_t len;         // Size of the JPEG frame, which starts at buf + STREAM_PART_HEADROOM
+    uint8_t *part;      // Multipart part in buf: boundary, part headers, JPEG frame and CRLF
+    size_t part_len;
+    uint8_t buf[];      // Headroom and copy of the JPEG frame: the camera buffer is returned right away, whatever the clients do
+} stream_frame_t;
+
+// Sends one frame to a client, returns false if the client is gone
+typedef bool (*stream_send_t)(void *ctx, const stream_frame_t *frame);
+
+// Starts the capture task
+void stream_hub_start(void);
+
+// Returns the slot of the client, or -1 if there are too many clients
+int stream_hub_subscribe(TaskHandle_t task, uint32_t interval_us);
+
+void stream_hub_unsubscribe(int slot);
+
+void stream_hub_set_interval(int slot, uint32_t interval_us);
+
+// Sends the frames to the client of slot at its pace until it is gone, then unsubscribes it
+void stream_client_run(int slot, stream_send_t send, void *ctx);
+
+// Sleeps until deadline_us; rounded up to whole ticks, never wakes up early
+void stream_sleep_until(int64_t deadline_us);
+
+// Achieved frame rates and drop counts of the camera, its frame buffers and every stream client, as JSON
+esp_err_t stream_stats_handler(httpd_req_t *req);
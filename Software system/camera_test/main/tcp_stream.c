@@ -0,0 +1,215 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "esp_log.h"
+#include "stream_hub.h"
+#include "tcp_stream.h"
+
+#define TAG "CAMERA_STREAM"
+
+// Pushes the stream to a receiver as raw frames, without HTTP: each frame is a tcp_frame_header_t
+// followed by the JPEG, sent with one gather write. The receiver is Backend/RustyServer/tovi_tcp_server.
+// "/tcp-stream?host=192.168.1.13&port=8000&fps=10" starts the sender, "/tcp-stream?stop=1" stops it;
+// one receiver at a time. It is one more client of the stream hub, paced and counted like the /stream
+// clients, and holds a slot only while connecting or connected.
+// Sockets: the httpd takes max_open_sockets (7) + 3, the uploader and this sender one each, hence
+// CONFIG_LWIP_MAX_SOCKETS=12.
+#define TCP_STREAM_FPS           10     // Default frame rate
+#define TCP_STREAM_RETRY_MS      2000   // Delay before reconnecting
+#define TCP_STREAM_SEND_TIMEOUT_MS 3000 // A receiver that takes no data for this long is dropped
+#define TCP_FRAME_MAGIC          0x46564f54     // "TOVF"
+#define TCP_FRAME_VERSION        1
+#define TCP_FRAME_FIRST          0x1    // First frame of the connection
+#define TCP_FRAME_UNCHANGED      0x2    // STREAM_FRAME_UNCHANGED
+
+// Little-endian, as the ESP32
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t flags;              // TCP_FRAME_*
+    uint16_t header_len;        // sizeof(tcp_frame_header_t), the receiver skips what it does not know
+    uint32_t seq;               // Gaps are frames the sender skipped
+    uint64_t timestamp_us;      // Capture time, device clock
+    uint32_t len;               // JPEG bytes that follow
+} tcp_frame_header_t;
+_Static_assert(sizeof(tcp_frame_header_t) == 24, "tcp_frame_header_t is part of the wire format");
+
+typedef struct {
+    int sock;
+    bool first;
+} tcp_stream_t;
+
+static struct {
+    portMUX_TYPE lock;
+    bool running;               // Sender task started and not exited yet
+    bool stop;                  // Asked to stop
+    char host[16];              // Dotted IPv4 address of the receiver
+    int port;
+    int fps;
+} tcp_hub = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+};
+
+static bool tcp_stream_stopping(void) {
+    taskENTER_CRITICAL(&tcp_hub.lock);
+    bool stop = tcp_hub.stop;
+    taskEXIT_CRITICAL(&tcp_hub.lock);
+    return stop;
+}
+
+static bool tcp_stream_send(void *ctx, const stream_frame_t *frame) {
+    tcp_stream_t *stream = ctx;
+    if (tcp_stream_stopping()) return false;
+
+    tcp_frame_header_t header = {
+        .magic = TCP_FRAME_MAGIC,
+        .version = TCP_FRAME_VERSION,
+        .flags = (stream->first ? TCP_FRAME_FIRST : 0) | (frame->flags & STREAM_FRAME_UNCHANGED ? TCP_FRAME_UNCHANGED : 0),
+        .header_len = sizeof(tcp_frame_header_t),
+        .seq = frame->seq,
+        .timestamp_us = frame->timestamp_us,
+        .len = frame->len,
+    };
+    struct iovec iov[2] = {
+        { .iov_base = &header, .iov_len = sizeof(header) },
+        { .iov_base = (void *)(frame->buf + STREAM_PART_HEADROOM), .iov_len = frame->len },
+    };
+    stream->first = false;
+
+    // sendmsg() may send part of it when the send buffer is full: go on with the rest
+    struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2 };
+    while (msg.msg_iovlen > 0) {
+        ssize_t sent = sendmsg(stream->sock, &msg, 0);
+        if (sent < 0) {
+            // EAGAIN: nothing taken for TCP_STREAM_SEND_TIMEOUT_MS
+            ESP_LOGW(TAG, "TCP stream send failed: errno %d", errno);
+            return false;
+        }
+        while (msg.msg_iovlen > 0 && (size_t)sent >= msg.msg_iov->iov_len) {
+            sent -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov->iov_base = (uint8_t *)msg.msg_iov->iov_base + sent;
+            msg.msg_iov->iov_len -= sent;
+        }
+    }
+    return true;
+}
+
+static void tcp_stream_task(void *arg) {
+    char host[sizeof(tcp_hub.host)];
+    taskENTER_CRITICAL(&tcp_hub.lock);
+    strcpy(host, tcp_hub.host);
+    int port = tcp_hub.port;
+    int fps = tcp_hub.fps;
+    taskEXIT_CRITICAL(&tcp_hub.lock);
+    struct sockaddr_in dest_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = inet_addr(host),
+    };
+
+    while (!tcp_stream_stopping()) {
+        // A slot first: connecting without one would show up on the receiver as an empty recording
+        int slot = stream_hub_subscribe(xTaskGetCurrentTaskHandle(), 1000000 / fps);
+        if (slot < 0) {
+            ESP_LOGW(TAG, "Too many stream clients, TCP stream waits");
+            vTaskDelay(pdMS_TO_TICKS(TCP_STREAM_RETRY_MS));
+            continue;
+        }
+
+        tcp_stream_t stream = { .sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP), .first = true };
+        if (stream.sock < 0) {
+            ESP_LOGE(TAG, "TCP stream socket creation failed");
+        } else if (connect(stream.sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr)) != 0) {
+            ESP_LOGD(TAG, "TCP stream connect to %s:%d failed", host, port);
+        } else {
+            // Frames are written whole, do not hold back their last segment
+            int nodelay = 1;
+            setsockopt(stream.sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+            // A stalled receiver must not block the sender (and its slot) forever
+            struct timeval timeout = {
+                .tv_sec = TCP_STREAM_SEND_TIMEOUT_MS / 1000,
+                .tv_usec = (TCP_STREAM_SEND_TIMEOUT_MS % 1000) * 1000,
+            };
+            setsockopt(stream.sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+            ESP_LOGI(TAG, "TCP stream to %s:%d started", host, port);
+            stream_client_run(slot, tcp_stream_send, &stream);     // Unsubscribes
+            ESP_LOGI(TAG, "TCP stream to %s:%d stopped", host, port);
+            slot = -1;
+        }
+        if (slot >= 0) stream_hub_unsubscribe(slot);
+        if (stream.sock >= 0) close(stream.sock);
+        if (!tcp_stream_stopping()) vTaskDelay(pdMS_TO_TICKS(TCP_STREAM_RETRY_MS));
+    }
+
+    taskENTER_CRITICAL(&tcp_hub.lock);
+    tcp_hub.running = false;
+    taskEXIT_CRITICAL(&tcp_hub.lock);
+    vTaskDelete(NULL);
+}
+
+esp_err_t tcp_stream_handler(httpd_req_t *req) {
+    char query[80];
+    char value[sizeof(tcp_hub.host)];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "host and port, or stop=1 expected");
+        return ESP_FAIL;
+    }
+
+    if (httpd_query_key_value(query, "stop", value, sizeof(value)) == ESP_OK && value[0] == '1') {
+        taskENTER_CRITICAL(&tcp_hub.lock);
+        bool running = tcp_hub.running;
+        tcp_hub.stop = true;
+        taskEXIT_CRITICAL(&tcp_hub.lock);
+        return httpd_resp_sendstr(req, running ? "TCP stream stopping" : "TCP stream not running");
+    }
+
+    char host[sizeof(tcp_hub.host)] = "";
+    int port = 0;
+    int fps = TCP_STREAM_FPS;
+    httpd_query_key_value(query, "host", host, sizeof(host));
+    if (httpd_query_key_value(query, "port", value, sizeof(value)) == ESP_OK) port = atoi(value);
+    if (httpd_query_key_value(query, "fps", value, sizeof(value)) == ESP_OK) fps = atoi(value);
+    if (inet_addr(host) == INADDR_NONE || port < 1 || port > 65535 || fps < 1 || fps > STREAM_MAX_FPS) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "host must be an IPv4 address, port 1-65535, fps 1-30");
+        return ESP_FAIL;
+    }
+
+    taskENTER_CRITICAL(&tcp_hub.lock);
+    bool busy = tcp_hub.running;
+    if (!busy) {
+        tcp_hub.running = true;
+        tcp_hub.stop = false;
+        strcpy(tcp_hub.host, host);
+        tcp_hub.port = port;
+        tcp_hub.fps = fps;
+    }
+    taskEXIT_CRITICAL(&tcp_hub.lock);
+    if (busy) {
+        httpd_resp_set_status(req, "409 Conflict");
+        return httpd_resp_sendstr(req, "TCP stream already running, stop it first");
+    }
+
+    if (xTaskCreate(tcp_stream_task, "tcp_stream", STREAM_TASK_STACK, NULL, STREAM_TASK_PRIORITY, NULL) != pdPASS) {
+        taskENTER_CRITICAL(&tcp_hub.lock);
+        tcp_hub.running = false;
+        taskEXIT_CRITICAL(&tcp_hub.lock);
+        return httpd_resp_send_500(req);
+    }
+
+    char resp[64];
+    snprintf(resp, sizeof(resp), "TCP stream to %s:%d started", host, port);
+    httpd_resp_set_status(req, "202 Accepted");
+    return httpd_resp_sendstr(req, resp);
+}
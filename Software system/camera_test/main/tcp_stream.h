@@ -0,0 +1,6 @@
+#pragma once
+
+#include "esp_http_server.h"
+
+// "/tcp-stream?host=H&port=P[&fps=N]" starts the TCP sender, "/tcp-stream?stop=1" stops it
+esp_err_t tcp_stream_handler(httpd_req_t *req);
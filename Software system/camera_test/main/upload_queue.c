@@ -0,0 +1,357 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "http_uploader.h"
+#include "frame_ring.h"
+#include "motion_gate.h"
+#include "stream_hub.h"
+#include "upload_queue.h"
+
+#define TAG "CAMERA_STREAM"
+
+// ==== Upload Queue ====
+// capture_handler copies the frames to upload into this queue and answers right away; the uploader
+// task posts them to the backend with the shared keep-alive uploader, retrying failed uploads with backoff.
+// The frames of a post-trigger window are not recorded yet when the request is answered: they are
+// queued as a window item, which the uploader resolves from the frame ring when the window is over.
+#define CAPTURE_URL              "http://192.168.1.13:3000/upload"
+#define UPLOAD_QUEUE_DEPTH       16
+#define UPLOAD_QUEUE_MAX_BYTES   (64 * 1024)    // Frame copies waiting in the queue
+#define UPLOAD_RETRIES           3              // Retries after the first attempt
+#define UPLOAD_BACKOFF_MS        500            // Doubled at every retry
+#define UPLOAD_TASK_STACK        6144
+#define UPLOAD_TASK_PRIORITY     4              // Below the capture and stream tasks
+
+typedef struct {
+    uint8_t *buf;           // Frame copy, NULL for a post-trigger window
+    size_t len;
+    int64_t trigger_us;
+    int64_t timestamp_us;   // Capture time of the frame, or start of the window
+    int64_t end_us;         // End of the window
+    int64_t queued_us;
+} upload_item_t;
+
+static struct {
+    portMUX_TYPE lock;
+    QueueHandle_t queue;
+    http_uploader_handle_t uploader;            // Set once the uploader task has started
+    size_t queued_bytes;
+    uint32_t queued;                // Frames and windows accepted
+    uint32_t rejected;              // Refused because the queue was full
+    uint32_t uploaded;
+    uint32_t retried;
+    uint32_t failed;                // Given up after all retries
+    uint32_t missed;                // Window frames evicted from the ring before they were uploaded
+    uint32_t latency_ms;            // Smoothed time from queueing to upload
+    uint32_t max_latency_ms;
+} upload_hub = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+};
+
+// Returns true if items frames of bytes in total can be queued. capture_handler is the only producer:
+// the room it sees can only grow until it pushes.
+static bool upload_queue_has_room(uint32_t items, size_t bytes) {
+    if (uxQueueSpacesAvailable(upload_hub.queue) < items) return false;
+    taskENTER_CRITICAL(&upload_hub.lock);
+    bool room = upload_hub.queued_bytes + bytes <= UPLOAD_QUEUE_MAX_BYTES;
+    taskEXIT_CRITICAL(&upload_hub.lock);
+    return room;
+}
+
+static bool upload_queue_push(upload_item_t *item) {
+    bool ok = false;
+
+    item->queued_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&upload_hub.lock);
+    if (upload_hub.queued_bytes + item->len <= UPLOAD_QUEUE_MAX_BYTES) {
+        upload_hub.queued_bytes += item->len;
+        ok = true;
+    }
+    taskEXIT_CRITICAL(&upload_hub.lock);
+
+    if (ok && xQueueSend(upload_hub.queue, item, 0) != pdTRUE) {
+        taskENTER_CRITICAL(&upload_hub.lock);
+        upload_hub.queued_bytes -= item->len;
+        taskEXIT_CRITICAL(&upload_hub.lock);
+        ok = false;
+    }
+
+    taskENTER_CRITICAL(&upload_hub.lock);
+    if (ok) {
+        upload_hub.queued++;
+    } else {
+        upload_hub.rejected++;
+    }
+    taskEXIT_CRITICAL(&upload_hub.lock);
+    return ok;
+}
+
+// Posts one JPEG frame; offset_ms is its capture time relative to the trigger
+static esp_err_t capture_upload(http_uploader_handle_t uploader, const uint8_t *buf, size_t len, int offset_ms) {
+    char offset[12];
+    snprintf(offset, sizeof(offset), "%d", offset_ms);
+    const char *headers[] = { "X-Frame-Offset-Ms", offset, NULL };
+
+    int status = 0;
+    esp_err_t err = http_uploader_post(uploader, buf, len, headers, &status);
+    if (err == ESP_OK && status >= 500) {
+        err = ESP_FAIL;     // Worth retrying
+    }
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Image sent to server (%+d ms). Status = %d", offset_ms, status);
+    } else {
+        ESP_LOGW(TAG, "Failed to send image to server: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+static void upload_frame(http_uploader_handle_t uploader, const upload_item_t *item,
+                         const uint8_t *buf, size_t len, int64_t timestamp_us) {
+    esp_err_t err = capture_upload(uploader, buf, len, (int)((timestamp_us - item->trigger_us) / 1000));
+    for (int retry = 0; err != ESP_OK && retry < UPLOAD_RETRIES; retry++) {
+        vTaskDelay(pdMS_TO_TICKS(UPLOAD_BACKOFF_MS << retry));
+        taskENTER_CRITICAL(&upload_hub.lock);
+        upload_hub.retried++;
+        taskEXIT_CRITICAL(&upload_hub.lock);
+        err = capture_upload(uploader, buf, len, (int)((timestamp_us - item->trigger_us) / 1000));
+    }
+
+    uint32_t latency_ms = (esp_timer_get_time() - item->queued_us) / 1000;
+    taskENTER_CRITICAL(&upload_hub.lock);
+    if (err == ESP_OK) {
+        upload_hub.latency_ms = upload_hub.uploaded ? (upload_hub.latency_ms * 7 + latency_ms) / 8 : latency_ms;
+        if (latency_ms > upload_hub.max_latency_ms) upload_hub.max_latency_ms = latency_ms;
+        upload_hub.uploaded++;
+    } else {
+        upload_hub.failed++;
+    }
+    taskEXIT_CRITICAL(&upload_hub.lock);
+}
+
+static void upload_task(void *arg) {
+    http_uploader_config_t config = {
+        .url = CAPTURE_URL,
+        .content_type = "image/jpeg",
+    };
+    http_uploader_handle_t uploader = http_uploader_create(&config);
+    if (!uploader) {
+        ESP_LOGE(TAG, "No memory for the uploader");
+        vTaskDelete(NULL);
+    }
+    upload_hub.uploader = uploader;
+
+    upload_item_t item;
+    while (xQueueReceive(upload_hub.queue, &item, portMAX_DELAY) == pdTRUE) {
+        if (item.buf) {
+            upload_frame(uploader, &item, item.buf, item.len, item.timestamp_us);
+            free(item.buf);
+            taskENTER_CRITICAL(&upload_hub.lock);
+            upload_hub.queued_bytes -= item.len;
+            taskEXIT_CRITICAL(&upload_hub.lock);
+            continue;
+        }
+
+        // Post-trigger window: wait for its last frame to be recorded
+        stream_sleep_until(item.end_us + FRAME_RING_INTERVAL_US / 2);
+        uint32_t seq = 0;
+        uint32_t count = frame_ring_find(item.timestamp_us, item.end_us, &seq, NULL);
+        for (uint32_t i = 0; i < count; i++) {
+            uint8_t *buf;
+            size_t len;
+            int64_t timestamp_us;
+            if (frame_ring_copy(seq + i, &buf, &len, &timestamp_us) != ESP_OK) {
+                taskENTER_CRITICAL(&upload_hub.lock);
+                upload_hub.missed++;
+                taskEXIT_CRITICAL(&upload_hub.lock);
+                continue;
+            }
+            upload_frame(uploader, &item, buf, len, timestamp_us);
+            free(buf);
+        }
+    }
+}
+
+void upload_queue_start(void) {
+    upload_hub.queue = xQueueCreate(UPLOAD_QUEUE_DEPTH, sizeof(upload_item_t));
+    xTaskCreate(upload_task, "upload", UPLOAD_TASK_STACK, NULL, UPLOAD_TASK_PRIORITY, NULL);
+}
+
+esp_err_t upload_stats_handler(httpd_req_t *req) {
+    char buf[320];
+    http_uploader_stats_t stats = {0};
+
+    if (upload_hub.uploader) http_uploader_get_stats(upload_hub.uploader, &stats);
+    UBaseType_t depth = uxQueueMessagesWaiting(upload_hub.queue);
+    taskENTER_CRITICAL(&upload_hub.lock);
+    size_t queued_bytes = upload_hub.queued_bytes;
+    uint32_t queued = upload_hub.queued;
+    uint32_t rejected = upload_hub.rejected;
+    uint32_t uploaded = upload_hub.uploaded;
+    uint32_t retried = upload_hub.retried;
+    uint32_t failed = upload_hub.failed;
+    uint32_t missed = upload_hub.missed;
+    uint32_t latency_ms = upload_hub.latency_ms;
+    uint32_t max_latency_ms = upload_hub.max_latency_ms;
+    taskEXIT_CRITICAL(&upload_hub.lock);
+
+    int len = snprintf(buf, sizeof(buf),
+                       "{\"depth\":%u,\"queued_bytes\":%u,\"queued\":%" PRIu32 ",\"rejected\":%" PRIu32
+                       ",\"uploaded\":%" PRIu32 ",\"retried\":%" PRIu32 ",\"failed\":%" PRIu32 ",\"missed\":%" PRIu32
+                       ",\"latency_ms\":%" PRIu32 ",\"max_latency_ms\":%" PRIu32
+                       ",\"connects\":%" PRIu32 ",\"reconnects\":%" PRIu32 ",\"kbps\":%" PRIu32 "}",
+                       (unsigned)depth, (unsigned)queued_bytes, queued, rejected, uploaded, retried, failed, missed,
+                       latency_ms, max_latency_ms, stats.connects, stats.reconnects,
+                       stats.busy_us ? (uint32_t)(stats.bytes * 8000 / stats.busy_us) : 0);
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, len);
+}
+
+// ==== Photo Capture + Upload Handler ====
+static motion_gate_t capture_gate;  // Reference is the last queued frame
+
+// Queues a copy of frame seq.
+// Returns ESP_ERR_NOT_FOUND if it was evicted meanwhile, ESP_ERR_NO_MEM if out of memory or the queue is full.
+static esp_err_t capture_queue_frame(uint32_t seq, int64_t trigger_us) {
+    upload_item_t item = { .trigger_us = trigger_us };
+    esp_err_t err = frame_ring_copy(seq, &item.buf, &item.len, &item.timestamp_us);
+    if (err != ESP_OK) return err;
+    if (!upload_queue_push(&item)) {
+        free(item.buf);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// "/capture-request" uploads the frame captured closest to the moment the request was received.
+// "/capture-request?pre_ms=1000&post_ms=500" uploads every recorded frame from 1 s before to 0.5 s after it.
+// The frames are queued for upload and the request is answered with 202 Accepted without waiting.
+esp_err_t capture_handler(httpd_req_t *req) {
+    int64_t trigger_us = esp_timer_get_time();
+
+    // "/capture-request?force=1" uploads even if the scene did not change
+    char query[64];
+    char value[8];
+    bool force = false;
+    int pre_ms = 0;
+    int post_ms = 0;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "force", value, sizeof(value)) == ESP_OK) force = value[0] == '1';
+        if (httpd_query_key_value(query, "pre_ms", value, sizeof(value)) == ESP_OK) pre_ms = atoi(value);
+        if (httpd_query_key_value(query, "post_ms", value, sizeof(value)) == ESP_OK) post_ms = atoi(value);
+    }
+    // The frames before the trigger must still be recorded, and those after it must still be when
+    // the window is over: both sides fit in the time the ring actually holds, not its nominal seconds
+    int span_ms = frame_ring_span_us(trigger_us) / 1000;
+    if (pre_ms < 0 || post_ms < 0 || pre_ms > span_ms || post_ms > span_ms) {
+        char msg[80];
+        snprintf(msg, sizeof(msg), "pre_ms and post_ms must be within the %d ms recorded", span_ms);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, msg);
+        return ESP_FAIL;
+    }
+
+    uint32_t queued = 0;
+    uint32_t evicted = 0;       // Window frames overwritten before they could be queued
+    uint32_t unqueued = 0;      // Window frames or post-trigger part that did not fit after all
+    bool post_queued = false;   // The post-trigger part of the window is queued
+    bool full = false;
+    if (!pre_ms && !post_ms) {
+        // The last recorded frame, at most one ring interval old
+        uint32_t seq;
+        if (!frame_ring_closest(trigger_us, &seq)) {
+            ESP_LOGE(TAG, "No recorded frame around the trigger");
+            httpd_resp_send_500(req);
+            return ESP_FAIL;
+        }
+
+        uint8_t *buf;
+        size_t len = 0;
+        int64_t timestamp_us = 0;
+        frame_ring_copy(seq, &buf, &len, &timestamp_us);
+        camera_fb_t fb = { .buf = buf, .len = len };
+        if (buf && !motion_gate_check(&capture_gate, &fb) && !force) {
+            ESP_LOGI(TAG, "Scene unchanged, upload skipped");
+            httpd_resp_sendstr(req, "Image unchanged, upload skipped");
+            free(buf);
+            return ESP_OK;
+        }
+
+        upload_item_t item = { .buf = buf, .len = len, .trigger_us = trigger_us, .timestamp_us = timestamp_us };
+        if (buf && upload_queue_push(&item)) {
+            queued = 1;
+        } else {
+            full = buf != NULL;
+            free(buf);
+            capture_gate.valid = false;     // Not queued, do not use it as reference
+        }
+    } else {
+        // Frames recorded so far now, the rest of the window once it is over. The whole window is
+        // accepted or refused: a partly queued window would be answered 503 and still uploaded.
+        uint32_t seq = 0;
+        size_t bytes = 0;
+        uint32_t count = frame_ring_find(trigger_us - pre_ms * 1000LL, trigger_us, &seq, &bytes);
+        uint32_t items = count + (post_ms ? 1 : 0);
+        if (!upload_queue_has_room(items, bytes)) {
+            full = true;
+            taskENTER_CRITICAL(&upload_hub.lock);
+            upload_hub.rejected += items;
+            taskEXIT_CRITICAL(&upload_hub.lock);
+        }
+        for (uint32_t i = 0; i < count && !full; i++) {
+            esp_err_t err = capture_queue_frame(seq + i, trigger_us);
+            if (err == ESP_OK) {
+                queued++;
+            } else if (err == ESP_ERR_NOT_FOUND) {
+                evicted++;      // Overwritten since it was found; the rest of the window still goes
+            } else {
+                unqueued++;     // Out of memory: answered with what was queued
+            }
+        }
+        if (post_ms && !full) {
+            upload_item_t item = {
+                .trigger_us = trigger_us,
+                .timestamp_us = trigger_us + 1,
+                .end_us = trigger_us + post_ms * 1000LL,
+            };
+            post_queued = upload_queue_push(&item);
+            if (!post_queued) unqueued++;
+        }
+        if (evicted || unqueued) {
+            taskENTER_CRITICAL(&upload_hub.lock);
+            upload_hub.missed += evicted;
+            taskEXIT_CRITICAL(&upload_hub.lock);
+            ESP_LOGW(TAG, "Window: %" PRIu32 " frames evicted, %" PRIu32 " not queued", evicted, unqueued);
+        }
+    }
+
+    if (full) {
+        ESP_LOGW(TAG, "Upload queue full");
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_sendstr(req, "Upload queue full");
+        return ESP_OK;
+    }
+    if (!queued && !post_queued) {
+        ESP_LOGE(TAG, "No recorded frame around the trigger");
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    char resp[96];
+    int len = snprintf(resp, sizeof(resp), "%" PRIu32 " image%s queued", queued, queued == 1 ? "" : "s");
+    if (evicted || unqueued) {
+        len += snprintf(resp + len, sizeof(resp) - len, ", %" PRIu32 " evicted, %" PRIu32 " not queued",
+                        evicted, unqueued);
+    }
+    if (post_queued) {
+        snprintf(resp + len, sizeof(resp) - len, ", more after %d ms", post_ms);
+    }
+    httpd_resp_set_status(req, "202 Accepted");
+    httpd_resp_sendstr(req, resp);
+    return ESP_OK;
+}
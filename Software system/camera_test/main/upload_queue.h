@@ -0,0 +1,12 @@
+#pragma once
+
+#include "esp_http_server.h"
+
+// Creates the queue and starts the uploader task
+void upload_queue_start(void);
+
+// Queue depth, outcome counters and latency of the uploads, as JSON
+esp_err_t upload_stats_handler(httpd_req_t *req);
+
+// "/capture-request[?pre_ms=N&post_ms=N][&force=1]" queues recorded frames for upload
+esp_err_t capture_handler(httpd_req_t *req);
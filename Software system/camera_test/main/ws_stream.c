@@ -0,0 +1,175 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "camera_control.h"
+#include "stream_hub.h"
+#include "ws_stream.h"
+
+#define TAG "CAMERA_STREAM"
+
+// "/ws" pushes every frame as one binary message. Each viewer is a stream hub client with its own
+// sender task, so its outbound queue is the frame being sent plus the latest frame waiting, the older
+// one being dropped: a slow viewer skips frames and never delays the others.
+// Text messages from the viewer control its stream: "fps=N" sets its frame rate, "quality=N" the JPEG
+// quality of the camera (4 best - 63 smallest, shared by all viewers; stops the automatic control
+// of the camera until /control?mode=auto). The reply ("ok ..." or
+// "error ...") is sent by the sender task before the next frame, never from the httpd task.
+// A viewer is its ws_client_t, attached to the session: lwIP reuses fds, so the fd alone could name
+// the next connection once this one is closed.
+#define WS_CONTROL_MAX_LEN       32
+#define WS_REPLY_MAX_LEN         48
+
+typedef struct {
+    httpd_handle_t server;
+    int fd;
+    bool closed;                    // The session is gone, fd may be another connection; guarded by ws_hub.lock
+    int refs;                       // Session + sender task, guarded by ws_hub.lock
+    char reply[WS_REPLY_MAX_LEN];   // Pending reply, empty if none; guarded by ws_hub.lock
+} ws_client_t;
+
+static struct {
+    portMUX_TYPE lock;
+    ws_client_t *clients[STREAM_MAX_CLIENTS];   // Indexed by stream hub slot
+} ws_hub = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+};
+
+// Drops a reference to the client, frees it with the last one
+static void ws_client_unref(ws_client_t *client) {
+    taskENTER_CRITICAL(&ws_hub.lock);
+    bool last = --client->refs == 0;
+    taskEXIT_CRITICAL(&ws_hub.lock);
+    if (last) free(client);
+}
+
+// free_fn of the session context: called by the httpd task when the session is closed
+static void ws_client_closed(void *ctx) {
+    ws_client_t *client = ctx;
+
+    taskENTER_CRITICAL(&ws_hub.lock);
+    client->closed = true;
+    taskEXIT_CRITICAL(&ws_hub.lock);
+    ws_client_unref(client);
+}
+
+static bool ws_send(void *ctx, const stream_frame_t *frame) {
+    ws_client_t *client = ctx;
+
+    char reply[WS_REPLY_MAX_LEN];
+    taskENTER_CRITICAL(&ws_hub.lock);
+    bool closed = client->closed;
+    strcpy(reply, client->reply);
+    client->reply[0] = '\0';
+    taskEXIT_CRITICAL(&ws_hub.lock);
+    if (closed || httpd_ws_get_fd_info(client->server, client->fd) != HTTPD_WS_CLIENT_WEBSOCKET) return false;
+    if (reply[0]) {
+        httpd_ws_frame_t pkt = { .final = true, .type = HTTPD_WS_TYPE_TEXT, .payload = (uint8_t *)reply, .len = strlen(reply) };
+        if (httpd_ws_send_frame_async(client->server, client->fd, &pkt) != ESP_OK) return false;
+    }
+
+    httpd_ws_frame_t pkt = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_BINARY,
+        .payload = (uint8_t *)frame->buf + STREAM_PART_HEADROOM,
+        .len = frame->len,
+    };
+    return httpd_ws_send_frame_async(client->server, client->fd, &pkt) == ESP_OK;
+}
+
+static void ws_sender_task(void *arg) {
+    ws_client_t *client = arg;
+
+    int slot = stream_hub_subscribe(xTaskGetCurrentTaskHandle(), 1000000 / STREAM_DEFAULT_FPS);
+    if (slot < 0) {
+        ESP_LOGW(TAG, "Too many stream clients, WebSocket closed");
+        taskENTER_CRITICAL(&ws_hub.lock);
+        bool closed = client->closed;
+        taskEXIT_CRITICAL(&ws_hub.lock);
+        if (!closed) httpd_sess_trigger_close(client->server, client->fd);
+    } else {
+        taskENTER_CRITICAL(&ws_hub.lock);
+        ws_hub.clients[slot] = client;
+        taskEXIT_CRITICAL(&ws_hub.lock);
+
+        stream_client_run(slot, ws_send, client);
+
+        taskENTER_CRITICAL(&ws_hub.lock);
+        ws_hub.clients[slot] = NULL;
+        taskEXIT_CRITICAL(&ws_hub.lock);
+    }
+    ws_client_unref(client);
+    vTaskDelete(NULL);
+}
+
+// Applies a control message of the viewer, returns the reply
+static void ws_control(const ws_client_t *client, const char *msg, char *reply, size_t reply_size) {
+    int value = -1;
+    char key[16];
+    if (sscanf(msg, "%15[a-z]=%d", key, &value) != 2) {
+        snprintf(reply, reply_size, "error expected fps=N or quality=N");
+    } else if (!strcmp(key, "fps") && value >= 1 && value <= STREAM_MAX_FPS) {
+        bool found = false;
+        taskENTER_CRITICAL(&ws_hub.lock);     // The slot cannot be given to another client meanwhile
+        for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+            if (ws_hub.clients[i] == client) {
+                stream_hub_set_interval(i, 1000000 / value);
+                found = true;
+            }
+        }
+        taskEXIT_CRITICAL(&ws_hub.lock);
+        if (found) {
+            snprintf(reply, reply_size, "ok fps=%d", value);
+        } else {
+            snprintf(reply, reply_size, "error not streaming");
+        }
+    } else if (!strcmp(key, "quality") && value >= 4 && value <= 63) {
+        camera_control_set_quality(value);
+        snprintf(reply, reply_size, "ok quality=%d", value);
+    } else {
+        snprintf(reply, reply_size, "error %s=%d out of range", key, value);
+    }
+}
+
+esp_err_t ws_stream_handler(httpd_req_t *req) {
+    int fd = httpd_req_to_sockfd(req);
+
+    if (req->method == HTTP_GET) {
+        // Handshake done: start streaming to the new viewer
+        ws_client_t *client = calloc(1, sizeof(ws_client_t));
+        if (!client) return ESP_ERR_NO_MEM;
+        client->server = req->handle;
+        client->fd = fd;
+        client->refs = 2;
+        if (xTaskCreate(ws_sender_task, "ws_sender", STREAM_TASK_STACK, client, STREAM_TASK_PRIORITY, NULL) != pdPASS) {
+            free(client);
+            return ESP_FAIL;
+        }
+        // Owned by the session from now on: ws_client_closed() runs when the connection goes
+        httpd_sess_set_ctx(req->handle, fd, client, ws_client_closed);
+        return ESP_OK;
+    }
+
+    ws_client_t *client = httpd_sess_get_ctx(req->handle, fd);
+    if (!client) return ESP_FAIL;
+
+    char msg[WS_CONTROL_MAX_LEN + 1];
+    httpd_ws_frame_t pkt = { .payload = (uint8_t *)msg };
+    esp_err_t err = httpd_ws_recv_frame(req, &pkt, 0);     // Length only
+    if (err != ESP_OK) return err;
+    if (pkt.len > WS_CONTROL_MAX_LEN) {
+        ESP_LOGW(TAG, "WebSocket message of %u bytes ignored", (unsigned)pkt.len);
+        return ESP_FAIL;
+    }
+    err = httpd_ws_recv_frame(req, &pkt, WS_CONTROL_MAX_LEN);
+    if (err != ESP_OK || pkt.type != HTTPD_WS_TYPE_TEXT) return err;
+    msg[pkt.len] = '\0';
+
+    char reply[WS_REPLY_MAX_LEN];
+    ws_control(client, msg, reply, sizeof(reply));
+    taskENTER_CRITICAL(&ws_hub.lock);
+    strcpy(client->reply, reply);
+    taskEXIT_CRITICAL(&ws_hub.lock);
+    return ESP_OK;
+}
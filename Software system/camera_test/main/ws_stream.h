@@ -0,0 +1,6 @@
+#pragma once
+
+#include "esp_http_server.h"
+
+// "/ws" streams the camera as binary WebSocket messages; register with is_websocket set
+esp_err_t ws_stream_handler(httpd_req_t *req);
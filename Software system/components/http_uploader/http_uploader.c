@@ -0,0 +1,115 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "http_uploader.h"
+
+static const char *TAG = "HTTP_UPLOADER";
+
+struct http_uploader {
+    esp_http_client_handle_t client;
+    SemaphoreHandle_t lock;         // Serializes the POSTs
+    bool connected;                 // A connection was opened by the current POST
+    portMUX_TYPE stats_lock;        // Guards stats, never held across a POST
+    http_uploader_stats_t stats;
+};
+
+static esp_err_t http_uploader_event(esp_http_client_event_t *evt) {
+    struct http_uploader *uploader = evt->user_data;
+
+    if (evt->event_id == HTTP_EVENT_ON_CONNECTED) {
+        uploader->connected = true;
+        taskENTER_CRITICAL(&uploader->stats_lock);
+        uploader->stats.connects++;
+        taskEXIT_CRITICAL(&uploader->stats_lock);
+    }
+    return ESP_OK;
+}
+
+http_uploader_handle_t http_uploader_create(const http_uploader_config_t *config) {
+    struct http_uploader *uploader = calloc(1, sizeof(struct http_uploader));
+    if (!uploader) return NULL;
+    portMUX_INITIALIZE(&uploader->stats_lock);
+
+    esp_http_client_config_t client_config = {
+        .url = config->url,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = config->timeout_ms,
+        .keep_alive_enable = true,
+        .event_handler = http_uploader_event,
+        .user_data = uploader,
+    };
+    uploader->client = esp_http_client_init(&client_config);
+    uploader->lock = xSemaphoreCreateMutex();
+    if (!uploader->client || !uploader->lock) {
+        http_uploader_destroy(uploader);
+        return NULL;
+    }
+    if (config->content_type) {
+        esp_http_client_set_header(uploader->client, "Content-Type", config->content_type);
+    }
+    return uploader;
+}
+
+void http_uploader_destroy(http_uploader_handle_t uploader) {
+    if (!uploader) return;
+
+    if (uploader->client) esp_http_client_cleanup(uploader->client);
+    if (uploader->lock) vSemaphoreDelete(uploader->lock);
+    free(uploader);
+}
+
+esp_err_t http_uploader_post(http_uploader_handle_t uploader, const void *data, size_t len,
+                             const char *const *headers, int *status) {
+    xSemaphoreTake(uploader->lock, portMAX_DELAY);
+    for (const char *const *h = headers; h && h[0]; h += 2) {
+        esp_http_client_set_header(uploader->client, h[0], h[1]);
+    }
+    esp_http_client_set_post_field(uploader->client, data, len);
+
+    int64_t start_us = esp_timer_get_time();
+    uploader->connected = false;
+    esp_err_t err = esp_http_client_perform(uploader->client);
+    bool resent = false;
+    if (!uploader->connected && (err == ESP_ERR_HTTP_WRITE_DATA || err == ESP_ERR_HTTP_CONNECT)) {
+        // The kept-alive connection was closed by the backend (idle timeout, restart) before the request
+        // went out: once more on a new one. Any later error (no response in time...) may come after the
+        // backend got the request, and is left to the caller.
+        ESP_LOGD(TAG, "Reconnecting after %s", esp_err_to_name(err));
+        esp_http_client_close(uploader->client);
+        resent = true;
+        err = esp_http_client_perform(uploader->client);
+    }
+    int64_t busy_us = esp_timer_get_time() - start_us;
+
+    if (err == ESP_OK) {
+        if (status) *status = esp_http_client_get_status_code(uploader->client);
+    } else {
+        esp_http_client_close(uploader->client);    // Start from a clean connection next time
+    }
+    taskENTER_CRITICAL(&uploader->stats_lock);
+    if (resent) uploader->stats.reconnects++;
+    if (err == ESP_OK) {
+        uploader->stats.posts++;
+        uploader->stats.bytes += len;
+    } else {
+        uploader->stats.failed++;
+    }
+    uploader->stats.busy_us += busy_us;
+    taskEXIT_CRITICAL(&uploader->stats_lock);
+
+    for (const char *const *h = headers; h && h[0]; h += 2) {
+        esp_http_client_delete_header(uploader->client, h[0]);
+    }
+    xSemaphoreGive(uploader->lock);
+    return err;
+}
+
+void http_uploader_get_stats(http_uploader_handle_t uploader, http_uploader_stats_t *stats) {
+    taskENTER_CRITICAL(&uploader->stats_lock);
+    *stats = uploader->stats;
+    taskEXIT_CRITICAL(&uploader->stats_lock);
+}
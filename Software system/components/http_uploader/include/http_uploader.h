@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Uploader that POSTs to one backend over a kept-alive connection
+ *
+ * The connection is opened by the first POST and reused by the next ones, so that sequential uploads
+ * do not pay for a TCP connect and slow start each time. If the backend closed it in the meantime
+ * and the request could not be written, the POST is sent again on a new connection; a POST that may
+ * have reached the backend is never sent again. An uploader may be shared by several tasks: POSTs are
+ * serialized, the counters can be read during a POST.
+ */
+typedef struct http_uploader *http_uploader_handle_t;
+
+/**
+ * @brief Configuration of an uploader
+ *
+ */
+typedef struct {
+    const char *url;            /*!< URL to POST to */
+    const char *content_type;   /*!< Content-Type of the uploads */
+    int timeout_ms;             /*!< Network timeout, 0 for the esp_http_client default */
+} http_uploader_config_t;
+
+/**
+ * @brief Counters of an uploader
+ *
+ */
+typedef struct {
+    uint32_t posts;         /*!< Successful POSTs (any HTTP status) */
+    uint32_t failed;        /*!< POSTs that got no response */
+    uint32_t connects;      /*!< Connections opened */
+    uint32_t reconnects;    /*!< POSTs sent again because the kept-alive connection was closed before the request went out */
+    uint64_t bytes;         /*!< Bytes of the successful POSTs */
+    uint64_t busy_us;       /*!< Time spent in POSTs, bytes / busy_us is the upload throughput */
+} http_uploader_stats_t;
+
+/**
+ * @brief Create an uploader; no connection is opened until the first POST
+ *
+ * @param config Configuration, the strings must stay valid as long as the uploader
+ * @return Uploader, or NULL if out of memory
+ */
+http_uploader_handle_t http_uploader_create(const http_uploader_config_t *config);
+
+/**
+ * @brief Close the connection and free the uploader
+ */
+void http_uploader_destroy(http_uploader_handle_t uploader);
+
+/**
+ * @brief POST data to the backend
+ *
+ * @param uploader Uploader
+ * @param data Body of the POST
+ * @param len Size of the body
+ * @param headers Additional headers of this POST only: name, value, name, value..., NULL; or NULL
+ * @param status HTTP status of the response, may be NULL
+ * @return
+ *      - ESP_OK if the backend answered, whatever the status
+ *      - Error of esp_http_client_perform() otherwise
+ */
+esp_err_t http_uploader_post(http_uploader_handle_t uploader, const void *data, size_t len,
+                             const char *const *headers, int *status);
+
+/**
+ * @brief Get the counters of an uploader
+ */
+void http_uploader_get_stats(http_uploader_handle_t uploader, http_uploader_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
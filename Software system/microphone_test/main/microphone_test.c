@@ -190,6 +190,7 @@ void app_main(void) {
 #include "esp_netif.h"
 #include "esp_http_client.h"
 #include "esp_http_server.h"
+#include "http_uploader.h"
 
 #include "driver/i2s_pdm.h"
 #include "esp_heap_caps.h"
@@ -346,6 +347,20 @@ void task_triggered_audio_send(void *arg) {
         return;
     }
 
+    // One kept-alive connection for all the recordings
+    http_uploader_config_t config = {
+        .url = AUDIO_UPLOAD_URL,
+        .content_type = "application/octet-stream",
+        .timeout_ms = 10000,
+    };
+    http_uploader_handle_t uploader = http_uploader_create(&config);
+    if (!uploader) {
+        ESP_LOGE(TAG, "Uploader allocation failed");
+        free(buffer);
+        vTaskDelete(NULL);
+        return;
+    }
+
     while (1) {
         if (!trigger_flag) {
             vTaskDelay(pdMS_TO_TICKS(500));
@@ -368,27 +383,16 @@ void task_triggered_audio_send(void *arg) {
         high_pass_filter((int16_t *)buffer, CHUNK_SIZE);
         moving_average_filter((int16_t *)buffer, CHUNK_SIZE);
 
-        esp_http_client_config_t config = {
-            .url = AUDIO_UPLOAD_URL,
-            .method = HTTP_METHOD_POST,
-            .timeout_ms = 10000,
-        };
-
-        esp_http_client_handle_t client = esp_http_client_init(&config);
-        esp_http_client_set_header(client, "Content-Type", "application/octet-stream");
-
-        if (esp_http_client_open(client, CHUNK_SIZE) == ESP_OK) {
-            esp_http_client_write(client, buffer, CHUNK_SIZE);
-            esp_http_client_close(client);
+        if (http_uploader_post(uploader, buffer, CHUNK_SIZE, NULL, NULL) == ESP_OK) {
             ESP_LOGI(TAG, "Audio sent to server");
         } else {
             ESP_LOGW(TAG, "Failed to send audio");
         }
 
-        esp_http_client_cleanup(client);
         gpio_set_level(LED_GPIO, 0); // LED OFF
     }
 
+    http_uploader_destroy(uploader);
     free(buffer);
     vTaskDelete(NULL);
 }
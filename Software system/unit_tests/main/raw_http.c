@@ -1,4 +1,5 @@
 #include <string.h>
+#include <inttypes.h>
 #include "esp_log.h"
 #include "esp_event.h"
 #include "esp_wifi.h"
@@ -8,6 +9,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_timer.h"
+#include "http_uploader.h"
 
 #define WIFI_SSID       "Airtel_gaur_2614"
 #define WIFI_PASS       "air97600"
@@ -15,6 +17,7 @@
 
 #define TEST_SIZE       (16000 * 5 * 2) // 16-bit 16kHz stereo 5 sec = 160KB
 #define ITERATIONS      -1  // -1 = infinite
+#define KEEP_ALIVE      1   // 1: shared http_uploader (one kept-alive connection), 0: new client per POST
 
 static const char *TAG = "HTTP_BENCHMARK";
 
@@ -42,6 +45,28 @@ void wifi_init_sta(void) {
     ESP_LOGI(TAG, "Wi-Fi started and connecting...");
 }
 
+#if KEEP_ALIVE
+esp_err_t send_buffer_http_post(uint8_t *data, size_t len) {
+    static http_uploader_handle_t uploader;
+    if (!uploader) {
+        http_uploader_config_t config = {
+            .url = SERVER_URL,
+            .content_type = "application/octet-stream",
+            .timeout_ms = 10000
+        };
+        uploader = http_uploader_create(&config);
+        if (!uploader) return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = http_uploader_post(uploader, data, len, NULL, NULL);
+
+    http_uploader_stats_t stats;
+    http_uploader_get_stats(uploader, &stats);
+    ESP_LOGI(TAG, "Connections: %" PRIu32 ", reconnects: %" PRIu32 ", POST throughput: %.2f MB/s",
+             stats.connects, stats.reconnects, stats.bytes / (1024.0 * 1024.0) / (stats.busy_us / 1000000.0));
+    return err;
+}
+#else
 esp_err_t send_buffer_http_post(uint8_t *data, size_t len) {
     esp_http_client_config_t config = {
         .url = SERVER_URL,
@@ -57,6 +82,7 @@ esp_err_t send_buffer_http_post(uint8_t *data, size_t len) {
     esp_http_client_cleanup(client);
     return err;
 }
+#endif
 
 void app_main(void) {
     wifi_init_sta();